@@ -0,0 +1,460 @@
+#include <cppjson/cppjson.h>
+#include <iostream>
+#include <fstream>
+#include <chrono>
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+/**
+ * cppjson のベンチマーク。
+ * 合成したコーパス（実行毎に同一の内容）に対して下記を計測し、結果を json で出力する。
+ * - デシリアライズ / シリアライズ / 検証（validate）の速度（MB/s）
+ * - 入力全体の UTF-8 の検証（utf8::valid）の速度（MB/s）
+ * - デシリアライズ 1 回あたりのメモリ確保回数とバイト数
+ * - 既存の json を再利用するデシリアライズ（deserializer::reset() と execute(json&)）の速度とメモリ確保回数
+ * - デシリアライズしてそのままシリアライズする経路の速度（数値を変換する場合と raw_numbers() の場合）
+ * - json のコピー（コピーコンストラクタ）と clone() の時間
+ * - path_util::find による検索回数（lookups/s）
+ * - 一部のパスのみを生成するデシリアライズ（deserializer::project()）の速度とメモリ確保回数
+ * - 不正な入力の棄却（execute() の例外と try_execute() のエラーコード）の回数（rejects/s）
+ * - 入力のバッファを参照するデシリアライズ（borrowed_deserializer）の速度とメモリ確保回数
+ *
+ * cppjson_bench [--scale=N] [--out=path]
+ *   --scale  コーパスの大きさの倍率（既定値 1）
+ *   --out    結果の出力先（既定値は標準出力）
+ **/
+
+using namespace cppjson;
+
+/************** メモリ確保の計測 ***************/
+namespace {
+  std::atomic<std::size_t> g_alloc_count(0);
+  std::atomic<std::size_t> g_alloc_bytes(0);
+}
+
+/** 確保と解放の組み合わせが一致するように、通常・配列・nothrow・サイズ付きの全ての形式を置き換える */
+namespace {
+  void* counted_malloc(std::size_t size) noexcept {
+    g_alloc_count.fetch_add(1, std::memory_order_relaxed);
+    g_alloc_bytes.fetch_add(size, std::memory_order_relaxed);
+    return std::malloc(size ? size : 1);
+  }
+
+  /** インライン展開されると GCC が new 式と free() の組み合わせを -Wmismatched-new-delete で警告するため展開しない */
+#if defined(__GNUC__)
+  __attribute__((noinline))
+#endif
+  void counted_free(void* p) noexcept {
+    std::free(p);
+  }
+}
+
+void* operator new(std::size_t size) {
+  if(void* p = counted_malloc(size)) return p;
+  throw std::bad_alloc();
+}
+
+void* operator new[](std::size_t size) {
+  if(void* p = counted_malloc(size)) return p;
+  throw std::bad_alloc();
+}
+
+void* operator new(std::size_t size, const std::nothrow_t&) noexcept {
+  return counted_malloc(size);
+}
+
+void* operator new[](std::size_t size, const std::nothrow_t&) noexcept {
+  return counted_malloc(size);
+}
+
+void operator delete(void* p) noexcept                          { counted_free(p); }
+void operator delete[](void* p) noexcept                        { counted_free(p); }
+void operator delete(void* p, std::size_t) noexcept             { counted_free(p); }
+void operator delete[](void* p, std::size_t) noexcept           { counted_free(p); }
+void operator delete(void* p, const std::nothrow_t&) noexcept   { counted_free(p); }
+void operator delete[](void* p, const std::nothrow_t&) noexcept { counted_free(p); }
+
+struct alloc_counter {
+  std::size_t count;
+  std::size_t bytes;
+  alloc_counter() : count(g_alloc_count.load()), bytes(g_alloc_bytes.load()) {}
+  std::size_t count_since() const { return g_alloc_count.load() - count; }
+  std::size_t bytes_since() const { return g_alloc_bytes.load() - bytes; }
+};
+
+/************** コーパスの生成 ***************/
+/** 標準ライブラリの分布は実装によって結果が異なるため、独自の乱数で同一の内容を生成する */
+class rng {
+private:
+  uint64_t m_state;
+public:
+  rng(uint64_t seed) : m_state(seed) {}
+  uint64_t next() {
+    uint64_t z = (m_state += 0x9E3779B97F4A7C15ull);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+    return z ^ (z >> 31);
+  }
+  uint64_t range(uint64_t n) { return next() % n; }
+  double real(double lo, double hi) { return lo + (hi - lo) * (next() >> 11) * (1.0 / 9007199254740992.0); }
+};
+
+static std::string word(rng& r) {
+  static const char* words[] = {
+    "lorem", "ipsum", "dolor", "sit", "amet", "consectetur", "adipiscing", "elit",
+    "sed", "do", "eiusmod", "tempor", "incididunt", "ut", "labore", "et", "dolore",
+    "magna", "aliqua", "\\u3053\\u3093\\u306b\\u3061\\u306f", "caf\\u00e9", "\\\"quoted\\\"", "tab\\tbed", "line\\nfeed"
+  };
+  return words[r.range(sizeof(words) / sizeof(words[0]))];
+}
+
+/** 数値が大半を占める（canada.json 相当） */
+static std::string corpus_numbers(int scale) {
+  rng r(1);
+  std::ostringstream os;
+  os.precision(15);
+  os << R"({"type":"FeatureCollection","features":[)";
+  for(int f = 0; f < 4 * scale; f++){
+    if(f) os << ",";
+    os << R"({"type":"Feature","properties":{"name":"region)" << f << R"("},"geometry":{"type":"Polygon","coordinates":[)";
+    for(int ring = 0; ring < 8; ring++){
+      if(ring) os << ",";
+      os << "[";
+      for(int p = 0; p < 1000; p++){
+        if(p) os << ",";
+        os << "[" << r.real(-180, 180) << "," << r.real(-90, 90) << "]";
+      }
+      os << "]";
+    }
+    os << "]}}";
+  }
+  os << "]}";
+  return os.str();
+}
+
+/** 文字列が大半を占める（twitter.json 相当） */
+static std::string corpus_strings(int scale) {
+  rng r(2);
+  std::ostringstream os;
+  os << R"({"statuses":[)";
+  for(int i = 0; i < 2000 * scale; i++){
+    if(i) os << ",";
+    os << R"({"id":)" << (500000000000000000ll + i) << R"(,"text":")";
+    for(int w = 0, n = 8 + static_cast<int>(r.range(24)); w < n; w++){
+      os << (w ? " " : "") << word(r);
+    }
+    os << R"(","user":{"id":)" << r.range(100000000) << R"(,"name":")" << word(r) << " " << word(r)
+       << R"(","screen_name":"user_)" << r.range(100000) << R"(","description":")" << word(r) << " " << word(r) << " " << word(r)
+       << R"(","verified":)" << (r.range(2) ? "true" : "false") << R"(,"followers_count":)" << r.range(1000000)
+       << R"(},"lang":"ja","retweet_count":)" << r.range(1000) << R"(,"in_reply_to":null,"hashtags":[")" << word(r) << R"(",")" << word(r) << R"("]})";
+  }
+  os << "]}";
+  return os.str();
+}
+
+/** 深い入れ子 */
+static std::string corpus_nested(int scale) {
+  std::ostringstream os;
+  const int depth = 256;
+  os << "[";
+  for(int n = 0; n < 100 * scale; n++){
+    if(n) os << ",";
+    for(int d = 0; d < depth; d++){
+      os << ((d % 2) ? "[" : R"({"k":)");
+    }
+    os << n;
+    for(int d = depth - 1; d >= 0; d--){
+      os << ((d % 2) ? "]" : "}");
+    }
+  }
+  os << "]";
+  return os.str();
+}
+
+/** 小さな object が大量にある */
+static std::string corpus_small_objects(int scale) {
+  rng r(4);
+  std::ostringstream os;
+  os << "[";
+  for(int i = 0; i < 50000 * scale; i++){
+    if(i) os << ",";
+    os << R"({"id":)" << i << R"(,"ok":)" << (r.range(2) ? "true" : "false") << R"(,"v":)" << r.range(1000) << "}";
+  }
+  os << "]";
+  return os.str();
+}
+
+/** コメントの多い設定ファイル */
+static std::string corpus_config(int scale) {
+  rng r(5);
+  std::ostringstream os;
+  os << "/* generated configuration */\n{\n";
+  for(int s = 0; s < 200 * scale; s++){
+    if(s) os << ",\n";
+    os << "  // section " << s << "\n";
+    os << "  \"section" << s << "\": {\n";
+    os << "    /* block comment\n     * describing the section\n     */\n";
+    for(int k = 0; k < 10; k++){
+      os << "    \"key" << k << "\": " << r.range(10000) << ", // value " << k << "\n";
+    }
+    os << "    \"name\": \"" << word(r) << "\",\n";
+    os << "    \"child\": { \"enabled\": true, \"ratio\": " << r.real(0, 1) << " }\n";
+    os << "  }";
+  }
+  os << "\n}\n";
+  return os.str();
+}
+
+/************** 計測 ***************/
+using bench_clock = std::chrono::steady_clock;
+
+/** f を min_seconds 以上繰り返して 1 回あたりの秒数を返却する */
+template <typename F> static double measure(F&& f, double min_seconds = 0.3) {
+  f(); /** ウォームアップ */
+  std::size_t iterations = 0;
+  const auto start = bench_clock::now();
+  double elapsed = 0;
+  do{
+    f();
+    iterations++;
+    elapsed = std::chrono::duration<double>(bench_clock::now() - start).count();
+  }while(elapsed < min_seconds);
+  return elapsed / iterations;
+}
+
+static json parse(const std::string& s) {
+  std::stringstream ss(s);
+  return deserializer(ss).execute();
+}
+
+static json bench_corpus(const std::string& name, const std::string& text) {
+  const double mb = text.size() / (1024.0 * 1024.0);
+  json doc = parse(text);
+
+  alloc_counter before_parse;
+  parse(text);
+  const auto parse_allocs = before_parse.count_since();
+  const auto parse_alloc_bytes = before_parse.bytes_since();
+
+  const auto parse_sec = measure([&](){ parse(text); });
+
+  std::stringstream reuse_ss(text);
+  deserializer reuse(reuse_ss);
+  json reused;
+  auto parse_reuse = [&](){
+    reuse_ss.clear();
+    reuse_ss.seekg(0);
+    reuse.reset(reuse_ss).execute(reused);
+  };
+  parse_reuse(); /** 木と作業領域を生成する */
+  parse_reuse();
+  alloc_counter before_reuse;
+  parse_reuse();
+  const auto reuse_allocs = before_reuse.count_since();
+  const auto reuse_sec = measure(parse_reuse);
+  const auto validate_sec = measure([&](){
+    std::stringstream ss(text);
+    deserializer(ss).validate();
+  });
+  bool utf8_ok = true;
+  const auto utf8_sec = measure([&](){ utf8_ok = utf8::valid(text) && utf8_ok; });
+  if(!utf8_ok) std::cerr << name << ": invalid utf-8" << std::endl;
+  auto roundtrip = [&](bool raw){
+    std::stringstream ss(text);
+    return serializer(deserializer(ss).raw_numbers(raw).execute()).execute().size();
+  };
+  const auto roundtrip_sec = measure([&](){ roundtrip(false); });
+  const auto raw_roundtrip_sec = measure([&](){ roundtrip(true); });
+  std::size_t serialized_size = 0;
+  const auto serialize_sec = measure([&](){ serialized_size = serializer(doc).execute().size(); });
+  const auto copy_sec = measure([&](){ json copy(doc); });
+  const auto clone_sec = measure([&](){ doc.clone(); });
+
+  std::cerr << name << ": parse " << (mb / parse_sec) << " MB/s, serialize " << (serialized_size / (1024.0 * 1024.0) / serialize_sec) << " MB/s" << std::endl;
+
+  return {
+    {"name", name},
+    {"bytes", text.size()},
+    {"parse_mb_per_sec", mb / parse_sec},
+    {"validate_mb_per_sec", mb / validate_sec},
+    {"utf8_validate_mb_per_sec", mb / utf8_sec},
+    {"serialize_mb_per_sec", serialized_size / (1024.0 * 1024.0) / serialize_sec},
+    {"parse_allocations", parse_allocs},
+    {"parse_allocated_bytes", parse_alloc_bytes},
+    {"parse_reuse_mb_per_sec", mb / reuse_sec},
+    {"parse_reuse_allocations", reuse_allocs},
+    {"roundtrip_mb_per_sec", mb / roundtrip_sec},
+    {"raw_roundtrip_mb_per_sec", mb / raw_roundtrip_sec},
+    {"copy_sec", copy_sec},
+    {"clone_sec", clone_sec}
+  };
+}
+
+static json bench_path_util(const std::string& config) {
+  const json doc = parse(config);
+  std::vector<std::string> paths;
+  for(int s = 0; s < 200; s++){
+    paths.push_back("section" + std::to_string(s) + ".key" + std::to_string(s % 10));
+    paths.push_back("section" + std::to_string(s) + ".child.ratio");
+    paths.push_back("section" + std::to_string(s) + ".missing.key");
+  }
+  std::size_t found = 0;
+  const auto sec = measure([&](){
+    for(const auto& p : paths){
+      if(path_util::find(doc, p)) found++;
+    }
+  });
+  return {
+    {"name", "path_util_find"},
+    {"lookups_per_sec", paths.size() / sec}
+  };
+}
+
+static json bench_projection(const std::string& text) {
+  const double mb = text.size() / (1024.0 * 1024.0);
+  const projection p({"statuses[*].id", "statuses[*].user.id"});
+  auto parse_projected = [&](){
+    std::stringstream ss(text);
+    return deserializer(ss).project(p).execute();
+  };
+  parse_projected();
+  alloc_counter before;
+  parse_projected();
+  const auto allocs = before.count_since();
+  const auto sec = measure(parse_projected);
+  return {
+    {"name", "projection"},
+    {"parse_mb_per_sec", mb / sec},
+    {"parse_allocations", allocs}
+  };
+}
+
+/** 途中に構文エラーがある入力 */
+static json bench_reject() {
+  std::vector<std::string> inputs;
+  for(int i = 0; i < 100; i++){
+    inputs.push_back(R"({"id":)" + std::to_string(i) + R"(,"name":"user","tags":["a","b"],"value":)" + (i % 2 ? "tru" : "1.5.x") + "}");
+  }
+  std::size_t rejected = 0;
+  const auto throw_sec = measure([&](){
+    for(const auto& s : inputs){
+      std::stringstream ss(s);
+      try{
+        deserializer(ss).execute();
+      }
+      catch(const bad_json&){
+        rejected++;
+      }
+    }
+  });
+  const auto code_sec = measure([&](){
+    for(const auto& s : inputs){
+      std::stringstream ss(s);
+      json j;
+      parse_error e;
+      if(!deserializer(ss).try_execute(j, e)) rejected++;
+    }
+  });
+  return {
+    {"name", "reject_invalid"},
+    {"exception_rejects_per_sec", inputs.size() / throw_sec},
+    {"error_code_rejects_per_sec", inputs.size() / code_sec}
+  };
+}
+
+/** 独立した多数の小さな入力（batch_deserializer と１つの deserializer を入力毎に生成する場合の比較） */
+static json bench_batch(int scale) {
+  std::vector<std::string> inputs;
+  for(int i = 0; i < 2000 * scale; i++){
+    inputs.push_back(R"({"id":)" + std::to_string(i) + R"(,"name":"user)" + std::to_string(i) + R"(","tags":["a","b"],"score":)" + std::to_string(i * 0.25) + "}");
+  }
+  std::size_t parsed = 0;
+  const auto sequential_sec = measure([&](){
+    for(const auto& s : inputs){
+      std::stringstream ss(s);
+      json j;
+      parse_error e;
+      if(deserializer(ss).try_execute(j, e)) parsed++;
+    }
+  });
+  batch_deserializer batch;
+  const auto batch_sec = measure([&](){
+    parsed += batch.execute(inputs).size();
+  });
+  return {
+    {"name", "batch"},
+    {"threads", batch.threads()},
+    {"sequential_docs_per_sec", inputs.size() / sequential_sec},
+    {"batch_docs_per_sec", inputs.size() / batch_sec}
+  };
+}
+
+/** 文字列を複製する場合（deserializer）と入力のバッファを参照する場合（borrowed_deserializer）の比較 */
+static json bench_borrowed(const std::string& text) {
+  const double mb = text.size() / (1024.0 * 1024.0);
+  auto parse_borrowed = [&](){
+    return borrowed_deserializer(text).execute();
+  };
+  parse(text);
+  alloc_counter copied;
+  parse(text);
+  const auto copied_allocs = copied.count_since();
+  parse_borrowed();
+  alloc_counter borrowed;
+  parse_borrowed();
+  const auto borrowed_allocs = borrowed.count_since();
+  const auto copied_sec = measure([&](){ parse(text); });
+  const auto borrowed_sec = measure(parse_borrowed);
+  return {
+    {"name", "borrowed"},
+    {"copied_parse_mb_per_sec", mb / copied_sec},
+    {"copied_parse_allocations", copied_allocs},
+    {"borrowed_parse_mb_per_sec", mb / borrowed_sec},
+    {"borrowed_parse_allocations", borrowed_allocs}
+  };
+}
+
+int main(int argc, char* argv[]) {
+  int scale = 1;
+  std::string out_path;
+  for(int i = 1; i < argc; i++){
+    const std::string arg(argv[i]);
+    if(arg.compare(0, 8, "--scale=") == 0)    { scale = std::max(1, std::atoi(arg.c_str() + 8)); }
+    else if(arg.compare(0, 6, "--out=") == 0) { out_path = arg.substr(6); }
+    else{
+      std::cerr << "usage: " << argv[0] << " [--scale=N] [--out=path]" << std::endl;
+      return 1;
+    }
+  }
+
+  const auto config = corpus_config(scale);
+  json results = json::array_type();
+  auto& arr = results.get<json::array_type>();
+  arr.push_back(bench_corpus("numbers", corpus_numbers(scale)));
+  const auto strings = corpus_strings(scale);
+  arr.push_back(bench_corpus("strings", strings));
+  arr.push_back(bench_corpus("nested", corpus_nested(scale)));
+  arr.push_back(bench_corpus("small_objects", corpus_small_objects(scale)));
+  arr.push_back(bench_corpus("config", config));
+  arr.push_back(bench_path_util(config));
+  arr.push_back(bench_projection(strings));
+  arr.push_back(bench_reject());
+  arr.push_back(bench_batch(scale));
+  arr.push_back(bench_borrowed(strings));
+
+  const json report = {
+    {"scale", scale},
+    {"results", results}
+  };
+  if(out_path.empty()){
+    serializer(report, "  ").execute(std::cout);
+    std::cout << std::endl;
+  }
+  else{
+    std::ofstream ofs(out_path);
+    serializer(report, "  ").execute(ofs);
+    ofs << std::endl;
+  }
+  return 0;
+}
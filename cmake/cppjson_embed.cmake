@@ -0,0 +1,18 @@
+# cppjson_embed_json(<target> <name> <file>)
+#   <file>（json）をビルド時にスナップショットへ変換し、ヘッダ cppjson_embedded/<name>.h を <target> に追加する。
+#   #include <cppjson_embedded/<name>.h> で cppjson_embedded::<name>() が snapshot_view を返却する。
+#   <file> を変更すると再生成する。生成には cppjson_embed（embed/main.cpp）を使用する。
+function(cppjson_embed_json target name file)
+  get_filename_component(input ${file} ABSOLUTE)
+  set(dir ${CMAKE_CURRENT_BINARY_DIR}/cppjson_embedded)
+  set(output ${dir}/${name}.h)
+  add_custom_command(
+    OUTPUT ${output}
+    COMMAND ${CMAKE_COMMAND} -E make_directory ${dir}
+    COMMAND cppjson_embed ${input} ${output} ${name}
+    DEPENDS cppjson_embed ${input}
+    COMMENT "Embedding ${file} as cppjson_embedded::${name}()"
+    VERBATIM)
+  set_property(TARGET ${target} APPEND PROPERTY SOURCES ${output})
+  target_include_directories(${target} PRIVATE ${CMAKE_CURRENT_BINARY_DIR})
+endfunction()
@@ -0,0 +1,56 @@
+#include <cppjson/cppjson.h>
+#include <iostream>
+#include <fstream>
+#include <cctype>
+
+/**
+ * json ファイルを静的に初期化された読み取り専用のスナップショットとして埋め込むヘッダを生成する（embed.h）。
+ * ビルド時に CMake の cppjson_embed_json()（cmake/cppjson_embed.cmake）から呼び出す。
+ *
+ * cppjson_embed input.json output.h name
+ *   name  生成する関数名（cppjson_embedded::name() が snapshot_view を返却する）
+ **/
+
+using namespace cppjson;
+
+static bool is_identifier(const std::string& s) {
+  if(s.empty() || std::isdigit(static_cast<unsigned char>(s[0]))) return false;
+  for(const auto c : s){
+    if(!std::isalnum(static_cast<unsigned char>(c)) && c != '_') return false;
+  }
+  return true;
+}
+
+int main(int argc, char* argv[]) {
+  if(argc != 4){
+    std::cerr << "usage: " << argv[0] << " input.json output.h name" << std::endl;
+    return 1;
+  }
+  const std::string input(argv[1]);
+  const std::string output(argv[2]);
+  const std::string name(argv[3]);
+  if(!is_identifier(name)){
+    std::cerr << argv[0] << ": invalid name: " << name << std::endl;
+    return 1;
+  }
+
+  std::ifstream ifs(input, std::ios::binary);
+  if(!ifs){
+    std::cerr << argv[0] << ": cannot open " << input << std::endl;
+    return 1;
+  }
+  parse_error error;
+  json j;
+  if(!deserializer(ifs).try_execute(j, error)){
+    std::cerr << input << ": " << error.message() << std::endl;
+    return 1;
+  }
+
+  std::ofstream ofs(output, std::ios::binary);
+  embed_generator(j, name, input.substr(input.find_last_of("/\\") + 1)).execute(ofs);
+  if(!ofs){
+    std::cerr << argv[0] << ": cannot write " << output << std::endl;
+    return 1;
+  }
+  return 0;
+}
@@ -26,7 +26,12 @@ namespace cppjson {
  **/
 
 /** 可変引数テンプレートで array の初期化を行うための json のサブクラス */
-class array : public json {
+template <typename Traits>
+class basic_array : public basic_json<Traits> {
+public:
+  using json_type = basic_json<Traits>;
+  using typename json_type::array_type;
+
 private:
   /** json の配列による設定の継続処理 */
   template <typename T, typename ...ARGS> static void pushValues(array_type& arr, T&& v, ARGS ...args){
@@ -41,12 +46,12 @@ private:
   template <
     typename T,
     std::enable_if_t<
-      json::is_number_type<T>::value ||
-      value_type_traits<T>::available ||
+      json_type::template is_number_type<T>::value ||
+      json_type::template value_type_traits<T>::available ||
       std::is_same<T, const char*>::value ||
-      std::is_same<T, json>::value ||
-      std::is_same<T, array>::value ||
-      std::is_same<T, object>::value
+      std::is_same<T, json_type>::value ||
+      std::is_same<T, basic_array>::value ||
+      std::is_same<T, basic_object<Traits>>::value
       , bool
     > = true
   > static void pushTypedValue(array_type& arr, T&& v) {
@@ -54,41 +59,43 @@ private:
   }
 
 public:
-  template <typename ...ARGS> array(ARGS ...args) {
+  template <typename ...ARGS> basic_array(ARGS ...args) {
     auto arr = array_type();
     pushValues(arr, std::forward<ARGS>(args)...);
-    set(std::move(arr));
+    this->set(std::move(arr));
   }
 
   struct util {
-    template<typename ITER> static json to_json(ITER begin, ITER end) {
-      return create([&](json::array_type& arr){
+    template<typename ITER> static json_type to_json(ITER begin, ITER end) {
+      return create([&](array_type& arr){
         arr.insert(arr.begin(), begin, end);
       });
     }
 
-    template<typename T> static json to_json(const T& src){
+    template<typename T> static json_type to_json(const T& src){
       return to_json(std::cbegin(src), std::cend(src));
     }
 
-    static json create(std::function<void(json::array_type&)> f) {
-      json j = create();
-      f(j.get<json::array_type>());
+    static json_type create(std::function<void(array_type&)> f) {
+      json_type j = create();
+      f(j.template get<array_type>());
       return j;
     }
 
-    static json create() {
-      return json::array_type();
+    static json_type create() {
+      return array_type();
     }
 
-    static json& edit(json& j, std::function<void(json::array_type&)> f){
-      auto& arr = j.get<json::array_type>();
+    static json_type& edit(json_type& j, std::function<void(array_type&)> f){
+      auto& arr = j.template get<array_type>();
       f(arr);
       return j;
     }
   };
 };
 
+using array = basic_array<json_traits>;
+
 } /** namespace cppjson */
 
 #endif /** !defined(__cppjson_h_array__) */
\ No newline at end of file
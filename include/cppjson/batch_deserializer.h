@@ -0,0 +1,317 @@
+#if !defined(__cppjson_h_batch_deserializer__)
+#define __cppjson_h_batch_deserializer__
+
+#include "json.h"
+#include "deserializer.h"
+#include <istream>
+#include <fstream>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <exception>
+#include <memory>
+#include <utility>
+#include <vector>
+#include <string>
+#include <algorithm>
+
+namespace cppjson {
+
+/** batch_deserializer の入力毎の結果 */
+struct batch_result {
+  json        value;    /** 解析した値（エラーの場合は undefined） */
+  parse_error error;
+
+  bool ok() const { return error.ok(); }
+};
+
+/**
+ * 互いに独立した多数の入力（バッファ・ファイル・生成関数）をスレッドプールで解析する。
+ * 結果は入力と同じ順序（インデックス）で返却し、ある入力のエラーは他の入力の解析に影響しない。
+ * batch_deserializer batch(8);
+ * auto results = batch.execute(buffers);
+ * if(!results[i].ok()) std::cerr << results[i].error.message();
+ *
+ * 入力のインデックスの範囲をスレッド毎に分割して割り当て、自身の範囲を解析し終えたスレッドは
+ * 他のスレッドの残りの範囲の後半を取得する（work stealing）ため、入力の大きさが偏っていても負荷が均等になる。
+ * 各スレッドは deserializer と読み出し用の領域を保持し、入力毎に reset() して再利用する。
+ * スレッドは最初の execute() で生成してデストラクタまで再利用し、execute() を呼び出したスレッドも解析に加わる。
+ * execute() を複数のスレッドから同時に呼び出さないこと。
+ **/
+class batch_deserializer {
+public:
+  /** スレッド毎の deserializer の設定（raw_numbers() 等）。dedup() 等のスレッド間で共有する状態は設定しないこと */
+  using configurator = std::function<void(deserializer&)>;
+
+  /** 次の入力を s に設定して true を返却する（入力が無ければ false）。同時に複数のスレッドから呼び出すことはない */
+  using producer = std::function<bool(std::string& s)>;
+
+private:
+  /** スレッド毎の状態 */
+  struct worker {
+    const std::size_t index;
+    memory_buffer     buffer;
+    std::istream      is;
+    std::unique_ptr<deserializer> parser;
+    std::string       input;        /** ファイル・生成関数の入力（容量を再利用する） */
+    std::mutex        mutex;        /** begin / end を保護する */
+    std::size_t       begin;        /** 未解析の入力のインデックスの範囲 */
+    std::size_t       end;
+
+    explicit worker(std::size_t i) : index(i), is(&buffer), begin(0), end(0) {}
+  };
+
+  const std::size_t                     m_threads;
+  configurator                          m_configure;
+  bool                                  m_configured;
+  std::vector<std::unique_ptr<worker>>  m_workers;    /** [0] は execute() を呼び出したスレッドが使用する */
+  std::vector<std::thread>              m_pool;
+
+  std::mutex                            m_mutex;
+  std::condition_variable               m_start;
+  std::condition_variable               m_finish;
+  std::function<void(worker&)>          m_job;
+  uint64_t                              m_generation;
+  std::size_t                           m_running;
+  bool                                  m_stop;
+  std::exception_ptr                    m_exception;
+
+  void run(std::size_t w) {
+    uint64_t generation = 0;
+    for(;;){
+      std::unique_lock<std::mutex> lock(m_mutex);
+      m_start.wait(lock, [&](){ return m_stop || m_generation != generation; });
+      if(m_stop) return;
+      generation = m_generation;
+      lock.unlock();
+      m_job(*m_workers[w]);
+      lock.lock();
+      if(--m_running == 0) m_finish.notify_all();
+    }
+  }
+
+  void prepare() {
+    if(m_workers.empty()){
+      for(std::size_t i = 0; i < m_threads; i++){
+        m_workers.emplace_back(new worker(i));
+      }
+      for(std::size_t i = 1; i < m_threads; i++){
+        m_pool.emplace_back([this, i](){ run(i); });
+      }
+    }
+    if(!m_configured){
+      for(auto& w : m_workers){
+        w->parser.reset(new deserializer(w->is));
+        if(m_configure) m_configure(*w->parser);
+      }
+      m_configured = true;
+    }
+  }
+
+  /** 全てのスレッドで job を実行し、終了を待つ */
+  void dispatch(const std::function<void(worker&)>& job) {
+    {
+      std::lock_guard<std::mutex> lock(m_mutex);
+      m_job = job;
+      m_running = m_pool.size();
+      m_exception = nullptr;
+      m_generation++;
+    }
+    m_start.notify_all();
+    job(*m_workers[0]);
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_finish.wait(lock, [&](){ return m_running == 0; });
+    m_job = nullptr;
+    if(m_exception){
+      auto e = m_exception;
+      m_exception = nullptr;
+      lock.unlock();
+      std::rethrow_exception(e);
+    }
+  }
+
+  /** f の例外を記録する（最初の例外を execute() で再送出する） */
+  template <typename F> bool guarded(F&& f) {
+    try{
+      f();
+      return true;
+    }
+    catch(...){
+      std::lock_guard<std::mutex> lock(m_mutex);
+      if(!m_exception) m_exception = std::current_exception();
+      return false;
+    }
+  }
+
+  /** 自身の範囲から次のインデックスを取得する */
+  bool next_index(worker& self, std::size_t& i) {
+    {
+      std::lock_guard<std::mutex> lock(self.mutex);
+      if(self.begin < self.end){
+        i = self.begin++;
+        return true;
+      }
+    }
+    return steal(self, i);
+  }
+
+  /** 他のスレッドの残りの範囲の後半を取得する */
+  bool steal(worker& self, std::size_t& i) {
+    for(std::size_t k = 1; k < m_workers.size(); k++){
+      auto& victim = *m_workers[(self.index + k) % m_workers.size()];
+      std::size_t begin = 0;
+      std::size_t end = 0;
+      {
+        std::lock_guard<std::mutex> lock(victim.mutex);
+        const auto remaining = victim.end - victim.begin;
+        if(remaining == 0) continue;
+        begin = victim.end - (remaining + 1) / 2;
+        end = victim.end;
+        victim.end = begin;
+      }
+      std::lock_guard<std::mutex> lock(self.mutex);
+      i = begin;
+      self.begin = begin + 1;
+      self.end = end;
+      return true;
+    }
+    return false;
+  }
+
+  static void parse(worker& self, const char* data, std::size_t size, batch_result& r) {
+    self.buffer.reset(data, size);
+    self.is.clear();
+    self.parser->reset(self.is);
+    if(!self.parser->try_execute(r.value, r.error)){
+      r.value = json();
+    }
+  }
+
+  static bool read_file(const std::string& path, std::string& s) {
+    std::ifstream ifs(path, std::ios::binary);
+    if(!ifs) return false;
+    ifs.seekg(0, std::ios::end);
+    const auto size = ifs.tellg();
+    if(size < 0) return false;
+    ifs.seekg(0, std::ios::beg);
+    s.resize(static_cast<std::size_t>(size));
+    ifs.read(&s[0], size);
+    return ifs.gcount() == size;
+  }
+
+  /** 0 から n - 1 までの入力を work stealing で解析する */
+  template <typename F>
+  std::vector<batch_result> execute_indexed(std::size_t n, F&& f) {
+    std::vector<batch_result> results(n);
+    prepare();
+    const auto count = m_workers.size();
+    for(std::size_t w = 0; w < count; w++){
+      std::lock_guard<std::mutex> lock(m_workers[w]->mutex);
+      m_workers[w]->begin = n * w / count;
+      m_workers[w]->end = n * (w + 1) / count;
+    }
+    dispatch([&](worker& self){
+      std::size_t i = 0;
+      while(next_index(self, i)){
+        guarded([&](){ f(self, i, results[i]); });
+      }
+    });
+    return results;
+  }
+
+public:
+  /** threads が 0 の場合は CPU のコア数とする */
+  explicit batch_deserializer(std::size_t threads = 0) :
+    m_threads(threads != 0 ? threads : std::max(1u, std::thread::hardware_concurrency())),
+    m_configured(false), m_generation(0), m_running(0), m_stop(false)
+  {
+  }
+
+  batch_deserializer(const batch_deserializer&) = delete;
+  batch_deserializer& operator =(const batch_deserializer&) = delete;
+
+  ~batch_deserializer() {
+    {
+      std::lock_guard<std::mutex> lock(m_mutex);
+      m_stop = true;
+    }
+    m_start.notify_all();
+    for(auto& t : m_pool){
+      t.join();
+    }
+  }
+
+  /** 各スレッドの deserializer を既定の設定から f で設定し直す（次の execute() から適用する） */
+  batch_deserializer& configure(const configurator& f) {
+    m_configure = f;
+    m_configured = false;
+    return *this;
+  }
+
+  std::size_t threads() const { return m_threads; }
+
+  /** buffers[i] の解析結果を results[i] に返却する（バッファは複製しない） */
+  std::vector<batch_result> execute(const std::vector<std::string>& buffers) {
+    return execute_indexed(buffers.size(), [&](worker& self, std::size_t i, batch_result& r){
+      parse(self, buffers[i].data(), buffers[i].size(), r);
+    });
+  }
+
+  /** paths[i] のファイルの解析結果を results[i] に返却する。読み出せない場合は parse_errc::io_error */
+  std::vector<batch_result> execute_files(const std::vector<std::string>& paths) {
+    return execute_indexed(paths.size(), [&](worker& self, std::size_t i, batch_result& r){
+      if(!read_file(paths[i], self.input)){
+        r.error.code = parse_errc::io_error;
+        r.error.reason = "cannot read file : ";
+        r.error.detail = paths[i];
+        return;
+      }
+      parse(self, self.input.data(), self.input.size(), r);
+    });
+  }
+
+  /**
+   * next が false を返却するまで入力を取得して解析し、取得した順序で結果を返却する。
+   * next は排他的に呼び出し、取得した入力はそのスレッドが解析する（入力の取得と解析が重なる）。
+   **/
+  std::vector<batch_result> execute(const producer& next) {
+    prepare();
+    std::mutex mutex;
+    std::size_t produced = 0;
+    bool done = false;
+    std::vector<std::vector<std::pair<std::size_t, batch_result>>> parsed(m_workers.size());
+    dispatch([&](worker& self){
+      auto& out = parsed[self.index];
+      for(;;){
+        std::size_t i = 0;
+        {
+          std::lock_guard<std::mutex> lock(mutex);
+          if(done) return;
+          bool more = false;
+          if(!guarded([&](){ more = next(self.input); }) || !more){
+            done = true;
+            return;
+          }
+          i = produced++;
+        }
+        if(!guarded([&](){
+          out.emplace_back(i, batch_result());
+          parse(self, self.input.data(), self.input.size(), out.back().second);
+        })){
+          return;
+        }
+      }
+    });
+    std::vector<batch_result> results(produced);
+    for(auto& out : parsed){
+      for(auto& r : out){
+        results[r.first] = std::move(r.second);
+      }
+    }
+    return results;
+  }
+};
+
+} /** namespace cppjson */
+#endif /* !defined(__cppjson_h_batch_deserializer__) */
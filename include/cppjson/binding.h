@@ -0,0 +1,89 @@
+#if !defined(__cppjson_h_binding__)
+#define __cppjson_h_binding__
+
+#include <tuple>
+#include <utility>
+#include <type_traits>
+#if __cplusplus >= 201703L
+#include <optional>
+#endif
+
+namespace cppjson {
+
+/**
+ * 構造体と json の直接変換（中間の json を生成しない）のための宣言。
+ * 構造体のメンバとキーの対応を CPPJSON_BINDING で登録すると、
+ * deserializer は入力から構造体へ直接値を設定し、serializer は構造体から直接出力する。
+ * struct item { std::string name; double price; };
+ * struct order { int id; std::vector<item> items; std::map<std::string, int> counts; std::string memo; };
+ * CPPJSON_BINDING(item, CPPJSON_FIELD(name), CPPJSON_FIELD(price))
+ * CPPJSON_BINDING(order, CPPJSON_FIELD(id), CPPJSON_FIELD(items), CPPJSON_FIELD(counts), CPPJSON_OPTIONAL_FIELD(memo))
+ *
+ * 登録されたメンバに対応するキーが入力に存在しない場合は bad_json となる。
+ * CPPJSON_OPTIONAL_FIELD で登録したメンバは、キーが存在しなくてもエラーとせずメンバの値を変更しない。
+ * C++17 以降では std::optional のメンバも使用でき、null またはキーが存在しない場合は空となる。
+ * 登録されていないキーは読み飛ばす。
+ **/
+
+/** 構造体のメンバとキーの対応 */
+template <typename CLASS, typename T> struct binding_field {
+  using value_type = T;
+  const char*   name;
+  T CLASS::*    member;
+  bool          optional;
+};
+
+template <typename CLASS, typename T>
+constexpr binding_field<CLASS, T> make_binding_field(const char* name, T CLASS::* member, bool optional = false) {
+  return binding_field<CLASS, T>{name, member, optional};
+}
+
+/** 構造体の登録情報（CPPJSON_BINDING で特殊化する） */
+template <typename T> struct binding {
+  static constexpr bool available = false;
+};
+
+/** 値が空であることを表現できる型か（空の場合はキーを省略可能） */
+template <typename T> struct binding_is_optional : public std::false_type {};
+#if __cplusplus >= 201703L
+template <typename T> struct binding_is_optional<std::optional<T>> : public std::true_type {};
+#endif
+
+/** 登録された各メンバに対して f(field, index) を呼び出す */
+template <typename TUPLE, typename F, std::size_t ...I>
+void for_each_binding_field(TUPLE&& fields, F&& f, std::index_sequence<I...>) {
+  using expander = int[];
+  (void)expander{0, (f(std::get<I>(fields), I), 0)...};
+}
+
+template <typename TUPLE, typename F>
+void for_each_binding_field(TUPLE&& fields, F&& f) {
+  for_each_binding_field(
+    std::forward<TUPLE>(fields), std::forward<F>(f),
+    std::make_index_sequence<std::tuple_size<std::decay_t<TUPLE>>::value>()
+  );
+}
+
+} /** namespace cppjson */
+
+/** 構造体を登録する（グローバル名前空間で使用する） */
+#define CPPJSON_BINDING(TYPE, ...) \
+  namespace cppjson { \
+    template <> struct binding<TYPE> { \
+      using binding_type = TYPE; \
+      static constexpr bool available = true; \
+      static auto fields() { return std::make_tuple(__VA_ARGS__); } \
+    }; \
+  }
+
+/** 必須のメンバ（キーはメンバ名） */
+#define CPPJSON_FIELD(NAME) ::cppjson::make_binding_field(#NAME, &binding_type::NAME)
+
+/** 省略可能なメンバ（キーはメンバ名） */
+#define CPPJSON_OPTIONAL_FIELD(NAME) ::cppjson::make_binding_field(#NAME, &binding_type::NAME, true)
+
+/** キーとメンバ名が異なる場合 */
+#define CPPJSON_NAMED_FIELD(KEY, NAME) ::cppjson::make_binding_field(KEY, &binding_type::NAME)
+#define CPPJSON_NAMED_OPTIONAL_FIELD(KEY, NAME) ::cppjson::make_binding_field(KEY, &binding_type::NAME, true)
+
+#endif /* !defined(__cppjson_h_binding__) */
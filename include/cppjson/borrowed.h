@@ -0,0 +1,265 @@
+#if !defined(__cppjson_h_borrowed__)
+#define __cppjson_h_borrowed__
+
+#include "json.h"
+#include "utf8.h"
+#include <string>
+#include <atomic>
+#include <algorithm>
+#include <functional>
+#include <cstring>
+#include <ostream>
+
+namespace cppjson {
+
+/**
+ * 入力のバッファの一部を参照する文字列（borrowed_json の string_type）。
+ * borrowed_deserializer が生成した値は入力の範囲を参照するだけで、文字を複製しない。
+ * エスケープ（\n・\uXXXX 等）を含む文字列は入力の範囲（引用符を除く）のまま保持し、最初に参照した時点で変換する。
+ * 変換の結果は内部に保持し、複数のスレッドから同時に参照してもよい。
+ *
+ * const char* / (const char*, size_t) から構築した場合と、変更（+= / clear()）した場合は自身で領域を保持する。
+ * 入力の範囲を参照している文字列（is_borrowed()）は、入力のバッファより長く使用しないこと。
+ **/
+class borrowed_string {
+private:
+  const char*                       m_data;     /** 参照する範囲（nullptr の場合は m_text を所有する） */
+  std::size_t                       m_size;
+  bool                              m_literal;  /** m_data が変換前の文字列リテラルの内容 */
+  mutable std::atomic<std::string*> m_text;     /** 所有する文字列、または m_literal を変換した結果 */
+
+  explicit borrowed_string(const char* s, std::size_t n, bool literal, int) :
+    m_data(s), m_size(n), m_literal(literal), m_text(nullptr) {}
+
+  /**
+   * 文字列リテラルの内容（引用符を除く）を変換する。deserializer が受理した範囲であること。
+   * 不正な UTF-8 の並びと対になっていないサロゲートは U+FFFD とする（utf8_policy::replace で受理した場合と同じ結果）。
+   **/
+  static void unescape(const char* s, std::size_t n, std::string& out) {
+    out.reserve(n);
+    std::size_t i = 0;
+    while(i < n){
+      const auto c = static_cast<unsigned char>(s[i]);
+      if(c == '\\'){
+        const char e = s[i + 1];
+        switch(e){
+          case 'b': { out += '\b'; break; }
+          case 'f': { out += '\f'; break; }
+          case 'n': { out += '\n'; break; }
+          case 'r': { out += '\r'; break; }
+          case 't': { out += '\t'; break; }
+          case 'u': {
+            auto unit = hex4(s + i + 2);
+            i += 6;
+            if(utf8::is_high_surrogate(unit) && i + 6 <= n && s[i] == '\\' && s[i + 1] == 'u'){
+              const auto low = hex4(s + i + 2);
+              if(utf8::is_low_surrogate(low)){
+                utf8::append(out, utf8::combine(unit, low));
+                i += 6;
+                continue;
+              }
+            }
+            if(utf8::is_high_surrogate(unit) || utf8::is_low_surrogate(unit)){
+              unit = utf8::replacement_character;
+            }
+            utf8::append(out, unit);
+            continue;
+          }
+          default: { out += e; break; } /** " \ / */
+        }
+        i += 2;
+      }
+      else if(c >= 0x80){
+        std::size_t invalid = 0;
+        const auto len = utf8::sequence_length(bounded{s + i, n - i}, invalid);
+        if(len == 0){
+          utf8::append(out, utf8::replacement_character);
+          i += invalid;
+        }
+        else{
+          out.append(s + i, len);
+          i += len;
+        }
+      }
+      else{
+        out += static_cast<char>(c);
+        i++;
+      }
+    }
+  }
+
+  /** 末尾の後を '\0' として読み出す（utf8::sequence_length 用） */
+  struct bounded {
+    const char* s;
+    std::size_t n;
+    char operator [](std::size_t i) const { return i < n ? s[i] : '\0'; }
+  };
+
+  static uint32_t hex4(const char* s) {
+    uint32_t v = 0;
+    for(std::size_t i = 0; i < 4; i++){
+      const char c = s[i];
+      v <<= 4;
+      if('0' <= c && c <= '9')      { v |= c - '0'; }
+      else if('a' <= c && c <= 'f') { v |= c - 'a' + 10; }
+      else                          { v |= c - 'A' + 10; }
+    }
+    return v;
+  }
+
+  /** 参照している文字列（m_literal の場合は変換した結果） */
+  const std::string* text() const {
+    auto t = m_text.load(std::memory_order_acquire);
+    if(t || !m_literal) return t;
+    auto decoded = new std::string();
+    unescape(m_data, m_size, *decoded);
+    if(!m_text.compare_exchange_strong(t, decoded, std::memory_order_acq_rel)){
+      delete decoded; /** 他のスレッドが先に変換した */
+      return t;
+    }
+    return decoded;
+  }
+
+  /** 変更する前に、自身で領域を保持する */
+  std::string& own() {
+    if(m_data){
+      auto t = new std::string(data(), size());
+      delete m_text.exchange(t, std::memory_order_relaxed);
+      m_data = nullptr;
+      m_size = 0;
+      m_literal = false;
+    }
+    return *m_text.load(std::memory_order_relaxed);
+  }
+
+public:
+  borrowed_string() : borrowed_string("", 0, false, 0) {}
+  borrowed_string(const char* s) : borrowed_string(s, std::strlen(s)) {}
+  borrowed_string(const char* s, std::size_t n) : m_data(nullptr), m_size(0), m_literal(false), m_text(new std::string(s, n)) {}
+  explicit borrowed_string(const std::string& s) : borrowed_string(s.data(), s.size()) {}
+
+  /** 入力の範囲をそのまま参照する（複製しない） */
+  static borrowed_string view(const char* s, std::size_t n) { return borrowed_string(s, n, false, 0); }
+
+  /** 文字列リテラルの内容（引用符を除く、エスケープを含む）を参照し、最初に参照した時点で変換する */
+  static borrowed_string literal(const char* s, std::size_t n) { return borrowed_string(s, n, true, 0); }
+
+  /** 入力の範囲を参照している場合は範囲を複製し、自身で保持している場合は文字列を複製する */
+  borrowed_string(const borrowed_string& src) : m_data(src.m_data), m_size(src.m_size), m_literal(src.m_literal), m_text(nullptr) {
+    if(!m_data) m_text.store(new std::string(*src.m_text.load(std::memory_order_acquire)), std::memory_order_relaxed);
+  }
+
+  borrowed_string(borrowed_string&& src) : m_data(src.m_data), m_size(src.m_size), m_literal(src.m_literal), m_text(src.m_text.exchange(nullptr)) {
+    src.m_data = "";
+    src.m_size = 0;
+    src.m_literal = false;
+  }
+
+  ~borrowed_string() { delete m_text.load(std::memory_order_relaxed); }
+
+  borrowed_string& operator =(const borrowed_string& src) {
+    if(this != &src) *this = borrowed_string(src);
+    return *this;
+  }
+
+  borrowed_string& operator =(borrowed_string&& src) {
+    if(this == &src) return *this;
+    delete m_text.exchange(src.m_text.exchange(nullptr), std::memory_order_relaxed);
+    m_data = src.m_data;
+    m_size = src.m_size;
+    m_literal = src.m_literal;
+    src.m_data = "";
+    src.m_size = 0;
+    src.m_literal = false;
+    return *this;
+  }
+
+  /** 入力の範囲を参照している（入力のバッファより長く使用できない） */
+  bool is_borrowed() const { return m_data != nullptr; }
+
+  const char* data() const {
+    const auto t = text();
+    return t ? t->data() : m_data;
+  }
+
+  std::size_t size() const {
+    const auto t = text();
+    return t ? t->size() : m_size;
+  }
+
+  std::size_t length() const { return size(); }
+  bool empty() const { return size() == 0; }
+
+  /** 自身で保持している領域の大きさ（参照している場合は 0） */
+  std::size_t capacity() const { return m_data ? 0 : m_text.load(std::memory_order_relaxed)->capacity(); }
+
+  const char* begin() const { return data(); }
+  const char* end() const { return data() + size(); }
+  char operator [](std::size_t i) const { return data()[i]; }
+
+  std::string str() const { return std::string(data(), size()); }
+
+  borrowed_string& operator +=(char c) {
+    own() += c;
+    return *this;
+  }
+
+  borrowed_string& operator +=(const std::string& s) {
+    own() += s;
+    return *this;
+  }
+
+  void clear() { own().clear(); }
+
+  int compare(const char* s, std::size_t n) const {
+    const auto m = size();
+    const auto r = std::memcmp(data(), s, std::min(m, n));
+    if(r != 0) return r;
+    return m < n ? -1 : m > n ? 1 : 0;
+  }
+
+  int compare(const borrowed_string& s) const { return compare(s.data(), s.size()); }
+
+  friend bool operator ==(const borrowed_string& a, const borrowed_string& b) { return a.size() == b.size() && a.compare(b) == 0; }
+  friend bool operator !=(const borrowed_string& a, const borrowed_string& b) { return !(a == b); }
+  friend bool operator <(const borrowed_string& a, const borrowed_string& b)  { return a.compare(b) < 0; }
+  friend bool operator ==(const borrowed_string& a, const char* b)            { return a.compare(b, std::strlen(b)) == 0; }
+  friend bool operator ==(const borrowed_string& a, const std::string& b)     { return a.compare(b.data(), b.size()) == 0; }
+  friend bool operator !=(const borrowed_string& a, const char* b)            { return !(a == b); }
+  friend bool operator !=(const borrowed_string& a, const std::string& b)     { return !(a == b); }
+
+  friend std::ostream& operator <<(std::ostream& os, const borrowed_string& s) {
+    return os.write(s.data(), s.size());
+  }
+};
+
+/**
+ * 文字列と object のキーに borrowed_string を使用する basic_json の特性。
+ * borrowed_deserializer で入力のバッファを参照する文書（borrowed_json）を生成する。
+ **/
+struct borrowed_traits {
+  using string_type = borrowed_string;
+  template <typename J> using array_type = std::vector<J>;
+  template <typename J> using object_type = std::unordered_map<borrowed_string, J>;
+  template <typename T> using allocator_type = std::allocator<T>;
+};
+
+using borrowed_json = basic_json<borrowed_traits>;
+
+} /** namespace cppjson */
+
+namespace std {
+  /** 内容（変換後の文字列）のハッシュ（FNV-1a） */
+  template <> struct hash<cppjson::borrowed_string> {
+    std::size_t operator ()(const cppjson::borrowed_string& s) const {
+      uint64_t h = 0xcbf29ce484222325ull;
+      for(const auto c : s){
+        h ^= static_cast<unsigned char>(c);
+        h *= 0x100000001b3ull;
+      }
+      return static_cast<std::size_t>(h);
+    }
+  };
+}
+
+#endif /* !defined(__cppjson_h_borrowed__) */
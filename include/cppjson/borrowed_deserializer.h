@@ -0,0 +1,84 @@
+#if !defined(__cppjson_h_borrowed_deserializer__)
+#define __cppjson_h_borrowed_deserializer__
+
+#include "json.h"
+#include "borrowed.h"
+#include "deserializer.h"
+#include <istream>
+#include <string>
+
+namespace cppjson {
+
+/**
+ * 入力のバッファを参照する文書（borrowed_json）を生成する deserializer。
+ * 文字列の値と object のキーは入力の範囲を参照する borrowed_string とし、文字を複製しない。
+ * エスケープを含む文字列は入力の範囲のまま保持し、最初に参照した時点で変換する。
+ * 入力のバッファ（mmap した領域・受信バッファ等）が生成した文書より長く存在し、変更されない場合に使用する。
+ * borrowed_deserializer d(buffer.data(), buffer.size());
+ * auto doc = d.execute();
+ * doc.get<borrowed_json::object_type>().at("name").get<borrowed_string>().str();
+ *
+ * 文法・エラーは deserializer と同一で、raw_numbers() / on_invalid_utf8() / instrument() を指定できる。
+ * スキーマ・dedup()・既存の文書の再利用は使用できない。
+ **/
+class borrowed_deserializer {
+private:
+  memory_buffer m_buffer;
+  std::istream  m_is;
+  deserializer  m_deserializer;
+
+public:
+  /** data から size バイトを解析する（data は生成した文書より長く存在すること） */
+  borrowed_deserializer(const char* data, std::size_t size) : m_is(&m_buffer), m_deserializer(m_is) {
+    reset(data, size);
+  }
+
+  /** s は生成した文書より長く存在し、変更されないこと */
+  explicit borrowed_deserializer(const std::string& s) : borrowed_deserializer(s.data(), s.size()) {}
+
+  borrowed_deserializer(const borrowed_deserializer&) = delete;
+  borrowed_deserializer& operator =(const borrowed_deserializer&) = delete;
+
+  /** 入力を data から size バイトに切り替える（設定と作業領域は引き継ぐ） */
+  borrowed_deserializer& reset(const char* data, std::size_t size) {
+    m_buffer.reset(data, size);
+    m_is.clear();
+    m_deserializer.reset(m_is);
+    m_deserializer.m_source = data;
+    return *this;
+  }
+
+  /** deserializer::raw_numbers() */
+  borrowed_deserializer& raw_numbers(bool enable = true) {
+    m_deserializer.raw_numbers(enable);
+    return *this;
+  }
+
+  /** deserializer::on_invalid_utf8() */
+  borrowed_deserializer& on_invalid_utf8(utf8_policy policy) {
+    m_deserializer.on_invalid_utf8(policy);
+    return *this;
+  }
+
+  /** deserializer::instrument() */
+  borrowed_deserializer& instrument(parse_stats& stats) {
+    m_deserializer.instrument(stats);
+    return *this;
+  }
+
+  /** 不正な入力の場合は bad_json を送出する */
+  borrowed_json execute() {
+    borrowed_json j;
+    m_deserializer.execute(j);
+    return j;
+  }
+
+  /** 例外を送出せずに解析する。失敗した場合は false を返却し、error を設定する */
+  bool try_execute(borrowed_json& j, parse_error& error) {
+    j = borrowed_json();
+    return m_deserializer.try_execute(j, error);
+  }
+};
+
+} /** namespace cppjson */
+#endif /* !defined(__cppjson_h_borrowed_deserializer__) */
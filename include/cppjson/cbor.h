@@ -0,0 +1,451 @@
+#if !defined(__cppjson_h_cbor__)
+#define __cppjson_h_cbor__
+
+#include "json.h"
+#include <ostream>
+#include <cstring>
+#include <cmath>
+#include <limits>
+
+namespace cppjson {
+
+/**
+ * CBOR (RFC 8949) との相互変換。
+ * json の型は下記の通りに対応付ける。
+ * integral       <-> unsigned integer (major 0) / negative integer (major 1)
+ * floating_point <-> float (float32 で誤差無く表現できる場合は float32、それ以外は float64)
+ * boolean        <-> simple value true / false
+ * null           <-> simple value null
+ * undefined      <-> simple value undefined
+ * string         <-> text string (major 3)
+ * array          <-> array (major 4)
+ * object         <-> map (major 5、キーは text string)
+ * エンコードは常に長さ付き（definite length）で出力する。
+ * デコードは入れ子の深さを max_depth() で制限し、map のキーが重複する場合は deserializer と同じく最初の値を採用する。
+ **/
+class cbor_serializer {
+private:
+  const json& m_json;
+
+  static void write_head(std::string& out, uint8_t major, uint64_t value) {
+    const uint8_t mt = static_cast<uint8_t>(major << 5);
+    if(value < 24){
+      out += static_cast<char>(mt | value);
+    }
+    else if(value <= 0xFF){
+      out += static_cast<char>(mt | 24);
+      out += static_cast<char>(value);
+    }
+    else if(value <= 0xFFFF){
+      out += static_cast<char>(mt | 25);
+      write_be(out, value, 2);
+    }
+    else if(value <= 0xFFFFFFFFull){
+      out += static_cast<char>(mt | 26);
+      write_be(out, value, 4);
+    }
+    else{
+      out += static_cast<char>(mt | 27);
+      write_be(out, value, 8);
+    }
+  }
+
+  static void write_be(std::string& out, uint64_t value, int bytes) {
+    char buf[8];
+    for(auto i = 0; i < bytes; i++){
+      buf[i] = static_cast<char>(value >> ((bytes - 1 - i) * 8));
+    }
+    out.append(buf, bytes);
+  }
+
+  static void write_double(std::string& out, double v) {
+    const float f = static_cast<float>(v);
+    if(static_cast<double>(f) == v || std::isnan(v)){
+      uint32_t bits;
+      std::memcpy(&bits, &f, sizeof(bits));
+      out += static_cast<char>(0xFA);
+      write_be(out, bits, 4);
+    }
+    else{
+      uint64_t bits;
+      std::memcpy(&bits, &v, sizeof(bits));
+      out += static_cast<char>(0xFB);
+      write_be(out, bits, 8);
+    }
+  }
+
+  static void proceed(std::string& out, const json& j) {
+    switch(j.value_type_id()){
+      case json::value_type_id::integral: {
+        const auto v = j.get<int64_t>();
+        if(v >= 0){
+          write_head(out, 0, static_cast<uint64_t>(v));
+        }
+        else{
+          write_head(out, 1, static_cast<uint64_t>(-(v + 1)));
+        }
+        break;
+      }
+      case json::value_type_id::floating_point: {
+        write_double(out, j.get<double>());
+        break;
+      }
+      case json::value_type_id::raw_number: {
+        proceed(out, j.resolve_number());
+        break;
+      }
+      case json::value_type_id::boolean: {
+        out += static_cast<char>(j.get<bool>() ? 0xF5 : 0xF4);
+        break;
+      }
+      case json::value_type_id::null: {
+        out += static_cast<char>(0xF6);
+        break;
+      }
+      case json::value_type_id::string: {
+        const auto& s = j.get<std::string>();
+        write_head(out, 3, s.size());
+        out.append(s);
+        break;
+      }
+      case json::value_type_id::array: {
+        const auto& arr = j.get<json::array_type>();
+        write_head(out, 4, arr.size());
+        for(const auto& v : arr){
+          proceed(out, v);
+        }
+        break;
+      }
+      case json::value_type_id::object: {
+        const auto& obj = j.get<json::object_type>();
+        write_head(out, 5, obj.size());
+        for(const auto& kv : obj){
+          write_head(out, 3, kv.first.size());
+          out.append(kv.first);
+          proceed(out, kv.second);
+        }
+        break;
+      }
+      case json::value_type_id::undefined: {
+        out += static_cast<char>(0xF7);
+        break;
+      }
+    }
+  }
+
+public:
+  cbor_serializer(const json& j) : m_json(j) {}
+
+  void execute(std::ostream& os) const {
+    const auto s = execute();
+    os.write(s.data(), s.size());
+  }
+
+  void execute(std::string& out) const {
+    proceed(out, m_json);
+  }
+
+  std::string execute() const {
+    std::string out;
+    execute(out);
+    return out;
+  }
+};
+
+/**
+ * CBOR のバイト列から json を生成する。
+ * 入力は連続したバッファを参照するだけでコピーは行わない（バッファは execute() の間有効であること）。
+ * 長さ付きの array / map は要素数分の領域を事前に確保する。
+ * 長さ不定（indefinite length）の入力とタグ（タグは無視して中身を取り出す）にも対応する。
+ **/
+class cbor_deserializer {
+public:
+  /** array / map / タグの入れ子の深さの既定の上限 */
+  static constexpr std::size_t default_max_depth = 512;
+
+private:
+  const uint8_t* m_begin;
+  const uint8_t* m_cur;
+  const uint8_t* m_end;
+  std::size_t    m_max_depth;
+  std::size_t    m_depth;
+
+  [[noreturn]] void throwError(const std::string& err) const {
+    std::stringstream ss;
+    ss << "offset(" << (m_cur - m_begin) << ") : " << err;
+    throw bad_cbor(ss.str());
+  }
+
+  void require(std::size_t n) const {
+    if(static_cast<std::size_t>(m_end - m_cur) < n){
+      throwError("illegal eof");
+    }
+  }
+
+  uint64_t read_be(int bytes) {
+    require(bytes);
+    uint64_t v = 0;
+    for(auto i = 0; i < bytes; i++){
+      v = (v << 8) | m_cur[i];
+    }
+    m_cur += bytes;
+    return v;
+  }
+
+  /** 追加情報（additional information）から引数を読み出す。長さ不定の場合は false を返却する。 */
+  bool read_argument(uint8_t info, uint64_t& value) {
+    if(info < 24){
+      value = info;
+      return true;
+    }
+    switch(info){
+      case 24: { value = read_be(1); return true; }
+      case 25: { value = read_be(2); return true; }
+      case 26: { value = read_be(4); return true; }
+      case 27: { value = read_be(8); return true; }
+      case 31: { return false; }
+      default: {
+        throwError("reserved additional information");
+      }
+    }
+  }
+
+  /** 要素数が残りのバイト数を超えることは無いので、不正な入力で巨大な領域を確保しないよう確認する */
+  std::size_t checked_count(uint64_t n) const {
+    if(n > static_cast<uint64_t>(m_end - m_cur)){
+      throwError("illegal length");
+    }
+    return static_cast<std::size_t>(n);
+  }
+
+  static double half_to_double(uint16_t half) {
+    const int exp = (half >> 10) & 0x1F;
+    const int mant = half & 0x3FF;
+    double v;
+    if(exp == 0)       { v = std::ldexp(mant, -24); }
+    else if(exp != 31) { v = std::ldexp(mant + 1024, exp - 25); }
+    else               { v = (mant == 0) ? std::numeric_limits<double>::infinity() : std::numeric_limits<double>::quiet_NaN(); }
+    return (half & 0x8000) ? -v : v;
+  }
+
+  bool is_break() const {
+    return m_cur < m_end && *m_cur == 0xFF;
+  }
+
+  void read_string(uint8_t major, uint8_t info, std::string& s) {
+    uint64_t len;
+    if(read_argument(info, len)){
+      const auto n = checked_count(len);
+      s.assign(reinterpret_cast<const char*>(m_cur), n);
+      m_cur += n;
+      return;
+    }
+    /** 長さ不定の文字列は同じ major type のチャンクの連結 */
+    while(!is_break()){
+      require(1);
+      const uint8_t ib = *m_cur++;
+      if((ib >> 5) != major || (ib & 0x1F) == 31){
+        throwError("invalid string chunk");
+      }
+      if(!read_argument(ib & 0x1F, len)){
+        throwError("invalid string chunk");
+      }
+      const auto n = checked_count(len);
+      s.append(reinterpret_cast<const char*>(m_cur), n);
+      m_cur += n;
+    }
+    m_cur++; /** break をスキップ */
+  }
+
+  /** 長さ不定（追加情報 31）を許可しない整数・タグの引数を読み出す */
+  void read_definite_argument(uint8_t info, uint64_t& value) {
+    if(!read_argument(info, value)){
+      m_cur--;
+      throwError("invalid additional information");
+    }
+  }
+
+  /** array / map / タグの入れ子の深さを数え、上限を超える入力は拒否する（再帰によるスタックの枯渇を防ぐ） */
+  struct depth_guard {
+    cbor_deserializer& d;
+    explicit depth_guard(cbor_deserializer& owner) : d(owner) {
+      if(++d.m_depth > d.m_max_depth){
+        d.m_depth--;
+        d.throwError("nesting too deep");
+      }
+    }
+    ~depth_guard() { d.m_depth--; }
+  };
+
+  /** キーが重複する場合は、deserializer と同じく最初の値を採用する */
+  void read_member(json::object_type& obj, const std::string& key) {
+    auto it = obj.find(key);
+    if(it != obj.end()){
+      json ignored;
+      deserialize(ignored);
+      return;
+    }
+    deserialize(obj[key]);
+  }
+
+  void read_key(std::string& key) {
+    require(1);
+    const uint8_t ib = *m_cur++;
+    if((ib >> 5) != 3){
+      throwError("object key must be a text string");
+    }
+    read_string(3, ib & 0x1F, key);
+  }
+
+  void deserialize(json& j) {
+    require(1);
+    const uint8_t ib = *m_cur++;
+    const uint8_t major = ib >> 5;
+    const uint8_t info = ib & 0x1F;
+    uint64_t arg = 0;
+
+    switch(major){
+      case 0: {
+        read_definite_argument(info, arg);
+        if(arg > static_cast<uint64_t>(std::numeric_limits<int64_t>::max())){
+          throwError("integer out of range");
+        }
+        j.set(static_cast<int64_t>(arg));
+        return;
+      }
+      case 1: {
+        read_definite_argument(info, arg);
+        if(arg > static_cast<uint64_t>(std::numeric_limits<int64_t>::max())){
+          throwError("integer out of range");
+        }
+        j.set(-1 - static_cast<int64_t>(arg));
+        return;
+      }
+      case 2:
+      case 3: {
+        std::string s;
+        read_string(major, info, s);
+        j.set(std::move(s));
+        return;
+      }
+      case 4: {
+        const depth_guard guard(*this);
+        json::array_type arr;
+        if(read_argument(info, arg)){
+          const auto n = checked_count(arg);
+          arr.resize(n);
+          for(std::size_t i = 0; i < n; i++){
+            deserialize(arr[i]);
+          }
+        }
+        else{
+          while(!is_break()){
+            arr.emplace_back();
+            deserialize(arr.back());
+          }
+          m_cur++;
+        }
+        j.set(std::move(arr));
+        return;
+      }
+      case 5: {
+        const depth_guard guard(*this);
+        json::object_type obj;
+        std::string key;
+        if(read_argument(info, arg)){
+          const auto n = checked_count(arg);
+          obj.reserve(n);
+          for(std::size_t i = 0; i < n; i++){
+            read_key(key);
+            read_member(obj, key);
+          }
+        }
+        else{
+          while(!is_break()){
+            read_key(key);
+            read_member(obj, key);
+          }
+          m_cur++;
+        }
+        j.set(std::move(obj));
+        return;
+      }
+      case 6: {
+        /** タグは無視して中身を取り出す */
+        read_definite_argument(info, arg);
+        const depth_guard guard(*this);
+        deserialize(j);
+        return;
+      }
+      default: {
+        switch(info){
+          case 20: { j.set(false); return; }
+          case 21: { j.set(true); return; }
+          case 22: { j.set(nullptr); return; }
+          case 23: { j = json(); return; }
+          case 25: {
+            j.set(half_to_double(static_cast<uint16_t>(read_be(2))));
+            return;
+          }
+          case 26: {
+            const auto bits = static_cast<uint32_t>(read_be(4));
+            float f;
+            std::memcpy(&f, &bits, sizeof(f));
+            j.set(static_cast<double>(f));
+            return;
+          }
+          case 27: {
+            const auto bits = read_be(8);
+            double d;
+            std::memcpy(&d, &bits, sizeof(d));
+            j.set(d);
+            return;
+          }
+          default: {
+            m_cur--;
+            throwError("unsupported simple value");
+          }
+        }
+      }
+    }
+  }
+
+public:
+  cbor_deserializer(const void* data, std::size_t size)
+    : m_begin(static_cast<const uint8_t*>(data)),
+      m_cur(static_cast<const uint8_t*>(data)),
+      m_end(static_cast<const uint8_t*>(data) + size),
+      m_max_depth(default_max_depth),
+      m_depth(0) {}
+
+  cbor_deserializer(const std::string& s)
+    : cbor_deserializer(s.data(), s.size()) {}
+
+  ~cbor_deserializer() = default;
+
+  /** array / map / タグの入れ子の深さの上限（超える場合は bad_cbor を送出する） */
+  cbor_deserializer& max_depth(std::size_t depth) {
+    m_max_depth = depth;
+    return *this;
+  }
+
+  /** 先頭から１つのデータ項目を読み出す。続けて呼び出すと CBOR シーケンスを順に読み出す。 */
+  json execute() {
+    json j;
+    deserialize(j);
+    return j;
+  }
+
+  void execute(json& j) {
+    deserialize(j);
+  }
+
+  /** 読み出し済みのバイト数 */
+  std::size_t consumed() const { return m_cur - m_begin; }
+
+  /** 全て読み出したか */
+  bool eof() const { return m_cur >= m_end; }
+};
+
+} /** namespace cppjson */
+#endif /* !defined(__cppjson_h_cbor__) */
@@ -2,11 +2,27 @@
 #define __cppjson_h_cppjson__
 
 #include "errors.h"
+#include "utf8.h"
 #include "json.h"
 #include "object.h"
 #include "array.h"
+#include "binding.h"
 #include "deserializer.h"
+#include "push_deserializer.h"
+#include "batch_deserializer.h"
+#include "borrowed_deserializer.h"
 #include "serializer.h"
+#include "cbor.h"
+#include "msgpack.h"
+#include "snapshot.h"
 #include "path_util.h"
+#include "schema.h"
+#include "projection.h"
+#include "memory_usage.h"
+#include "dedup.h"
+#include "patch.h"
+#include "shared_document.h"
+#include "literal.h"
+#include "embed.h"
 
 #endif /** !defined(__cppjson_h_cppjson__) */
\ No newline at end of file
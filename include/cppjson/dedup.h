@@ -0,0 +1,210 @@
+#if !defined(__cppjson_h_dedup__)
+#define __cppjson_h_dedup__
+
+#include "json.h"
+#include <cstring>
+#include <functional>
+#include <unordered_set>
+
+namespace cppjson {
+
+/**
+ * 同一内容の string / array / object を１つの領域で共有する（hash-consing）。
+ * dedup_pool pool;
+ * pool.execute(doc1);  // doc1 内の同一の値を共有する
+ * pool.execute(doc2);  // doc1 と同一の値も共有する
+ *
+ * 子から順に共有済みの値へ置き換えるため、array / object の比較は子の値（またはその領域のアドレス）の比較で済む。
+ * object はキーの順序を区別しない。浮動小数点はビット列で比較する（0.0 と -0.0 は区別する）。
+ * 共有された値は不変として扱われ、非 const で取得した時点で複製される（copy-on-write）。
+ * そのため、execute() の前に取得していた参照は無効になる。
+ * プールは共有した値への参照を保持するため、不要になったら clear() するか破棄すること。
+ * deserializer::dedup() で指定すると、デシリアライズしながら値を共有する。
+ **/
+class dedup_pool {
+private:
+  using value_container = json::value_container;
+
+  /** 共有済みの値（ハッシュ値毎） */
+  std::unordered_map<std::size_t, std::vector<value_container>> m_table;
+  /** 共有済みの値の領域 */
+  std::unordered_set<const void*> m_members;
+  std::size_t m_hits;
+
+  static std::size_t mix(std::size_t h, std::size_t v) {
+    return h ^ (v + 0x9e3779b97f4a7c15ull + (h << 6) + (h >> 2));
+  }
+
+  /** 子の値の同一性（共有済みであれば領域のアドレス、それ以外は値そのもの） */
+  static std::size_t identity_hash(const value_container& v) {
+    std::size_t h = static_cast<std::size_t>(v.value_type_id());
+    switch(v.value_type_id()){
+      case json::value_type_id::integral:       { return mix(h, std::hash<int64_t>()(v.get<int64_t>())); }
+      case json::value_type_id::floating_point: {
+        uint64_t bits;
+        const auto d = v.get<double>();
+        std::memcpy(&bits, &d, sizeof(bits));
+        return mix(h, std::hash<uint64_t>()(bits));
+      }
+      case json::value_type_id::boolean:        { return mix(h, v.get<bool>() ? 1 : 0); }
+      case json::value_type_id::string:
+      case json::value_type_id::array:
+      case json::value_type_id::object:
+      case json::value_type_id::raw_number:     { return mix(h, std::hash<const void*>()(v.payload_address())); }
+      default:                                  { return h; }
+    }
+  }
+
+  static bool identical(const value_container& a, const value_container& b) {
+    if(a.value_type_id() != b.value_type_id()) return false;
+    switch(a.value_type_id()){
+      case json::value_type_id::integral:       { return a.get<int64_t>() == b.get<int64_t>(); }
+      case json::value_type_id::floating_point: {
+        const auto x = a.get<double>();
+        const auto y = b.get<double>();
+        return std::memcmp(&x, &y, sizeof(x)) == 0;
+      }
+      case json::value_type_id::boolean:        { return a.get<bool>() == b.get<bool>(); }
+      case json::value_type_id::string:
+      case json::value_type_id::array:
+      case json::value_type_id::object:
+      case json::value_type_id::raw_number:     { return a.payload_address() == b.payload_address(); }
+      default:                                  { return true; }
+    }
+  }
+
+  /** 子が共有済みであることを前提としたハッシュ値 */
+  static std::size_t shallow_hash(const value_container& v) {
+    std::size_t h = static_cast<std::size_t>(v.value_type_id());
+    switch(v.value_type_id()){
+      case json::value_type_id::string: {
+        return mix(h, std::hash<std::string>()(v.get<std::string>()));
+      }
+      case json::value_type_id::raw_number: {
+        return mix(h, std::hash<std::string>()(v.get<json::raw_number>().text()));
+      }
+      case json::value_type_id::array: {
+        for(const auto& e : v.get<json::array_type>()){
+          h = mix(h, identity_hash(e.m_value));
+        }
+        return h;
+      }
+      case json::value_type_id::object: {
+        /** キーの順序に依存しないよう、各要素のハッシュ値を加算する */
+        std::size_t sum = 0;
+        for(const auto& kv : v.get<json::object_type>()){
+          sum += mix(std::hash<std::string>()(kv.first), identity_hash(kv.second.m_value));
+        }
+        return mix(h, sum);
+      }
+      default: {
+        return identity_hash(v);
+      }
+    }
+  }
+
+  /** 子が共有済みであることを前提とした比較 */
+  static bool shallow_equal(const value_container& a, const value_container& b) {
+    if(a.value_type_id() != b.value_type_id()) return false;
+    switch(a.value_type_id()){
+      case json::value_type_id::string: {
+        return a.get<std::string>() == b.get<std::string>();
+      }
+      case json::value_type_id::raw_number: {
+        return a.get<json::raw_number>().text() == b.get<json::raw_number>().text();
+      }
+      case json::value_type_id::array: {
+        const auto& x = a.get<json::array_type>();
+        const auto& y = b.get<json::array_type>();
+        if(x.size() != y.size()) return false;
+        for(std::size_t i = 0; i < x.size(); i++){
+          if(!identical(x[i].m_value, y[i].m_value)) return false;
+        }
+        return true;
+      }
+      case json::value_type_id::object: {
+        const auto& x = a.get<json::object_type>();
+        const auto& y = b.get<json::object_type>();
+        if(x.size() != y.size()) return false;
+        for(const auto& kv : x){
+          auto it = y.find(kv.first);
+          if(it == y.end() || !identical(kv.second.m_value, it->second.m_value)) return false;
+        }
+        return true;
+      }
+      default: {
+        return identical(a, b);
+      }
+    }
+  }
+
+  /** v の子は共有済みであること。v を共有済みの値に置き換える。 */
+  void intern(value_container& v) {
+    if(!v.is_payload() || m_members.count(v.payload_address())) return;
+    auto& bucket = m_table[shallow_hash(v)];
+    for(const auto& candidate : bucket){
+      if(shallow_equal(candidate, v)){
+        v = candidate.share();
+        m_hits++;
+        return;
+      }
+    }
+    bucket.push_back(v.share());
+    m_members.insert(v.payload_address());
+  }
+
+  void proceed(value_container& v) {
+    if(!v.is_payload() || m_members.count(v.payload_address())) return; /** 共有済みであれば子も共有済み */
+    switch(v.value_type_id()){
+      case json::value_type_id::array: {
+        for(auto& e : v.get<json::array_type>()){
+          proceed(e.m_value);
+        }
+        break;
+      }
+      case json::value_type_id::object: {
+        for(auto& kv : v.get<json::object_type>()){
+          proceed(kv.second.m_value);
+        }
+        break;
+      }
+      default: {
+        break;
+      }
+    }
+    intern(v);
+  }
+
+  friend class deserializer;
+
+  void intern(json& j) {
+    intern(j.m_value);
+  }
+
+public:
+  dedup_pool() : m_hits(0) {}
+  dedup_pool(const dedup_pool&) = delete;
+  dedup_pool& operator =(const dedup_pool&) = delete;
+  ~dedup_pool() = default;
+
+  /** j 内の値を共有済みの値に置き換える */
+  void execute(json& j) {
+    proceed(j.m_value);
+  }
+
+  /** 共有している値の数 */
+  std::size_t size() const { return m_members.size(); }
+
+  /** 共有済みの値に置き換えた回数 */
+  std::size_t hits() const { return m_hits; }
+
+  /** プールが保持している参照を解放する（共有済みの値は引き続き有効） */
+  void clear() {
+    m_table.clear();
+    m_members.clear();
+    m_hits = 0;
+  }
+};
+
+} /** namespace cppjson */
+#endif /* !defined(__cppjson_h_dedup__) */
@@ -2,26 +2,164 @@
 #define __cppjson_h_deserializer__
 
 #include "json.h"
+#include "binding.h"
+#include "schema.h"
+#include "dedup.h"
+#include "projection.h"
+#include "utf8.h"
+#include "borrowed.h"
+#include <streambuf>
 #include <istream>
 #include <array>
+#include <map>
+#include <unordered_map>
+#include <deque>
+#include <chrono>
+#include <functional>
+#include <cerrno>
+#include <cstring>
+#include <cstdlib>
+#include <cmath>
+#include <limits>
+#if __cplusplus >= 201703L
+#include <optional>
+#endif
 
 namespace cppjson {
+
+/**
+ * deserializer の計測値（1 回の execute() 毎）。
+ * deserializer::instrument() で有効にした場合のみ集計し、無効の場合は null 判定以外の処理を行わない。
+ **/
+struct parse_stats {
+  std::size_t bytes = 0;              /** 読み出したバイト数 */
+
+  /** トークン数 */
+  std::size_t objects = 0;
+  std::size_t arrays = 0;
+  std::size_t keys = 0;
+  std::size_t strings = 0;
+  std::size_t integers = 0;
+  std::size_t floats = 0;
+  std::size_t trues = 0;
+  std::size_t falses = 0;
+  std::size_t nulls = 0;
+
+  /** 種類毎のバイト数 */
+  std::size_t whitespace_bytes = 0;   /** 空白・改行 */
+  std::size_t comment_bytes = 0;      /** コメント（開始・終了マークを含む） */
+  std::size_t string_bytes = 0;       /** 文字列とキー（引用符・エスケープを含む） */
+  std::size_t number_bytes = 0;
+
+  std::size_t max_depth = 0;          /** array / object の入れ子の深さ */
+  std::size_t allocations = 0;        /** 木の構築で確保した領域の数（値の保持・object のノード・array のバッファ・文字列） */
+
+  /** 経過時間（ナノ秒）。tokenize_ns は全体から build_ns（木の構築）を除いた時間 */
+  uint64_t tokenize_ns = 0;
+  uint64_t build_ns = 0;
+
+  /** メトリクスへの出力用 */
+  json to_json() const {
+    return {
+      {"bytes", bytes},
+      {"objects", objects},
+      {"arrays", arrays},
+      {"keys", keys},
+      {"strings", strings},
+      {"integers", integers},
+      {"floats", floats},
+      {"trues", trues},
+      {"falses", falses},
+      {"nulls", nulls},
+      {"whitespace_bytes", whitespace_bytes},
+      {"comment_bytes", comment_bytes},
+      {"string_bytes", string_bytes},
+      {"number_bytes", number_bytes},
+      {"max_depth", max_depth},
+      {"allocations", allocations},
+      {"tokenize_ns", tokenize_ns},
+      {"build_ns", build_ns}
+    };
+  }
+};
+
+/** デシリアライズのエラーの種類 */
+enum class parse_errc {
+  none,
+  unexpected_eof,     /** 値の途中で入力が終わった */
+  syntax_error,
+  empty_key,          /** object のキーが空文字列 */
+  invalid_escape,     /** 不正なエスケープ文字 */
+  invalid_unicode,    /** \u に続く 4 文字が 16 進数ではない、または対になっていないサロゲート */
+  control_character,  /** 文字列に制御文字が含まれている */
+  invalid_utf8,       /** 文字列が UTF-8 として不正 */
+  invalid_number,     /** 数値に変換できない（範囲外を含む） */
+  type_mismatch,      /** 構造体バインディングで型が一致しない */
+  missing_key,        /** 構造体バインディングで必須のキーが無い */
+  schema_violation,   /** スキーマ違反 */
+  io_error            /** 入力を読み出せない（batch_deserializer::execute_files()） */
+};
+
+/**
+ * deserializer::try_execute() の結果。エラーが発生した場合のみ真となる。
+ * 位置とエラーの種類のみを記録し、メッセージは message() を呼び出した時点で生成する。
+ **/
+struct parse_error {
+  parse_errc code = parse_errc::none;
+  std::size_t offset = 0;     /** 入力の先頭からのバイト数 */
+  int line = 0;
+  int col = 0;
+  const char* reason = "";    /** エラーの説明（静的な文字列） */
+  std::string detail;         /** 補足（変換できなかった数値・欠けているキー・スキーマ違反の位置と理由） */
+
+  explicit operator bool() const { return code != parse_errc::none; }
+  bool ok() const { return code == parse_errc::none; }
+
+  /** bad_json::what() と同一の書式 */
+  std::string message() const {
+    std::stringstream ss;
+    ss << "line(" << line << "), col(" << col << ") : " << reason << detail;
+    return ss.str();
+  }
+};
+
+/** バッファを複製せずに読み出す streambuf（batch_deserializer / borrowed_deserializer で使用する） */
+class memory_buffer : public std::streambuf {
+public:
+  void reset(const char* data, std::size_t size) {
+    auto p = const_cast<char*>(data);
+    setg(p, p, p + size);
+  }
+};
+
 class deserializer {
+  friend class borrowed_deserializer;
+
 private:
   class stream {
   private:
-    std::istream& m_is;
+    std::istream* m_is;
     int m_line;
     int m_col;
+    std::size_t m_pos;
     std::array<int, 6> m_buff;
 
   public:
     stream(std::istream& stream)
-      : m_line(0), m_col(0), m_is(stream)
     {
+      reset(stream);
+    }
+
+    /** 入力を stream に切り替え、位置を先頭に戻す */
+    void reset(std::istream& stream)
+    {
+      m_is = &stream;
+      m_line = 0;
+      m_col = 0;
+      m_pos = 0;
       for(auto i = 0; i < m_buff.size(); i++){
         char c;
-        if(m_is.get(c)){
+        if(m_is->get(c)){
           m_buff[i] = static_cast<int>(c);
         }
         else{
@@ -34,6 +172,7 @@ private:
       if(m_buff[0] == -1) return;
 
       m_col += n;
+      m_pos += n;
 
       for(auto i = n; i < m_buff.size(); i++){
         m_buff[i - n] = m_buff[i];
@@ -42,7 +181,7 @@ private:
       for(auto i = m_buff.size() - n; i < m_buff.size(); i++)
       {
         char cc;
-        if(m_is.get(cc)){
+        if(m_is->get(cc)){
           m_buff[i] = static_cast<int>(cc);
         }
         else{
@@ -79,14 +218,71 @@ private:
 
     int line() const { return m_line + 1; }
     int col() const { return m_col + 1; }
+    std::size_t position() const { return m_pos; }
   };
 
   stream m_stream;
+  const schema* m_schema;
+  std::vector<std::string> m_schema_path; /** スキーマ違反の位置（エラーメッセージ用） */
+  dedup_pool* m_dedup;
+  bool m_raw_numbers;
+  utf8_policy m_utf8_policy;
+  const projection* m_projection;
+  parse_stats* m_stats;
+  std::function<void(const parse_stats&)> m_on_stats;
+  parse_stats m_own_stats;
+  std::size_t m_depth;
+  parse_error m_error;
+  const char* m_source; /** 入力の先頭（borrowed_deserializer の場合のみ。文字列は入力の範囲を参照する） */
 
-  [[noreturn]] void throwError(const std::string& err) {
-    std::stringstream ss;
-    ss << "line(" << m_stream.line() << "), col(" << m_stream.col() << ") : " << err;
-    throw bad_json(ss.str());
+  using stats_clock = std::chrono::steady_clock;
+
+  /** 木の構築を f で行う（計測が有効な場合は時間を build_ns に計上する） */
+  template <typename F> void build(F&& f)
+  {
+    if(m_stats){
+      const auto start = stats_clock::now();
+      f();
+      m_stats->build_ns += std::chrono::duration_cast<std::chrono::nanoseconds>(stats_clock::now() - start).count();
+    }
+    else{
+      f();
+    }
+  }
+
+  /** 入れ子の深さ（計測が有効な場合のみ） */
+  void enter_container()
+  {
+    if(m_stats){
+      m_depth++;
+      m_stats->max_depth = std::max(m_stats->max_depth, m_depth);
+    }
+  }
+
+  void leave_container()
+  {
+    if(m_stats) m_depth--;
+  }
+
+  /** エラーを記録して false を返却する（例外は送出しない。メッセージは parse_error::message() で生成する） */
+  bool fail(parse_errc code, const char* reason, std::string detail = std::string())
+  {
+    m_error.code = code;
+    m_error.offset = m_stream.position();
+    m_error.line = m_stream.line();
+    m_error.col = m_stream.col();
+    m_error.reason = reason;
+    m_error.detail = std::move(detail);
+    return false;
+  }
+
+  /** 記録したエラーを例外として送出する（execute() 用） */
+  [[noreturn]] void throw_error() const
+  {
+    if(m_error.code == parse_errc::schema_violation){
+      throw schema_violation(m_error.message());
+    }
+    throw bad_json(m_error.message());
   }
 
   static bool is_blacket(char c) {
@@ -117,50 +313,51 @@ private:
     return false;
   }
 
-  void unescape(std::ostream& os)
+  template <typename S>
+  bool unescape(S& s)
   {
     m_stream.next(1); /** \ をスキップ */
     if(m_stream.eof()){
-      throwError("illegal eof");
+      return fail(parse_errc::unexpected_eof, "illegal eof");
     }
     switch(m_stream[0]){
       case '"':
       case '\\':
       case '/':
       {
-        os << m_stream[0];
+        s += m_stream[0];
         m_stream.next(1);
-        return;
+        return true;
       }
       case 'b':
       {
-        os << '\b';
+        s += '\b';
         m_stream.next(1);
-        return;
+        return true;
       }
       case 'f':
       {
-        os << '\f';
+        s += '\f';
         m_stream.next(1);
-        return;
+        return true;
       }
       case 'n':
       {
-        os << '\n';
+        s += '\n';
         m_stream.next(1);
-        return;
+        return true;
       }
       case 'r':
       {
-        os << '\r';
+        s += '\r';
         m_stream.next(1);
-        return;
+        return true;
       }
       case 't':
       {
-        os << '\t';
+        s += '\t';
         m_stream.next(1);
-        return;
+        return true;
       }
       case 'u':
       {
@@ -169,65 +366,68 @@ private:
       }
       default:
       {
-        throwError("invalid escape character");
+        return fail(parse_errc::invalid_escape, "invalid escape character");
       }
     }
     
     /** 4つの HEX 文字からutf16文字コードに変換 */
-    uint16_t unicode = 0;
-    for(auto i = 0; i < 4; i++){
-      unicode <<= 4;
-      switch(m_stream[i]){
-          case '0': { unicode |= 0x0; break; }
-          case '1': { unicode |= 0x1; break; }
-          case '2': { unicode |= 0x2; break; }
-          case '3': { unicode |= 0x3; break; }
-          case '4': { unicode |= 0x4; break; }
-          case '5': { unicode |= 0x5; break; }
-          case '6': { unicode |= 0x6; break; }
-          case '7': { unicode |= 0x7; break; }
-          case '8': { unicode |= 0x8; break; }
-          case '9': { unicode |= 0x9; break; }
-          case 'a':
-          case 'A': { unicode |= 0xA; break; }
-          case 'b':
-          case 'B': { unicode |= 0xB; break; }
-          case 'c':
-          case 'C': { unicode |= 0xC; break; }
-          case 'd':
-          case 'D': { unicode |= 0xD; break; }
-          case 'e':
-          case 'E': { unicode |= 0xE; break; }
-          case 'f':
-          case 'F': { unicode |= 0xF; break; }
-          default: {
-            throwError("invalid unicode character");
-          }
-      }
+    uint32_t unicode = 0;
+    if(!read_hex4(0, unicode)){
+      return fail(parse_errc::invalid_unicode, "invalid unicode character");
     }
-    
     m_stream.next(4);
 
-    /** utf16 -> utf8 へ変換 */
-    if(unicode <= 0x007F){
-      os << static_cast<char>(unicode);
+    /** utf16 -> utf8 へ変換（サロゲートは直後の \uXXXX と対にする） */
+    if(utf8::is_high_surrogate(unicode)){
+      uint32_t low = 0;
+      if(m_stream[0] == '\\' && m_stream[1] == 'u' && read_hex4(2, low) && utf8::is_low_surrogate(low)){
+        m_stream.next(6);
+        utf8::append(s, utf8::combine(unicode, low));
+        return true;
+      }
+      return unpaired_surrogate(s);
     }
-    else if(unicode <= 0x07FF){
-      os << static_cast<char>(0b11000000 + ((unicode >>  6) & 0b00011111))
-         << static_cast<char>(0b10000000 + ( unicode        & 0b00111111));
+    if(utf8::is_low_surrogate(unicode)){
+      return unpaired_surrogate(s);
     }
-    else{
-      os << static_cast<char>(0b11100000 + ((unicode >> 12) & 0b00001111))
-         << static_cast<char>(0b10000000 + ((unicode >>  6) & 0b00111111))
-         << static_cast<char>(0b10000000 + ( unicode        & 0b00111111));
+    utf8::append(s, unicode);
+    return true;
+  }
+
+  /** m_stream[offset] から 4 つの HEX 文字を v に変換する */
+  bool read_hex4(std::size_t offset, uint32_t& v) const
+  {
+    v = 0;
+    for(std::size_t i = 0; i < 4; i++){
+      const char c = m_stream[offset + i];
+      v <<= 4;
+      if('0' <= c && c <= '9')      { v |= c - '0'; }
+      else if('a' <= c && c <= 'f') { v |= c - 'a' + 10; }
+      else if('A' <= c && c <= 'F') { v |= c - 'A' + 10; }
+      else                          { return false; }
     }
-  }  
+    return true;
+  }
 
-  void deserialize_object(json& j)
+  template <typename S>
+  bool unpaired_surrogate(S& s)
   {
-    m_stream.next(1); /** { をスキップ */
+    if(m_utf8_policy == utf8_policy::reject){
+      return fail(parse_errc::invalid_unicode, "unpaired surrogate");
+    }
+    utf8::append(s, utf8::replacement_character);
+    return true;
+  }
 
-    auto obj = json::object_type();
+  /**
+   * object を読み出し、キー毎に on_value(key) を呼び出す（on_value で値を読み出し、失敗した場合は false を返却すること）
+   * key はキーの読み出し先（入れ子の深さ毎の作業領域。validate() ではキーを保持しない discard_string）
+   **/
+  template <typename KEY, typename F> bool read_object(KEY& key, F&& on_value)
+  {
+    m_stream.next(1); /** { をスキップ */
+    if(m_stats) m_stats->objects++;
+    enter_container();
 
     enum class mode {
       find_key_or_close,
@@ -236,7 +436,6 @@ private:
     };
     mode m = mode::find_key_or_close;
 
-    json key;
     while(!m_stream.eof()){
       skip_space_or_comment();
       const char c = m_stream[0];
@@ -244,112 +443,212 @@ private:
         case mode::find_key_or_close: {
           if(c == '}'){
             m_stream.next(1);
-            j.set(std::move(obj));
-            return;
+            leave_container();
+            return true;
           }  
           else if(is_blacket(c)) {
-            deserialize_string(key);
-            if(key.get<std::string>().empty()){
-              throwError("object key is empty");
+            if(!read_string(key)) return false;
+            if(key.empty()){
+              return fail(parse_errc::empty_key, "object key is empty");
             }
+            if(m_stats) m_stats->keys++;
             m = mode::find_separator;
           }
           else {
-            throwError("syntax error");
+            return fail(parse_errc::syntax_error, "syntax error");
           }
           break;
         }
         case mode::find_separator: {
           if(c == ':'){
             m_stream.next(1);
-            json inner;
-            deserialize(inner);
-            obj.insert({key.get<std::string>(), inner});
+            if(!on_value(key)) return false;
             m = mode::find_comma_or_close;
           }
           else {
-            throwError("syntax error");
+            return fail(parse_errc::syntax_error, "syntax error");
           }
           break;
         }
         case mode::find_comma_or_close: {
           if(c == '}'){
             m_stream.next(1);
-            j.set(std::move(obj));
-            return;
+            leave_container();
+            return true;
           }  
           else if(c == ',') {
             m_stream.next(1);
             m = mode::find_key_or_close;
           }
           else {
-            throwError("syntax error");
+            return fail(parse_errc::syntax_error, "syntax error");
           }
           break;
         }
       }
     }
-    throwError("illegal eof");
+    return fail(parse_errc::unexpected_eof, "illegal eof");
   }
 
-  void deserialize_array(json& j)
+  /** array を読み出し、要素毎に on_element() を呼び出す（on_element で値を読み出し、失敗した場合は false を返却すること） */
+  template <typename F> bool read_array(F&& on_element)
   {
     m_stream.next(1); /** [ をスキップ */
-    auto arr = json::array_type();
+    if(m_stats) m_stats->arrays++;
+    enter_container();
+    std::size_t count = 0;
     while(!m_stream.eof()){
       skip_space_or_comment();
       const char c = m_stream[0];
       if(c == ']'){
         m_stream.next(1);
-        j.set(std::move(arr));
-        return;
+        leave_container();
+        return true;
       }
       else if(c == ','){
-        if(arr.size() == 0){
+        if(count == 0){
           /* いきなりカンマ */
-          throwError("syntax error");
+          return fail(parse_errc::syntax_error, "syntax error");
         }
         else{
           m_stream.next(1);
         }
       }
       else{
-        json inner;
-        deserialize(inner);
-        arr.push_back(inner);
+        if(!on_element()) return false;
+        count++;
       }
     }
-    throwError("illegal eof");
+    return fail(parse_errc::unexpected_eof, "illegal eof");
   }
 
-  void deserialize_string(json& j)
+  /** 文字列を読み出す（先頭は blacket であること） */
+  template <typename S>
+  bool read_string(S& s)
   {
+    const auto start = m_stream.position();
     m_stream.next(1); /** blacket をスキップ */
-    std::stringstream ss;
+    s.clear();
     while(!m_stream.eof()){
       const char c = m_stream[0];
       if(is_blacket(c)){
         m_stream.next(1);
-        j.set(ss.str());
-        return;
+        if(m_stats) m_stats->string_bytes += m_stream.position() - start;
+        closed(s, start);
+        return true;
       }
       else if(c == '\\'){
-        unescape(ss);
+        rewritten(s);
+        if(!unescape(s)) return false;
       }
       else if(c == '\r' || c == '\n' || c == '\b' || c == '\f' || c == '\t' ){
-        throwError("string literal cannot contain control codes.");
+        return fail(parse_errc::control_character, "string literal cannot contain control codes.");
+      }
+      else if(static_cast<unsigned char>(c) >= 0x80){
+        std::size_t invalid = 0;
+        const auto n = utf8::sequence_length(m_stream, invalid);
+        if(n == 0){
+          if(m_utf8_policy == utf8_policy::reject){
+            return fail(parse_errc::invalid_utf8, "invalid utf-8 sequence");
+          }
+          rewritten(s);
+          utf8::append(s, utf8::replacement_character);
+          m_stream.next(invalid);
+          continue;
+        }
+        for(std::size_t i = 0; i < n; i++){
+          s += m_stream[i];
+        }
+        m_stream.next(n);
       }
       else{
         m_stream.next(1);
-        ss << c;
+        s += c;
       }
     }
-    throwError("illegal eof");
+    return fail(parse_errc::unexpected_eof, "illegal eof");
+  }
+
+  /**
+   * 文字列を保持せずに、入力の範囲（引用符を除く）と変換の要否のみ記録する（borrowed_json 用）。
+   * length は変換後のバイト数（空のキーの判定用）。
+   **/
+  struct string_slice {
+    std::size_t begin = 0;
+    std::size_t size = 0;
+    std::size_t length = 0;
+    bool rewritten = false;     /** エスケープ・U+FFFD への置き換えを含む */
+    void clear() {
+      length = 0;
+      rewritten = false;
+    }
+    bool empty() const { return length == 0; }
+    string_slice& operator +=(char) {
+      length++;
+      return *this;
+    }
+  };
+
+  /** read_string の読み出し先が string_slice の場合のみ、変換の要否と範囲を記録する */
+  template <typename S> static void rewritten(S&) {}
+  static void rewritten(string_slice& s) { s.rewritten = true; }
+  template <typename S> void closed(S&, std::size_t) const {}
+  void closed(string_slice& s, std::size_t start) const {
+    s.begin = start + 1;
+    s.size = m_stream.position() - start - 2;
   }
 
-  void deserialize_number(json& j)
+  /** string_slice が示す入力の範囲を参照する文字列 */
+  borrowed_string borrow(const string_slice& s) const {
+    return s.rewritten ? borrowed_string::literal(m_source + s.begin, s.size) : borrowed_string::view(m_source + s.begin, s.size);
+  }
+
+  /** 文字列を保持せずに長さのみ数える */
+  struct discard_string {
+    std::size_t length = 0;
+    void clear() { length = 0; }
+    bool empty() const { return length == 0; }
+    discard_string& operator +=(char) {
+      length++;
+      return *this;
+    }
+  };
+
+  /** 値を生成しない deserialize() の読み出し先（validate() / 読み飛ばし用） */
+  struct discard_value {};
+
+  /** 数値の文字列（通常の長さであればスタック上に保持し、領域を確保しない） */
+  class number_text {
+  private:
+    char m_buff[64];
+    std::size_t m_size = 0;
+    std::string m_long;
+  public:
+    number_text& operator +=(char c) {
+      if(m_size + 1 < sizeof(m_buff)){
+        m_buff[m_size] = c;
+      }
+      else{
+        if(m_long.empty()) m_long.assign(m_buff, m_size);
+        m_long += c;
+      }
+      m_size++;
+      return *this;
+    }
+    std::size_t size() const { return m_size; }
+    const char* c_str() {
+      if(m_size + 1 < sizeof(m_buff) || m_long.empty()){
+        m_buff[m_size] = '\0';
+        return m_buff;
+      }
+      return m_long.c_str();
+    }
+  };
+
+  /** 数値を構成する文字を読み出す。浮動小数点の場合は true を返却する。 */
+  template <typename S>
+  bool read_number_token(S& s)
   {
-    std::stringstream ss;
     bool bFloat = false;
     while(!m_stream.eof()){
       const char c = m_stream[0];
@@ -359,34 +658,369 @@ private:
       if(c == '.' || c == 'e' || c == 'E'){
         bFloat = true;
       }
-      ss << c;
+      s += c;
+    }
+    if(m_stats){
+      m_stats->number_bytes += s.size();
+      (bFloat ? m_stats->floats : m_stats->integers)++;
+    }
+    return bFloat;
+  }
+
+  /** 数値を構成する文字を v に変換する（std::stod / std::stoll と同じく先頭から変換できる部分を使用し、範囲外はエラーとする） */
+  template <typename S, typename T>
+  bool to_number(S& s, bool bFloat, T& v)
+  {
+    const char* begin = s.c_str();
+    char* end = nullptr;
+    errno = 0;
+    if(bFloat){
+      const auto d = std::strtod(begin, &end);
+      if(end != begin && errno != ERANGE){
+        v = static_cast<T>(d);
+        return true;
+      }
+    }
+    else{
+      const auto n = std::strtoll(begin, &end, 10);
+      if(end != begin && errno != ERANGE){
+        v = static_cast<T>(n);
+        return true;
+      }
+    }
+    return fail(parse_errc::invalid_number, "cannot convert to number : ", std::string("\"") + s.c_str() + "\"");
+  }
+
+  /************** 作業領域（execute() をまたいで再利用する） ***************/
+  /** 要素のアドレスの集合（オープンアドレス法。reset() で領域を解放しない） */
+  class pointer_set {
+  private:
+    std::vector<const void*> m_slots;
+    std::size_t m_size = 0;
+
+    std::size_t slot(const void* p) const {
+      auto h = static_cast<uint64_t>(reinterpret_cast<std::uintptr_t>(p));
+      h ^= h >> 33;
+      h *= 0xff51afd7ed558ccdull;
+      h ^= h >> 33;
+      return static_cast<std::size_t>(h) & (m_slots.size() - 1);
+    }
+
+    void grow() {
+      std::vector<const void*> old(m_slots.size() * 2, nullptr);
+      old.swap(m_slots);
+      m_size = 0;
+      for(const auto p : old){
+        if(p) insert(p);
+      }
+    }
+
+  public:
+    void reset(std::size_t expected) {
+      std::size_t n = 16;
+      while(n < expected * 2) n <<= 1;
+      m_slots.assign(n, nullptr);
+      m_size = 0;
+    }
+
+    /** 追加した場合は true、既に含まれていた場合は false を返却する */
+    bool insert(const void* p) {
+      if((m_size + 1) * 2 > m_slots.size()) grow();
+      for(auto i = slot(p); ; i = (i + 1) & (m_slots.size() - 1)){
+        if(m_slots[i] == p) return false;
+        if(m_slots[i] == nullptr){
+          m_slots[i] = p;
+          m_size++;
+          return true;
+        }
+      }
+    }
+
+    bool contains(const void* p) const {
+      for(auto i = slot(p); m_slots[i] != nullptr; i = (i + 1) & (m_slots.size() - 1)){
+        if(m_slots[i] == p) return true;
+      }
+      return false;
+    }
+
+    std::size_t size() const { return m_size; }
+  };
+
+  /** object の入れ子の深さ毎の作業領域 */
+  struct level_scratch {
+    std::string key;      /** キーの読み出し先 */
+    pointer_set visited;  /** 再利用する object で、入力に含まれていた要素 */
+    std::vector<char> kept; /** 再利用する object の要素を残すか（列挙順） */
+  };
+
+  /** 要素を追加しても既存の要素の参照が無効にならないよう deque で保持する */
+  std::deque<level_scratch> m_levels;
+  std::size_t m_nesting;
+
+  level_scratch& enter_level()
+  {
+    if(m_nesting == m_levels.size()) m_levels.emplace_back();
+    return m_levels[m_nesting++];
+  }
+
+  void leave_level()
+  {
+    m_nesting--;
+  }
+
+  /** 要素を追加・削除しても他の要素のアドレスが変わらない（ノードで保持する）map */
+  template <typename M> struct is_node_map : std::false_type {};
+  template <typename... A> struct is_node_map<std::map<A...>> : std::true_type {};
+  template <typename... A> struct is_node_map<std::unordered_map<A...>> : std::true_type {};
+
+  /**
+   * j が object であれば、その要素を再利用して上書きする。
+   * 入力に含まれるキーは既存の値へ再帰的にデシリアライズし、入力に含まれないキーは削除する。
+   * キーが重複する場合は、新規に生成する場合と同じく最初の値を採用する。
+   * 入力に含まれていた要素はアドレスで記録するため、要素を追加するとアドレスが変わる map（vector で保持する flat map 等）では
+   * 新規のキーを fresh に生成して最後に移す（std::map / std::unordered_map は直接追加する）。
+   **/
+  template <typename Traits>
+  bool deserialize_object(basic_json<Traits>& j, const schema::node* sn)
+  {
+    using json_type = basic_json<Traits>;
+    const bool recycle = j.value_type_id() == json_type::value_type_id::object && !m_dedup;
+    auto fresh = typename json_type::object_type();
+    auto& level = enter_level();
+    if(recycle) level.visited.reset(j.template get<typename json_type::object_type>().size());
+    std::size_t properties = 0;
+    bool ok = read_object(level.key, [&](const std::string& key){
+      const schema::node* child = nullptr;
+      if(sn){
+        bool allowed;
+        child = m_schema->property_node(*sn, key, allowed);
+        m_schema_path.push_back(key);
+        if(!allowed){
+          return schema_violated(": additional property is not allowed");
+        }
+        if(properties >= sn->max_properties){
+          return schema_violated(": more properties than maxProperties");
+        }
+      }
+      json_type inner;
+      json_type* target = &inner;
+      bool existing = false;
+      if(recycle){
+        auto& obj = j.template get<typename json_type::object_type>();
+        auto it = obj.find(json_type::to_string_type(key));
+        if(it == obj.end() && is_node_map<typename json_type::object_type>::value){
+          build([&](){ it = obj.emplace(json_type::to_string_type(key), json_type()).first; });
+          if(m_stats) m_stats->allocations++;
+        }
+        if(it != obj.end()){
+          existing = true;
+          if(level.visited.insert(&it->second)){
+            target = &it->second;
+          }
+        }
+      }
+      if(!deserialize(*target, child)) return false;
+      if(sn) m_schema_path.pop_back();
+      if(!existing){
+        build([&](){ fresh.insert({json_type::to_string_type(key), std::move(inner)}); });
+        if(m_stats) m_stats->allocations++;
+      }
+      properties = (recycle ? level.visited.size() : 0) + fresh.size();
+      return true;
+    });
+    if(ok && recycle){
+      auto& obj = j.template get<typename json_type::object_type>();
+      if(level.visited.size() != obj.size()){
+        /** 削除すると後続の要素のアドレスが変わる場合があるため、先に列挙順で残す要素を決める */
+        level.kept.clear();
+        for(const auto& kv : obj) level.kept.push_back(level.visited.contains(&kv.second));
+        std::size_t i = 0;
+        for(auto it = obj.begin(); it != obj.end(); i++){
+          if(level.kept[i]) it++;
+          else              it = obj.erase(it);
+        }
+      }
+      build([&](){
+        for(auto& kv : fresh) obj.emplace(kv.first, std::move(kv.second));
+      });
+      if(m_stats) m_stats->allocations += fresh.size();
     }
-    auto&& s = ss.str();
-    try{
-      if(bFloat){
-        auto v = std::stod(ss.str().c_str());
-        j.set(v);
+    leave_level();
+    if(!ok) return false;
+    if(!recycle){
+      build([&](){ j.set(std::move(fresh)); });
+      if(m_stats) m_stats->allocations += 2; /** object とバケット */
+    }
+    intern(j);
+    return true;
+  }
+
+  /** j が array であれば、その要素とバッファを再利用して上書きする（余った要素は削除する） */
+  template <typename Traits>
+  bool deserialize_array(basic_json<Traits>& j, const schema::node* sn)
+  {
+    using json_type = basic_json<Traits>;
+    const bool recycle = j.value_type_id() == json_type::value_type_id::array && !m_dedup;
+    auto fresh = typename json_type::array_type();
+    auto& arr = recycle ? j.template get<typename json_type::array_type>() : fresh;
+    std::size_t count = 0;
+    const bool ok = read_array([&](){
+      if(count == arr.size()){
+        if(m_stats && arr.size() == arr.capacity()) m_stats->allocations++;
+        build([&](){ arr.emplace_back(); });
+      }
+      auto& e = arr[count++];
+      if(sn){
+        m_schema_path.push_back(std::to_string(count - 1));
+        if(count > sn->max_items){
+          return schema_violated(": more items than maxItems");
+        }
+        if(!deserialize(e, m_schema->item_node(*sn, count - 1))) return false;
+        m_schema_path.pop_back();
       }
       else{
-        auto v = std::stoll(ss.str().c_str());
-        j.set(v);
+        if(!deserialize(e)) return false;
       }
+      return true;
+    });
+    if(!ok) return false;
+    if(recycle){
+      if(count < arr.size()) arr.erase(arr.begin() + count, arr.end());
     }
-    catch(std::exception& e){
-      std::stringstream errss;
-      errss << "cannot convert to number : \"" << s << "\" (" << e.what() << ")" << std::endl;
-      throwError(errss.str());
+    else{
+      build([&](){ j.set(std::move(arr)); });
+      if(m_stats) m_stats->allocations++;
     }
+    intern(j);
+    return true;
   }
 
-  void check_value(const std::string& s)
+  /** j が文字列であれば、その領域を再利用する */
+  template <typename Traits>
+  bool deserialize_string(basic_json<Traits>& j)
   {
-    if(s == m_stream.str(s.size())){
-      m_stream.next(s.size());
+    using json_type = basic_json<Traits>;
+    using string_type = typename json_type::string_type;
+    if(j.value_type_id() == json_type::value_type_id::string && !m_dedup){
+      auto& s = j.template get<string_type>();
+      const auto capacity = s.capacity();
+      if(!read_string(s)) return false;
+      if(m_stats){
+        m_stats->strings++;
+        if(s.capacity() != capacity) m_stats->allocations++;
+      }
+      return true;
+    }
+    string_type s;
+    if(!read_string(s)) return false;
+    if(m_stats){
+      m_stats->strings++;
+      m_stats->allocations += (s.capacity() > string_type().capacity()) ? 2 : 1;
+    }
+    build([&](){ j.set(std::move(s)); });
+    intern(j);
+    return true;
+  }
+
+  /**
+   * borrowed_deserializer の場合は、文字列を複製せずに入力の範囲を参照する（エスケープを含む場合は参照した時点で変換する）。
+   * 既存の値の領域は再利用しない。
+   **/
+  bool deserialize_string(borrowed_json& j)
+  {
+    if(!m_source) return deserialize_string<borrowed_traits>(j);
+    string_slice s;
+    if(!read_string(s)) return false;
+    if(m_stats){
+      m_stats->strings++;
+      m_stats->allocations++;
+    }
+    build([&](){ j.set(borrow(s)); });
+    return true;
+  }
+
+  bool deserialize_object(borrowed_json& j, const schema::node* sn)
+  {
+    if(!m_source) return deserialize_object<borrowed_traits>(j, sn);
+    borrowed_json::object_type obj;
+    string_slice key;
+    const bool ok = read_object(key, [&](const string_slice& k){
+      borrowed_json inner;
+      if(!deserialize(inner)) return false;
+      build([&](){ obj.emplace(borrow(k), std::move(inner)); }); /** キーが重複する場合は最初の値 */
+      if(m_stats) m_stats->allocations++;
+      return true;
+    });
+    if(!ok) return false;
+    build([&](){ j.set(std::move(obj)); });
+    if(m_stats) m_stats->allocations += 2; /** object とバケット */
+    return true;
+  }
+
+  /**
+   * 数値の文字列を json::raw_number として生成する（j が raw_number であれば、その領域を再利用する）。
+   * int64_t の範囲の整数は出力しても表記が変わらないため integral とする（"-0" を除く）。
+   **/
+  template <typename Traits>
+  bool deserialize_raw_number(basic_json<Traits>& j, number_text& s, bool bFloat)
+  {
+    using json_type = basic_json<Traits>;
+    using raw_number = typename json_type::raw_number;
+    if(!raw_number::valid(s.c_str(), s.size())){
+      return fail(parse_errc::invalid_number, "cannot convert to number : ", std::string("\"") + s.c_str() + "\"");
+    }
+    if(!bFloat && std::strcmp(s.c_str(), "-0") != 0){
+      errno = 0;
+      const auto v = std::strtoll(s.c_str(), nullptr, 10);
+      if(errno != ERANGE){
+        build([&](){ j.set(static_cast<int64_t>(v)); });
+        return true;
+      }
+    }
+    if(j.value_type_id() == json_type::value_type_id::raw_number && !m_dedup){
+      auto& text = j.template get<raw_number>().m_text;
+      const auto capacity = text.capacity();
+      text.assign(s.c_str(), s.size());
+      if(m_stats && text.capacity() != capacity) m_stats->allocations++;
+      return true;
+    }
+    if(m_stats) m_stats->allocations += (s.size() > std::string().capacity()) ? 2 : 1;
+    build([&](){ j.set(raw_number(std::string(s.c_str(), s.size()), typename raw_number::unchecked())); });
+    intern(j);
+    return true;
+  }
+
+  template <typename Traits>
+  bool deserialize_number(basic_json<Traits>& j)
+  {
+    number_text s;
+    const bool bFloat = read_number_token(s);
+    if(m_raw_numbers){
+      return deserialize_raw_number(j, s, bFloat);
+    }
+    if(bFloat){
+      double v;
+      if(!to_number(s, true, v)) return false;
+      build([&](){ j.set(v); });
     }
     else{
-      throwError("syntax error");
+      int64_t v;
+      if(!to_number(s, false, v)) return false;
+      build([&](){ j.set(v); });
+    }
+    return true;
+  }
+
+  bool check_value(const std::string& s)
+  {
+    if(s == m_stream.str(s.size())){
+      m_stream.next(s.size());
+      if(m_stats){
+        (s[0] == 't' ? m_stats->trues : s[0] == 'f' ? m_stats->falses : m_stats->nulls)++;
+      }
+      return true;
     }
+    return fail(parse_errc::syntax_error, "syntax error");
   } 
 
   void skip_space_or_comment() {
@@ -396,19 +1030,26 @@ private:
       if(c1 == '\r' && c2 == '\n'){
         m_stream.next(2);
         m_stream.newLine();
+        if(m_stats) m_stats->whitespace_bytes += 2;
       }
       else if(c1 == '\r' || c1 == '\n') {
         m_stream.next(1);
         m_stream.newLine();
+        if(m_stats) m_stats->whitespace_bytes++;
       }
       else if(std::isspace(c1)){
         m_stream.next(1);
+        if(m_stats) m_stats->whitespace_bytes++;
       }
       else if(c1 == '/' && c2 == '*'){
+        const auto start = m_stream.position();
         skip_block_comment();
+        if(m_stats) m_stats->comment_bytes += m_stream.position() - start;
       }
       else if(c1 == '/' && c2 == '/'){
+        const auto start = m_stream.position();
         skip_line_comment();
+        if(m_stats) m_stats->comment_bytes += m_stream.position() - start;
       }
       else {
         break;
@@ -434,7 +1075,9 @@ private:
         m_stream.next(2);
         break;
       }
-      m_stream.next(1);
+      else{
+        m_stream.next(1);
+      }
     }
   }
 
@@ -456,65 +1099,656 @@ private:
     }
   }
 
-  void deserialize(json& j)
+  /************** スキーマ検証 ***************/
+  bool schema_violated(const std::string& reason)
+  {
+    std::string detail;
+    for(const auto& p : m_schema_path){
+      detail += "/" + p;
+    }
+    return fail(parse_errc::schema_violation, "schema violation #", detail + reason);
+  }
+
+  /** 値の先頭文字から型を判定し、スキーマで許容されていなければ値を生成する前に中断する */
+  bool check_schema_token(const schema::node& sn, char c)
+  {
+    uint32_t type = 0;
+    if(c == '{')                  type = schema::type_object;
+    else if(c == '[')             type = schema::type_array;
+    else if(is_blacket(c))        type = schema::type_string;
+    else if(c == 't' || c == 'f') type = schema::type_boolean;
+    else if(c == 'n')             type = schema::type_null;
+    else if(is_number_parts(c))   type = schema::type_number | schema::type_integer;
+    else                          return true; /** 構文エラーは deserialize で検出する */
+    if(!schema::accepts(sn, type)){
+      return schema_violated(": unexpected type");
+    }
+    return true;
+  }
+
+  /** 値の生成後の検証（子の properties / items は検証済み） */
+  bool check_schema_value(const schema::node& sn, const json& j)
+  {
+    std::string reason;
+    if(!m_schema->check(sn, j, &reason, false)){
+      return schema_violated(reason);
+    }
+    return true;
+  }
+
+  /** スキーマは json にのみ適用する（json 以外では sn は常に nullptr） */
+  template <typename J>
+  bool check_schema_value(const schema::node&, const J&)
+  {
+    return true;
+  }
+
+  /** dedup() は json にのみ適用する */
+  void intern(json& j)
+  {
+    if(m_dedup) m_dedup->intern(j);
+  }
+
+  template <typename J>
+  void intern(J&)
+  {
+  }
+
+  /** リテラル（true / false / null）を設定する */
+  template <typename J, typename T>
+  void set_literal(J& j, T v)
+  {
+    build([&](){ j.set(v); });
+  }
+
+  template <typename T>
+  void set_literal(discard_value&, T)
+  {
+  }
+
+  /**
+   * 値を読み出して j に生成する（文法の判定はこの関数のみで行う）。
+   * j の型毎に deserialize_object() / deserialize_array() / deserialize_string() / deserialize_number() を用意する。
+   * discard_value の場合は値を生成せずに検証のみ行う。
+   **/
+  template <typename J>
+  bool deserialize(J& j, const schema::node* sn = nullptr)
   {
     while(!m_stream.eof()){
       skip_space_or_comment();
       const char c = m_stream[0];
+      if(sn && !check_schema_token(*sn, c)){
+        return false;
+      }
       if(c == '{'){
-        deserialize_object(j);
-        return;
+        if(!deserialize_object(j, sn)) return false;
       }
       else if(c == '['){
-        deserialize_array(j);
-        return;
+        if(!deserialize_array(j, sn)) return false;
       }
       else if(c == 't'){
-        check_value("true");
-        j.set(true);
-        return;
+        if(!check_value("true")) return false;
+        set_literal(j, true);
       }
       else if(c == 'f'){
-        check_value("false");
-        j.set(false);
-        return;
+        if(!check_value("false")) return false;
+        set_literal(j, false);
       }
       else if(c == 'n'){
-        check_value("null");
-        j.set(nullptr);
-        return;
+        if(!check_value("null")) return false;
+        set_literal(j, nullptr);
       }
       else if(is_blacket(c)){
-        deserialize_string(j);
-        return;
+        if(!deserialize_string(j)) return false;
       }
       else if(is_number_parts(c)){
-        deserialize_number(j);
-        return;
+        if(!deserialize_number(j)) return false;
+      }
+      else{
+        return fail(parse_errc::syntax_error, "syntax error");
+      }
+      if(sn){
+        return check_schema_value(*sn, j);
+      }
+      return true;
+    }
+    return fail(parse_errc::unexpected_eof, "illegal eof");
+  }
+
+  /************** 検証のみ（json を生成しない） ***************/
+  bool deserialize_object(discard_value& j, const schema::node*)
+  {
+    discard_string key;
+    return read_object(key, [&](const discard_string&){ return deserialize(j); });
+  }
+
+  bool deserialize_array(discard_value& j, const schema::node*)
+  {
+    return read_array([&](){ return deserialize(j); });
+  }
+
+  bool deserialize_string(discard_value&)
+  {
+    discard_string s;
+    if(!read_string(s)) return false;
+    if(m_stats) m_stats->strings++;
+    return true;
+  }
+
+  /** 数値は生成する場合と同じく変換できることを確認する */
+  bool deserialize_number(discard_value&)
+  {
+    number_text s;
+    const bool bFloat = read_number_token(s);
+    if(m_raw_numbers){
+      if(json::raw_number::valid(s.c_str(), s.size())) return true;
+      return fail(parse_errc::invalid_number, "cannot convert to number : ", std::string("\"") + s.c_str() + "\"");
+    }
+    if(bFloat){
+      double v;
+      return to_number(s, true, v);
+    }
+    int64_t v;
+    return to_number(s, false, v);
+  }
+
+  /** deserialize() と同じ文法で値を読み飛ばす（値は生成しない） */
+  bool skip_value()
+  {
+    discard_value v;
+    return deserialize(v);
+  }
+
+  /************** 射影（指定したパスのみ生成する） ***************/
+  /**
+   * 値を生成せずに読み飛ばす。文字列（エスケープを含む）と括弧の対応のみを確認し、数値・リテラル・UTF-8 は検証しない。
+   * 値の後の ',' '}' ']' または入力の終端の手前で停止する。
+   **/
+  bool skip_raw()
+  {
+    std::size_t depth = 0;
+    skip_space_or_comment();
+    while(!m_stream.eof()){
+      const char c = m_stream[0];
+      if(is_blacket(c)){
+        m_stream.next(1);
+        for(;;){
+          if(m_stream.eof()) return fail(parse_errc::unexpected_eof, "illegal eof");
+          const char sc = m_stream[0];
+          if(sc == '\\'){
+            m_stream.next(2);
+          }
+          else{
+            m_stream.next(1);
+            if(is_blacket(sc)) break;
+          }
+        }
+        if(depth == 0) return true;
+      }
+      else if(c == '{' || c == '['){
+        depth++;
+        m_stream.next(1);
+      }
+      else if(c == '}' || c == ']'){
+        if(depth == 0) return true;
+        m_stream.next(1);
+        if(--depth == 0) return true;
+      }
+      else if(c == ',' && depth == 0){
+        return true;
+      }
+      else if(std::isspace(c) || c == '/'){
+        const auto pos = m_stream.position();
+        skip_space_or_comment();
+        if(m_stream.position() == pos) m_stream.next(1);
       }
       else{
-        throwError("syntax error");
+        m_stream.next(1);
+      }
+    }
+    return depth == 0 ? true : fail(parse_errc::unexpected_eof, "illegal eof");
+  }
+
+  /** pn に従って、指定されたパスの値とその祖先のみを生成する（型が異なる場合は j を変更しない） */
+  template <typename Traits>
+  bool deserialize_projected(basic_json<Traits>& j, const projection::node& pn)
+  {
+    using json_type = basic_json<Traits>;
+    if(pn.whole){
+      return deserialize(j);
+    }
+    skip_space_or_comment();
+    if(m_stream.eof()){
+      return fail(parse_errc::unexpected_eof, "illegal eof");
+    }
+    const char c = m_stream[0];
+    if(c == '{' && !pn.members.empty()){
+      auto obj = typename json_type::object_type();
+      auto& level = enter_level();
+      const bool ok = read_object(level.key, [&](const std::string& key){
+        const auto child = m_projection->find_member(pn, key);
+        if(!child) return skip_raw();
+        json_type inner;
+        if(!deserialize_projected(inner, *child)) return false;
+        if(!inner.is_undefined()){
+          build([&](){ obj.insert({json_type::to_string_type(key), std::move(inner)}); });
+        }
+        return true;
+      });
+      leave_level();
+      if(!ok) return false;
+      build([&](){ j.set(std::move(obj)); });
+      return true;
+    }
+    const auto elements = m_projection->find_elements(pn);
+    if(c == '[' && elements){
+      auto arr = typename json_type::array_type();
+      const bool ok = read_array([&](){
+        build([&](){ arr.emplace_back(); });
+        if(!deserialize_projected(arr.back(), *elements)) return false;
+        if(arr.back().is_undefined()) arr.back().set(nullptr);
+        return true;
+      });
+      if(!ok) return false;
+      build([&](){ j.set(std::move(arr)); });
+      return true;
+    }
+    return skip_raw();
+  }
+
+  /** エラーを初期化して f を実行する。計測が有効な場合は f の前後で計測値を集計する（成功した場合のみ通知する） */
+  template <typename F> bool instrumented(F&& f)
+  {
+    m_error = parse_error();
+    m_schema_path.clear();
+    m_nesting = 0;
+    if(!m_stats){
+      return f();
+    }
+    *m_stats = parse_stats();
+    m_depth = 0;
+    const auto start_pos = m_stream.position();
+    const auto start = stats_clock::now();
+    if(!f()) return false;
+    const uint64_t total = std::chrono::duration_cast<std::chrono::nanoseconds>(stats_clock::now() - start).count();
+    m_stats->bytes = m_stream.position() - start_pos;
+    m_stats->tokenize_ns = total > m_stats->build_ns ? total - m_stats->build_ns : 0;
+    if(m_on_stats) m_on_stats(*m_stats);
+    return true;
+  }
+
+  /************** 構造体バインディング（中間の json を生成せずに値を設定する） ***************/
+  /** 値の先頭文字を c に読み出す */
+  bool peek_value(char& c)
+  {
+    skip_space_or_comment();
+    if(m_stream.eof()){
+      return fail(parse_errc::unexpected_eof, "illegal eof");
+    }
+    c = m_stream[0];
+    return true;
+  }
+
+  template <typename Traits>
+  bool bind_value(basic_json<Traits>& v)
+  {
+    return deserialize(v);
+  }
+
+  bool bind_value(bool& v)
+  {
+    char c = 0;
+    if(!peek_value(c)) return false;
+    if(c == 't'){
+      if(!check_value("true")) return false;
+      v = true;
+    }
+    else if(c == 'f'){
+      if(!check_value("false")) return false;
+      v = false;
+    }
+    else{
+      return fail(parse_errc::type_mismatch, "type mismatch : boolean is expected");
+    }
+    return true;
+  }
+
+  template <typename T, std::enable_if_t<json::is_floating_point_compatible<T>::value, bool> = true>
+  bool bind_value(T& v)
+  {
+    char c = 0;
+    if(!peek_value(c)) return false;
+    if(!is_number_parts(c)){
+      return fail(parse_errc::type_mismatch, "type mismatch : number is expected");
+    }
+    number_text s;
+    const bool bFloat = read_number_token(s);
+    return to_number(s, bFloat, v);
+  }
+
+  /**
+   * 整数型は T の範囲外の数値を invalid_number、小数部を持つ数値を type_mismatch とする（値を丸めない）。
+   * 小数点・指数を含む表記（1.0 / 1e2 等）は整数値であれば受理する。
+   **/
+  template <typename T, std::enable_if_t<json::is_integer_compatible<T>::value, bool> = true>
+  bool bind_value(T& v)
+  {
+    char c = 0;
+    if(!peek_value(c)) return false;
+    if(!is_number_parts(c)){
+      return fail(parse_errc::type_mismatch, "type mismatch : number is expected");
+    }
+    number_text s;
+    if(read_number_token(s)){
+      double d;
+      if(!to_number(s, true, d)) return false;
+      if(std::trunc(d) != d){
+        return fail(parse_errc::type_mismatch, "type mismatch : integer is expected");
+      }
+      /** T の最小値と最大値 + 1 は 2 の冪（または 0）のため double で正確に表せる */
+      const auto lo = static_cast<double>(std::numeric_limits<T>::min());
+      const auto hi = static_cast<double>(std::numeric_limits<T>::max() / 2 + 1) * 2;
+      if(!(lo <= d && d < hi)){
+        return fail(parse_errc::invalid_number, "number out of range : ", std::string("\"") + s.c_str() + "\"");
+      }
+      v = static_cast<T>(d);
+      return true;
+    }
+    return to_integer(s, v);
+  }
+
+  /** 整数の文字列を T の範囲で変換する（符号無しの型は strtoull で変換し、負の数は範囲外とする） */
+  template <typename S, typename T>
+  bool to_integer(S& s, T& v)
+  {
+    const char* begin = s.c_str();
+    errno = 0;
+    if(std::is_unsigned<T>::value && begin[0] != '-'){
+      const auto n = std::strtoull(begin, nullptr, 10);
+      if(errno != ERANGE && n <= static_cast<unsigned long long>(std::numeric_limits<T>::max())){
+        v = static_cast<T>(n);
+        return true;
+      }
+    }
+    else{
+      const auto n = std::strtoll(begin, nullptr, 10);
+      const bool in_range = std::is_unsigned<T>::value ? n == 0 :
+        (static_cast<long long>(std::numeric_limits<T>::min()) <= n && n <= static_cast<long long>(std::numeric_limits<T>::max()));
+      if(errno != ERANGE && in_range){
+        v = static_cast<T>(n);
+        return true;
+      }
+    }
+    return fail(parse_errc::invalid_number, "number out of range : ", std::string("\"") + s.c_str() + "\"");
+  }
+
+  bool bind_value(std::string& v)
+  {
+    char c = 0;
+    if(!peek_value(c)) return false;
+    if(!is_blacket(c)){
+      return fail(parse_errc::type_mismatch, "type mismatch : string is expected");
+    }
+    if(!read_string(v)) return false;
+    if(m_stats) m_stats->strings++;
+    return true;
+  }
+
+  template <typename T, typename A>
+  bool bind_value(std::vector<T, A>& v)
+  {
+    char c = 0;
+    if(!peek_value(c)) return false;
+    if(c != '['){
+      return fail(parse_errc::type_mismatch, "type mismatch : array is expected");
+    }
+    v.clear();
+    return read_array([&](){
+      T e;
+      if(!bind_value(e)) return false;
+      v.push_back(std::move(e));
+      return true;
+    });
+  }
+
+  template <typename MAP>
+  bool bind_map(MAP& v)
+  {
+    char c = 0;
+    if(!peek_value(c)) return false;
+    if(c != '{'){
+      return fail(parse_errc::type_mismatch, "type mismatch : object is expected");
+    }
+    v.clear();
+    auto& level = enter_level();
+    const bool ok = read_object(level.key, [&](const std::string& key){
+      return bind_value(v[key]);
+    });
+    leave_level();
+    return ok;
+  }
+
+  template <typename T, typename C, typename A>
+  bool bind_value(std::map<std::string, T, C, A>& v)
+  {
+    return bind_map(v);
+  }
+
+  template <typename T, typename H, typename E, typename A>
+  bool bind_value(std::unordered_map<std::string, T, H, E, A>& v)
+  {
+    return bind_map(v);
+  }
+
+#if __cplusplus >= 201703L
+  template <typename T>
+  bool bind_value(std::optional<T>& v)
+  {
+    char c = 0;
+    if(!peek_value(c)) return false;
+    if(c == 'n'){
+      if(!check_value("null")) return false;
+      v.reset();
+      return true;
+    }
+    v.emplace();
+    return bind_value(*v);
+  }
+#endif
+
+  template <typename T, std::enable_if_t<binding<T>::available, bool> = true>
+  bool bind_value(T& v)
+  {
+    char c = 0;
+    if(!peek_value(c)) return false;
+    if(c != '{'){
+      return fail(parse_errc::type_mismatch, "type mismatch : object is expected");
+    }
+    const auto fields = binding<T>::fields();
+    std::array<bool, std::tuple_size<std::decay_t<decltype(fields)>>::value> found{};
+    auto& level = enter_level();
+    const bool ok = read_object(level.key, [&](const std::string& key){
+      bool matched = false;
+      bool bound = true;
+      for_each_binding_field(fields, [&](const auto& f, std::size_t i){
+        if(!matched && key == f.name){
+          bound = bind_value(v.*(f.member));
+          found[i] = true;
+          matched = true;
+        }
+      });
+      if(!matched){
+        /** 登録されていないキーは値を生成せずに読み飛ばす */
+        return skip_value();
       }
+      return bound;
+    });
+    leave_level();
+    if(!ok) return false;
+    const char* missing = nullptr;
+    for_each_binding_field(fields, [&](const auto& f, std::size_t i){
+      using value_type = typename std::decay_t<decltype(f)>::value_type;
+      if(!missing && !found[i] && !f.optional && !binding_is_optional<value_type>::value){
+        missing = f.name;
+      }
+    });
+    if(missing){
+      return fail(parse_errc::missing_key, "missing key : ", missing);
     }
-    throwError("illegal eof");
+    return true;
   }
 
 public:
   deserializer(std::istream& stream) :
-    m_stream(stream)
+    m_stream(stream), m_schema(nullptr), m_dedup(nullptr), m_raw_numbers(false), m_utf8_policy(utf8_policy::reject), m_projection(nullptr), m_stats(nullptr), m_depth(0), m_source(nullptr), m_nesting(0)
+  {
+  }
+
+  /** デシリアライズしながら s で検証する。違反した時点で schema_violation を送出する。 */
+  deserializer(std::istream& stream, const schema& s) :
+    m_stream(stream), m_schema(&s), m_dedup(nullptr), m_raw_numbers(false), m_utf8_policy(utf8_policy::reject), m_projection(nullptr), m_stats(nullptr), m_depth(0), m_source(nullptr), m_nesting(0)
   {
   }
 
   ~deserializer() = default;
 
-  json execute() {
-    json j;
-    deserialize(j);
+  /**
+   * 入力を stream に切り替える。スキーマ・dedup()・instrument() の指定と作業領域（キーの読み出し先等）は引き継ぐ。
+   * 多数の入力を同じ deserializer で解析する場合に使用する。
+   **/
+  deserializer& reset(std::istream& stream) {
+    m_stream.reset(stream);
+    return *this;
+  }
+
+  /** デシリアライズしながら pool で同一の値を共有する（object のキーは共有しない） */
+  deserializer& dedup(dedup_pool& pool) {
+    m_dedup = &pool;
+    return *this;
+  }
+
+  /**
+   * 数値を変換せずに json::raw_number（数値の文字列）として生成する。
+   * 数値への変換は get<T>() を呼び出した時点で行い、serializer は文字列のまま出力するため、
+   * そのまま出力する経路では変換を省略でき、int64_t の範囲を超える整数や 10 進数の小数を丸めずに保持できる。
+   * ただし int64_t の範囲の整数は、出力しても表記が変わらないため従来どおり integral として生成する（領域を確保しない）。
+   * 数値は RFC 8259 の文法で検証する（"01" "1." "+1" 等は受理しない）。validate() も同じ文法で検証する。
+   **/
+  deserializer& raw_numbers(bool enable = true) {
+    m_raw_numbers = enable;
+    return *this;
+  }
+
+  /**
+   * 文字列中の不正な UTF-8 の並びと対になっていないサロゲート（\uD800 等）の取り扱い（既定値は utf8_policy::reject）。
+   * utf8_policy::replace の場合は U+FFFD に置き換えて解析を続ける。
+   **/
+  deserializer& on_invalid_utf8(utf8_policy policy) {
+    m_utf8_policy = policy;
+    return *this;
+  }
+
+  /**
+   * execute(json&) で p に指定したパスの値とその祖先のみを生成し、それ以外は文字列と括弧の対応のみを確認して読み飛ばす。
+   * 読み飛ばした部分の数値・リテラル・UTF-8 は検証しない。スキーマ・dedup()・既存の json の再利用は適用しない。
+   * p は deserializer より長く存在すること。
+   **/
+  deserializer& project(const projection& p) {
+    m_projection = &p;
+    return *this;
+  }
+
+  /** 計測を有効にする。execute() 毎に stats を初期化して集計する。 */
+  deserializer& instrument(parse_stats& stats) {
+    m_stats = &stats;
+    return *this;
+  }
+
+  /** 計測を有効にする。execute() の完了時に callback を呼び出す。 */
+  deserializer& instrument(std::function<void(const parse_stats&)> callback) {
+    if(!m_stats) m_stats = &m_own_stats;
+    m_on_stats = std::move(callback);
+    return *this;
+  }
+
+  /** J に json 以外の basic_json（basic_json<my_traits> 等）を指定できる */
+  template <typename J = json>
+  J execute() {
+    J j;
+    execute(j);
     return j;
   }
 
-  void execute(json& j) {
-    deserialize(j);
+  /**
+   * j へデシリアライズする。j が既に値を保持している場合は、入力と同じ型の部分
+   * （object のノード・array の要素とバッファ・文字列の領域）を再利用して上書きする。
+   * 同じ形の入力を繰り返し解析する場合は、reset() と組み合わせて同じ j へ解析することで領域の確保と解放を省略できる。
+   * 失敗した場合の j の内容は不定（有効な json ではある）。dedup() を指定した場合は再利用しない。
+   * json 以外の basic_json にも使用できるが、スキーマと dedup() は json にのみ適用する（スキーマを指定した場合は schema_violation とする）。
+   **/
+  template <typename Traits>
+  void execute(basic_json<Traits>& j) {
+    if(!try_execute(j, m_error)) throw_error();
+  }
+
+  /** 構造体（CPPJSON_BINDING で登録した型）や、そのコンテナへ直接デシリアライズする */
+  template <typename T>
+  void execute(T& v) {
+    if(!try_execute(v, m_error)) throw_error();
+  }
+
+  /**
+   * 例外を送出せずにデシリアライズする。失敗した場合は false を返却し、error にエラーの種類と位置を設定する。
+   * 不正な入力が多い場合に、例外の送出とメッセージの生成の負担を避けるために使用する。
+   * （メモリの確保に失敗した場合の std::bad_alloc は送出される）
+   **/
+  template <typename Traits>
+  bool try_execute(basic_json<Traits>& j, parse_error& error) {
+    const bool ok = instrumented([&](){
+      if(m_projection){
+        j.set(nullptr); /** ルートの型が異なる場合は null */
+        return deserialize_projected(j, m_projection->root());
+      }
+      if(m_schema && !std::is_same<Traits, json_traits>::value){
+        return schema_violated(": schema is available only for json");
+      }
+      return deserialize(j, m_schema ? &m_schema->root() : nullptr);
+    });
+    if(&error != &m_error) error = m_error;
+    return ok;
+  }
+
+  template <typename T>
+  bool try_execute(T& v, parse_error& error) {
+    const bool ok = instrumented([&](){ return bind_value(v); });
+    if(&error != &m_error) error = m_error;
+    return ok;
+  }
+
+  /**
+   * json を生成せずに、execute() と同じ文法（コメント・数値・エスケープ・UTF-8 を含む）で入力の先頭の値を検証する。
+   * 文字列・キーは保持せず、数値も通常の長さであれば領域を確保せずに変換できることのみ確認する。
+   * スキーマは検証しない。正しい場合は true を返却し、不正な場合は false を返却して error を設定する。
+   **/
+  bool validate(parse_error& error) {
+    const bool ok = instrumented([&](){ return skip_value(); });
+    if(&error != &m_error) error = m_error;
+    return ok;
+  }
+
+  /** 入力を検証し、不正な場合は真となる parse_error を返却する */
+  parse_error validate() {
+    parse_error error;
+    validate(error);
+    return error;
+  }
+
+  /** 例外を送出せずにデシリアライズする。失敗した場合は真となる parse_error を返却する。 */
+  template <typename T>
+  parse_error try_execute(T& v) {
+    parse_error error;
+    try_execute(v, error);
+    return error;
   }
 };
 
@@ -0,0 +1,62 @@
+#if !defined(__cppjson_h_embed__)
+#define __cppjson_h_embed__
+
+#include "json.h"
+#include "snapshot.h"
+#include <ostream>
+#include <string>
+
+namespace cppjson {
+
+/**
+ * json をスナップショット（snapshot.h）のバイト列として埋め込むヘッダを生成する。
+ * 生成したヘッダの name() は静的に初期化された読み取り専用のバイト列を snapshot_view として返却するため、
+ * 実行時に解析もメモリの確保も行わない。
+ * embed_generator(j, "defaults").execute(os);
+ * // 生成したヘッダを include して
+ * auto conf = cppjson_embedded::defaults();
+ * conf["retry"].get<int>();
+ *
+ * name は C++ の識別子であること。通常はビルド時に embed/main.cpp（CMake の cppjson_embed_json()）から使用する。
+ **/
+class embed_generator {
+private:
+  const json&         m_json;
+  const std::string   m_name;
+  const std::string   m_source;
+
+public:
+  /** source は生成したヘッダのコメントに記載する元のファイル名 */
+  embed_generator(const json& j, const std::string& name, const std::string& source = std::string())
+    : m_json(j), m_name(name), m_source(source) {}
+
+  void execute(std::ostream& os) const {
+    static const char hex[] = "0123456789abcdef";
+    const auto bytes = snapshot_serializer(m_json).execute();
+    const auto guard = "__cppjson_embedded_" + m_name + "__";
+
+    os << "/** " << (m_source.empty() ? std::string("json") : m_source) << " から生成したヘッダ（編集しないこと） */\n";
+    os << "#if !defined(" << guard << ")\n";
+    os << "#define " << guard << "\n\n";
+    os << "#include <cppjson/snapshot.h>\n\n";
+    os << "namespace cppjson_embedded {\n\n";
+    os << "inline const unsigned char* " << m_name << "_data() {\n";
+    os << "  alignas(8) static const unsigned char data[" << bytes.size() << "] = {";
+    for(std::size_t i = 0; i < bytes.size(); i++){
+      const auto b = static_cast<unsigned char>(bytes[i]);
+      os << (i % 16 == 0 ? "\n    " : " ") << "0x" << hex[b >> 4] << hex[b & 0x0F] << ",";
+    }
+    os << "\n  };\n";
+    os << "  return data;\n";
+    os << "}\n\n";
+    os << "inline std::size_t " << m_name << "_size() { return " << bytes.size() << "; }\n\n";
+    os << "inline cppjson::snapshot_view " << m_name << "() {\n";
+    os << "  return cppjson::snapshot_view::from(" << m_name << "_data(), " << m_name << "_size());\n";
+    os << "}\n\n";
+    os << "} /** namespace cppjson_embedded */\n";
+    os << "#endif /* !defined(" << guard << ") */\n";
+  }
+};
+
+} /** namespace cppjson */
+#endif /* !defined(__cppjson_h_embed__) */
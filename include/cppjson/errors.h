@@ -6,6 +6,7 @@
 #include <string>
 
 namespace cppjson {
+template <typename Traits> class basic_json;
 
 /** 例外オブジェクトの基底クラス */
 class error : public std::exception {
@@ -20,7 +21,7 @@ public:
 
 /** 取り扱いできない型（value_container内で発生するが、この例外が送出される場合コードのバグである） */
 class bad_type : public error {
-friend class json;
+template <typename> friend class basic_json;
 private:
   bad_type() : error("bad_type") {}
   [[noreturn]] static void throw_error(){
@@ -30,7 +31,8 @@ private:
 
 /** 不正な型変換 */
 class bad_cast : public error {
-friend class json;
+template <typename> friend class basic_json;
+friend class snapshot_view;
 private:
   bad_cast(const std::string& s) : error(s) {}
 };
@@ -38,13 +40,58 @@ private:
 /** deserializerのエラー */
 class bad_json : public error {
 friend class deserializer;
+friend class push_deserializer;
 private:
   bad_json(const std::string& s) : error(s) {}
 };
 
+/** cbor_deserializerのエラー */
+class bad_cbor : public error {
+friend class cbor_deserializer;
+private:
+  bad_cbor(const std::string& s) : error(s) {}
+};
+
+/** msgpack_deserializerのエラー */
+class bad_msgpack : public error {
+friend class msgpack_deserializer;
+private:
+  bad_msgpack(const std::string& s) : error(s) {}
+};
+
+/** snapshotのエラー */
+class bad_snapshot : public error {
+friend class snapshot_serializer;
+friend class snapshot_view;
+private:
+  bad_snapshot(const std::string& s) : error(s) {}
+};
+
+/** 不正なスキーマ */
+class bad_schema : public error {
+friend class schema;
+private:
+  bad_schema(const std::string& s) : error(s) {}
+};
+
+/** スキーマ違反（deserializer でスキーマを指定した場合） */
+class schema_violation : public error {
+friend class deserializer;
+private:
+  schema_violation(const std::string& s) : error(s) {}
+};
+
+/** json_patch のエラー */
+class bad_patch : public error {
+friend class json_patch;
+private:
+  bad_patch(const std::string& s) : error(s) {}
+};
+
 /* undefined に対して型指定の値取得を行おうとした */
 class value_is_undefined : public error {
-friend class json;
+template <typename> friend class basic_json;
+friend class snapshot_view;
 private:
   value_is_undefined() : error("value_is_undefined") {}
   [[noreturn]] static void throw_error(){
@@ -5,42 +5,139 @@
 #include <unordered_map>
 #include <type_traits>
 #include <vector>
+#include <memory>
+#include <cstddef>
+#include <cstdint>
+#include <typeinfo>
 #include <sstream>
+#include <atomic>
+#include <functional>
+#include <cstring>
+#include <cstdlib>
+#include <cerrno>
 
 #include "errors.h"
 
 namespace cppjson {
-class json
+class dedup_pool;
+class memory_inspector;
+class deserializer;
+
+/**
+ * basic_json が使用する文字列・コンテナ・領域の確保の方法（json は json_traits を使用する）。
+ * 別の実装を使用する場合は、同じメンバーを持つ型を basic_json に指定する。
+ *   string_type       : std::string と同じインタフェース（const char* と (const char*, size_t) からの構築・data()・size()・capacity()・+=・clear()・比較）と std::hash の特殊化を持つこと
+ *   array_type<J>     : std::vector と同じインタフェース（reserve() / capacity() を含む）を持つこと
+ *   object_type<J>    : キーが string_type で、std::unordered_map または std::map と同じインタフェースを持つこと
+ *                       （erase() は残りの要素の列挙順を変えないこと。要素のアドレスは追加・削除で変わってもよい）
+ *   allocator_type<T> : string / array / object の値を保持する領域（payload）の確保に使用する。状態を持たないこと
+ * コンテナ自身の領域は、array_type / object_type に指定したアロケータで確保する。
+ **/
+struct json_traits {
+  using string_type = std::string;
+  template <typename J> using array_type = std::vector<J>;
+  template <typename J> using object_type = std::unordered_map<std::string, J>;
+  template <typename T> using allocator_type = std::allocator<T>;
+};
+
+template <typename Traits>
+class basic_json
 {
+  friend class dedup_pool;
+  friend class memory_inspector;
+
 private:
   struct undefined_type {}; /** 内部でのみ使用 */
 
 public:
   /* js独自の型（公開） */
-  using array_type = std::vector<json>;
-  using object_type = std::unordered_map<std::string, json>;
+  using traits_type = Traits;
+  using string_type = typename Traits::string_type;
+  using array_type = typename Traits::template array_type<basic_json>;
+  using object_type = typename Traits::template object_type<basic_json>;
+
+  /**
+   * 数値の文字列表現（deserializer::raw_numbers() で生成する）。
+   * 数値への変換は get<T>() を呼び出した時点で行い、serializer は文字列のまま出力する。
+   * int64_t の範囲を超える整数や 10 進数の小数（金額等）を丸めずに保持できる。
+   **/
+  class raw_number {
+    friend class deserializer;
+  private:
+    std::string m_text;
+
+    struct unchecked {};
+    raw_number(std::string&& text, unchecked) : m_text(std::move(text)) {}
+
+    static bool is_digit(char c) { return c >= '0' && c <= '9'; }
+
+  public:
+    /** text は RFC 8259 の数値であること（不正な場合は bad_cast を送出する） */
+    explicit raw_number(const std::string& text) : m_text(text) {
+      if(!valid(text.data(), text.size())){
+        throw bad_cast("bad_cast: \"" + text + "\" -> raw_number");
+      }
+    }
+
+    const std::string& text() const { return m_text; }
+
+    /** 小数部と指数部を持たない */
+    bool is_integer() const { return m_text.find_first_of(".eE") == std::string::npos; }
+
+    /** s から n バイトが RFC 8259 の数値であるか判定する */
+    static bool valid(const char* s, std::size_t n) {
+      std::size_t i = 0;
+      if(i < n && s[i] == '-') i++;
+      if(i < n && s[i] == '0'){
+        i++;
+      }
+      else{
+        if(i >= n || !is_digit(s[i])) return false;
+        while(i < n && is_digit(s[i])) i++;
+      }
+      if(i < n && s[i] == '.'){
+        i++;
+        if(i >= n || !is_digit(s[i])) return false;
+        while(i < n && is_digit(s[i])) i++;
+      }
+      if(i < n && (s[i] == 'e' || s[i] == 'E')){
+        i++;
+        if(i < n && (s[i] == '+' || s[i] == '-')) i++;
+        if(i >= n || !is_digit(s[i])) return false;
+        while(i < n && is_digit(s[i])) i++;
+      }
+      return i == n;
+    }
+  };
 
-  /** value_container で保持している型を値として取り扱うための ID （integral と floating_point はjsではNumber型だが、この世界では別の型として区別する） */
-  enum class value_type_id { integral, floating_point, boolean, null, string, array, object, undefined };
+  /**
+   * value_container で保持している型を値として取り扱うための ID （integral と floating_point はjsではNumber型だが、この世界では別の型として区別する）
+   * raw_number は既存の値（snapshot 等で保存した ID）を変えないよう末尾に置く。
+   **/
+  enum class value_type_id { integral, floating_point, boolean, null, string, array, object, undefined, raw_number };
 
   /** value_type_traits で有効な型の特性（使用可否・型・型ID）を保有する */
   template<typename T, value_type_id VALUE_TYPE_ID> struct traits_holder {
     static constexpr bool           available = true;
     using                           type = T;
-    static constexpr value_type_id  value_type_id = VALUE_TYPE_ID;
+    static constexpr enum value_type_id value_type_id = VALUE_TYPE_ID;
   };
 
-  /** value_container で保持できる型を traits で列挙 */
-  template<typename T> struct value_type_traits;
-  template<> struct value_type_traits<int64_t       > : public traits_holder<int64_t        , value_type_id::integral> {};
-  template<> struct value_type_traits<double        > : public traits_holder<double         , value_type_id::floating_point> {};
-  template<> struct value_type_traits<bool          > : public traits_holder<bool           , value_type_id::boolean> {};
-  template<> struct value_type_traits<nullptr_t     > : public traits_holder<nullptr_t      , value_type_id::null> {};
-  template<> struct value_type_traits<std::string   > : public traits_holder<std::string    , value_type_id::string> {};
-  template<> struct value_type_traits<array_type    > : public traits_holder<array_type     , value_type_id::array> {};
-  template<> struct value_type_traits<object_type   > : public traits_holder<object_type    , value_type_id::object> {};
-  template<> struct value_type_traits<undefined_type> : public traits_holder<undefined_type , value_type_id::undefined> {};
-  template<typename T> struct value_type_traits       { static constexpr bool available = false; }; /** その他 = 使用できない型 */
+  /**
+   * value_container で保持できる型を traits で列挙
+   * （クラスの内部では明示的特殊化ができないため、ダミーの D を持つ部分特殊化とする）
+   **/
+  template<typename T, typename D = void> struct value_type_traits;
+  template<typename D> struct value_type_traits<int64_t       , D> : public traits_holder<int64_t        , value_type_id::integral> {};
+  template<typename D> struct value_type_traits<double        , D> : public traits_holder<double         , value_type_id::floating_point> {};
+  template<typename D> struct value_type_traits<bool          , D> : public traits_holder<bool           , value_type_id::boolean> {};
+  template<typename D> struct value_type_traits<nullptr_t     , D> : public traits_holder<nullptr_t      , value_type_id::null> {};
+  template<typename D> struct value_type_traits<string_type   , D> : public traits_holder<string_type    , value_type_id::string> {};
+  template<typename D> struct value_type_traits<array_type    , D> : public traits_holder<array_type     , value_type_id::array> {};
+  template<typename D> struct value_type_traits<object_type   , D> : public traits_holder<object_type    , value_type_id::object> {};
+  template<typename D> struct value_type_traits<undefined_type, D> : public traits_holder<undefined_type , value_type_id::undefined> {};
+  template<typename D> struct value_type_traits<raw_number    , D> : public traits_holder<raw_number     , value_type_id::raw_number> {};
+  template<typename T, typename D> struct value_type_traits     { static constexpr bool available = false; }; /** その他 = 使用できない型 */
 
   /** T&& を受ける場合、const と 参照を外して value_type_traits を判定する */
   template <typename T> struct pure_value_type_traits : public value_type_traits<
@@ -64,11 +161,6 @@ public:
     static constexpr bool value = is_integer_compatible<T>::value || is_floating_point_compatible<T>::value;
   };
 
-  /** shared pointer 化 */
-  using sp = std::shared_ptr<json>;
-  sp to_shared() { return std::make_shared<json>(std::move(*this)); }
-
-private:
   /** debug での使用を想定 */
   static const char* value_type_string(enum value_type_id value_type_id) { 
     switch(value_type_id) {
@@ -79,51 +171,196 @@ private:
       case value_type_id::string:          { return "string"; }
       case value_type_id::array:           { return "array"; }
       case value_type_id::object:          { return "object"; }
+      case value_type_id::raw_number:      { return "raw_number"; }
       default: /** undefined */            { return "undefined"; }
     }
   }
 
+  /** std::string を string_type（object のキー）に変換する（string_type が std::string の場合は複製しない） */
+  template <typename S = string_type, std::enable_if_t<std::is_same<S, std::string>::value, bool> = true>
+  static const std::string& to_string_type(const std::string& s) { return s; }
+
+  template <typename S = string_type, std::enable_if_t<!std::is_same<S, std::string>::value, bool> = true>
+  static S to_string_type(const std::string& s) { return S(s.data(), s.size()); }
+
+  /** shared pointer 化 */
+  using sp = std::shared_ptr<basic_json>;
+  sp to_shared() { return std::make_shared<basic_json>(std::move(*this)); }
+
+private:
+  /**
+   * class インスタンスの値（string / array / object）を保持する領域。
+   * 通常は１つの value_container が所有する（refs == 1）が、dedup_pool により
+   * 同一内容の値は複数の value_container から共有される（refs > 1）。
+   * 共有されている値は不変として扱い、非 const で取得する際に複製（detach）する。
+   * hash は json::hash() の結果のキャッシュ（0 は未計算）で、非 const で取得する際に破棄する。
+   **/
+  template <typename T> struct payload {
+    std::atomic<std::size_t>  refs;
+    std::atomic<std::size_t>  hash;
+    T                         value;
+
+    template <typename... ARGS>
+    payload(ARGS&&... args) : refs(1), hash(0), value(std::forward<ARGS>(args)...) {}
+  };
+
   /**
    * 値を保有するクラス
    * class インスタンスはポインタで保有、その他は実体を保有する。
    **/
   class value_container {
+    friend class basic_json;
+    friend class dedup_pool;
+    friend class memory_inspector;
+
   private:
     union content {
-      int64_t       _integer;
-      double        _floating_point;
-      bool          _boolean;
-      nullptr_t     _null;
-      std::string*  _string_ptr;
-      array_type*   _array_ptr;
-      object_type*  _object_ptr;
+      int64_t                 _integer;
+      double                  _floating_point;
+      bool                    _boolean;
+      nullptr_t               _null;
+      payload<string_type>*   _string_ptr;
+      payload<array_type>*    _array_ptr;
+      payload<object_type>*   _object_ptr;
+      payload<raw_number>*    _raw_number_ptr;
     };
     content         m_content;
-    value_type_id   m_value_type_id;
+    enum value_type_id m_value_type_id;
+
+    /** payload は Traits::allocator_type で確保する */
+    template <typename T> using payload_allocator = typename Traits::template allocator_type<payload<T>>;
 
-    /** 内包する値の解放（classインスタンスは削除するが、それ以外は何もしない） */
+    template <typename T, typename... ARGS> static payload<T>* new_payload(ARGS&&... args) {
+      using alloc_traits = std::allocator_traits<payload_allocator<T>>;
+      payload_allocator<T> a;
+      auto p = alloc_traits::allocate(a, 1);
+      try{
+        alloc_traits::construct(a, p, std::forward<ARGS>(args)...);
+      }
+      catch(...){
+        alloc_traits::deallocate(a, p, 1);
+        throw;
+      }
+      return p;
+    }
+
+    template <typename T> static void release_payload(payload<T>* p) {
+      if(p->refs.fetch_sub(1, std::memory_order_acq_rel) == 1){
+        using alloc_traits = std::allocator_traits<payload_allocator<T>>;
+        payload_allocator<T> a;
+        alloc_traits::destroy(a, p);
+        alloc_traits::deallocate(a, p, 1);
+      }
+    }
+
+    /** reserve() を持つコンテナ（std::map は持たない）のみ予約する */
+    template <typename C> static auto reserve(C& c, std::size_t n, int) -> decltype(c.reserve(n), void()) { c.reserve(n); }
+    template <typename C> static void reserve(C&, std::size_t, long) {}
+
+    /** 内包する値の解放（classインスタンスは参照を外し、最後の参照であれば削除する。それ以外は何もしない） */
     void destruct_value() {
       switch(value_type_id()){
-        case value_type_id::string:  { delete m_content._string_ptr; break; }
-        case value_type_id::array:   { delete m_content._array_ptr; break; }
-        case value_type_id::object:  { delete m_content._object_ptr; break; }
+        case value_type_id::string:  { release_payload(m_content._string_ptr); break; }
+        case value_type_id::array:   { release_payload(m_content._array_ptr); break; }
+        case value_type_id::object:  { release_payload(m_content._object_ptr); break; }
+        case value_type_id::raw_number: { release_payload(m_content._raw_number_ptr); break; }
         default: { break; } /** class インスタンスでなければ何もしない */
       }
     }
 
+    /** class インスタンスの値を保持しているか */
+    bool is_payload() const {
+      switch(value_type_id()){
+        case value_type_id::string:
+        case value_type_id::array:
+        case value_type_id::object:
+        case value_type_id::raw_number: { return true; }
+        default: { return false; }
+      }
+    }
+
+    /** 値の参照数（class インスタンス以外は 0） */
+    std::size_t use_count() const {
+      switch(value_type_id()){
+        case value_type_id::string:  { return m_content._string_ptr->refs.load(std::memory_order_acquire); }
+        case value_type_id::array:   { return m_content._array_ptr->refs.load(std::memory_order_acquire); }
+        case value_type_id::object:  { return m_content._object_ptr->refs.load(std::memory_order_acquire); }
+        case value_type_id::raw_number: { return m_content._raw_number_ptr->refs.load(std::memory_order_acquire); }
+        default: { return 0; }
+      }
+    }
+
+    /** class インスタンスの値のアドレス（同一の値を共有しているかの判定用） */
+    const void* payload_address() const {
+      return is_payload() ? *reinterpret_cast<void* const *>(&m_content) : nullptr;
+    }
+
+    /** 複製せずに値を共有する */
+    value_container share() const {
+      value_container v;
+      v.m_content = m_content;
+      v.m_value_type_id = m_value_type_id;
+      switch(value_type_id()){
+        case value_type_id::string:  { m_content._string_ptr->refs.fetch_add(1, std::memory_order_relaxed); break; }
+        case value_type_id::array:   { m_content._array_ptr->refs.fetch_add(1, std::memory_order_relaxed); break; }
+        case value_type_id::object:  { m_content._object_ptr->refs.fetch_add(1, std::memory_order_relaxed); break; }
+        case value_type_id::raw_number: { m_content._raw_number_ptr->refs.fetch_add(1, std::memory_order_relaxed); break; }
+        default: { break; }
+      }
+      return v;
+    }
+
+    /** 共有されている値を変更する前に、自身専用の値へ複製する（子の値は共有したまま） */
+    static void detach(payload<string_type>*& p) {
+      if(p->refs.load(std::memory_order_acquire) == 1) return;
+      auto copy = new_payload<string_type>(p->value);
+      release_payload(p);
+      p = copy;
+    }
+
+    static void detach(payload<raw_number>*& p) {
+      if(p->refs.load(std::memory_order_acquire) == 1) return;
+      auto copy = new_payload<raw_number>(p->value);
+      release_payload(p);
+      p = copy;
+    }
+
+    static void detach(payload<array_type>*& p) {
+      if(p->refs.load(std::memory_order_acquire) == 1) return;
+      auto copy = new_payload<array_type>();
+      copy->value.reserve(p->value.size());
+      for(const auto& v : p->value){
+        copy->value.emplace_back();
+        copy->value.back().m_value = v.m_value.share();
+      }
+      release_payload(p);
+      p = copy;
+    }
+
+    static void detach(payload<object_type>*& p) {
+      if(p->refs.load(std::memory_order_acquire) == 1) return;
+      auto copy = new_payload<object_type>();
+      reserve(copy->value, p->value.size(), 0);
+      for(const auto& kv : p->value){
+        copy->value[kv.first].m_value = kv.second.m_value.share();
+      }
+      release_payload(p);
+      p = copy;
+    }
+
   public:
-    value_container(): m_value_type_id(value_type_id::undefined) {}
+    value_container(): m_content(), m_value_type_id(value_type_id::undefined) {}
 
-    value_container(const value_container& src): m_value_type_id(value_type_id::undefined) {
+    value_container(const value_container& src): m_content(), m_value_type_id(value_type_id::undefined) {
       *this = src;
     }
 
-    value_container(value_container&& src): m_value_type_id(value_type_id::undefined) {
+    value_container(value_container&& src): m_content(), m_value_type_id(value_type_id::undefined) {
       *this = std::move(src);
     }
 
     template <typename T, std::enable_if_t<pure_value_type_traits<T>::available, bool> = true>
-    value_container(T&& value): m_value_type_id(value_type_id::undefined) {
+    value_container(T&& value): m_content(), m_value_type_id(value_type_id::undefined) {
       set(std::forward<T>(value));
     }
 
@@ -150,36 +387,58 @@ private:
       return *this;
     }
 
+    /** 複製する（共有されている値は不変なので、複製せずに共有する） */
     value_container clone() const {
+      if(use_count() > 1){
+        return share();
+      }
       switch(value_type_id()){
         case value_type_id::integral:       { return value_container(m_content._integer); }
         case value_type_id::floating_point: { return value_container(m_content._floating_point); }
         case value_type_id::boolean:        { return value_container(m_content._boolean); }
         case value_type_id::null:           { return value_container(m_content._null); }
-        case value_type_id::string:         { return value_container(*m_content._string_ptr); }
-        case value_type_id::array:          { return value_container(*m_content._array_ptr); }
-        case value_type_id::object:         { return value_container(*m_content._object_ptr); }
+        case value_type_id::string:         { return value_container(m_content._string_ptr->value); }
+        case value_type_id::array:          { return value_container(m_content._array_ptr->value); }
+        case value_type_id::object:         { return value_container(m_content._object_ptr->value); }
+        case value_type_id::raw_number:     { return value_container(m_content._raw_number_ptr->value); }
         default: /** undefined */           { return value_container(); }
       }
     }
 
-    const value_type_id value_type_id() const { return m_value_type_id; }
+    const enum value_type_id value_type_id() const { return m_value_type_id; }
 
     const char* value_type_string() const {
-      return json::value_type_string(value_type_id());
+      return basic_json::value_type_string(value_type_id());
     }
 
     template <typename T, std::enable_if_t<value_type_traits<T>::available && !std::is_class<T>::value, bool> = true>
     const T& get() const { return *reinterpret_cast<const T*>(&m_content); }
 
     template <typename T, std::enable_if_t<value_type_traits<T>::available && std::is_class<T>::value, bool> = true>
-    const T& get() const { return **reinterpret_cast<T* const *>(&m_content); }
+    const T& get() const { return (*reinterpret_cast<payload<T>* const *>(&m_content))->value; }
 
     template <typename T, std::enable_if_t<value_type_traits<T>::available && !std::is_class<T>::value, bool> = true>
     T& get() { return *reinterpret_cast<T*>(&m_content); }
 
+    /** 共有されている値は変更される可能性があるため複製してから返却する */
     template <typename T, std::enable_if_t<value_type_traits<T>::available && std::is_class<T>::value, bool> = true>
-    T& get() { return **reinterpret_cast<T**>(&m_content); }
+    T& get() {
+      auto& p = *reinterpret_cast<payload<T>**>(&m_content);
+      detach(p);
+      p->hash.store(0, std::memory_order_relaxed);
+      return p->value;
+    }
+
+    /** キャッシュしたハッシュ値の参照（class インスタンス以外は nullptr） */
+    std::atomic<std::size_t>* hash_cache() const {
+      switch(value_type_id()){
+        case value_type_id::string:  { return &m_content._string_ptr->hash; }
+        case value_type_id::array:   { return &m_content._array_ptr->hash; }
+        case value_type_id::object:  { return &m_content._object_ptr->hash; }
+        case value_type_id::raw_number: { return &m_content._raw_number_ptr->hash; }
+        default: { return nullptr; }
+      }
+    }
 
     template <
       typename T,
@@ -200,9 +459,10 @@ private:
       std::enable_if_t<std::is_class<PURE_T>::value, bool> = true
     >
     void set(T&& value) {
+      auto p = new_payload<PURE_T>(std::forward<T>(value));
       destruct_value();
       m_value_type_id = VALUE_TYPE_ID;
-      *reinterpret_cast<PURE_T**>(&m_content) = new PURE_T(std::forward<T>(value));
+      *reinterpret_cast<payload<PURE_T>**>(&m_content) = p;
     }
   };
 
@@ -223,9 +483,127 @@ private:
     throw bad_cast(ss.str());
   }
   
+  static std::size_t hash_mix(std::size_t h, std::size_t v) {
+    return h ^ (v + 0x9e3779b97f4a7c15ull + (h << 6) + (h >> 2));
+  }
+
+  /** raw_number が int64_t の範囲の整数であれば v に変換する */
+  static bool raw_number_to_integer(const raw_number& r, int64_t& v) {
+    if(!r.is_integer()) return false;
+    errno = 0;
+    v = std::strtoll(r.text().c_str(), nullptr, 10);
+    return errno != ERANGE;
+  }
+
+  /** raw_number を整数型に変換する（小数は double を経由し、範囲外の整数は bad_cast を送出する） */
+  template <typename T, std::enable_if_t<is_integer_compatible<T>::value, bool> = true>
+  static T convert_raw_number(const raw_number& r) {
+    if(!r.is_integer()){
+      return static_cast<T>(std::strtod(r.text().c_str(), nullptr));
+    }
+    errno = 0;
+    if(std::is_unsigned<T>::value && r.text()[0] != '-'){
+      const auto v = std::strtoull(r.text().c_str(), nullptr, 10);
+      if(errno != ERANGE) return static_cast<T>(v);
+    }
+    else{
+      const auto v = std::strtoll(r.text().c_str(), nullptr, 10);
+      if(errno != ERANGE) return static_cast<T>(v);
+    }
+    throw_bad_cast<T>("raw_number(" + r.text() + ")");
+  }
+
+  template <typename T, std::enable_if_t<is_floating_point_compatible<T>::value, bool> = true>
+  static T convert_raw_number(const raw_number& r) {
+    return static_cast<T>(std::strtod(r.text().c_str(), nullptr));
+  }
+
+  /** 数値のハッシュ値（整数値の浮動小数点は整数と同じ値にする） */
+  static std::size_t number_hash(const basic_json& j) {
+    if(j.value_type_id() == value_type_id::raw_number){
+      return number_hash(j.resolve_number());
+    }
+    if(j.value_type_id() == value_type_id::integral){
+      return std::hash<int64_t>()(j.m_value.get<int64_t>());
+    }
+    const double d = j.m_value.get<double>();
+    if(d >= -9223372036854775808.0 && d < 9223372036854775808.0 && d == static_cast<double>(static_cast<int64_t>(d))){
+      return std::hash<int64_t>()(static_cast<int64_t>(d));
+    }
+    uint64_t bits;
+    std::memcpy(&bits, &d, sizeof(bits));
+    return std::hash<uint64_t>()(bits);
+  }
+
+  /** 数値の比較（integral と floating_point は値で比較する。int64_t を double に丸めずに比較する） */
+  static bool number_equals(const basic_json& a, const basic_json& b) {
+    const bool ra = a.value_type_id() == value_type_id::raw_number;
+    const bool rb = b.value_type_id() == value_type_id::raw_number;
+    if(ra || rb){
+      if(ra && rb){
+        const auto& x = a.m_value.get<raw_number>();
+        const auto& y = b.m_value.get<raw_number>();
+        if(x.text() == y.text()) return true;
+        /** int64_t の範囲を超える整数同士は double に丸めずに比較する（整数の表記は一意） */
+        int64_t v;
+        if(x.is_integer() && y.is_integer() && !raw_number_to_integer(x, v) && !raw_number_to_integer(y, v)) return false;
+      }
+      return number_equals(ra ? a.resolve_number() : a, rb ? b.resolve_number() : b);
+    }
+    const bool ia = a.value_type_id() == value_type_id::integral;
+    const bool ib = b.value_type_id() == value_type_id::integral;
+    if(ia && ib) return a.m_value.get<int64_t>() == b.m_value.get<int64_t>();
+    if(!ia && !ib) return a.m_value.get<double>() == b.m_value.get<double>();
+    const int64_t i = ia ? a.m_value.get<int64_t>() : b.m_value.get<int64_t>();
+    const double d = ia ? b.m_value.get<double>() : a.m_value.get<double>();
+    return d >= -9223372036854775808.0 && d < 9223372036854775808.0 && static_cast<int64_t>(d) == i && d == static_cast<double>(static_cast<int64_t>(d));
+  }
+
+  static bool is_number_value(const basic_json& j) {
+    return j.value_type_id() == value_type_id::integral || j.value_type_id() == value_type_id::floating_point || j.value_type_id() == value_type_id::raw_number;
+  }
+
+  std::size_t compute_hash(bool cache) const {
+    const auto cached = m_value.hash_cache();
+    if(cached){
+      const auto h = cached->load(std::memory_order_relaxed);
+      if(h != 0) return h;
+    }
+    std::size_t h = static_cast<std::size_t>(is_number_value(*this) ? value_type_id::integral : value_type_id());
+    switch(value_type_id()){
+      case value_type_id::integral:
+      case value_type_id::floating_point:
+      case value_type_id::raw_number:     { h = hash_mix(h, number_hash(*this)); break; }
+      case value_type_id::boolean:        { h = hash_mix(h, m_value.get<bool>() ? 1 : 0); break; }
+      case value_type_id::string:         { h = hash_mix(h, std::hash<string_type>()(m_value.get<string_type>())); break; }
+      case value_type_id::array: {
+        for(const auto& v : m_value.get<array_type>()){
+          h = hash_mix(h, v.compute_hash(cache));
+        }
+        break;
+      }
+      case value_type_id::object: {
+        /** キーの順序に依存しないよう、各要素のハッシュ値を加算する */
+        std::size_t sum = 0;
+        for(const auto& kv : m_value.get<object_type>()){
+          sum += hash_mix(std::hash<string_type>()(kv.first), kv.second.compute_hash(cache));
+        }
+        h = hash_mix(h, sum);
+        break;
+      }
+      default: { break; }
+    }
+    if(h == 0) h = 1; /** 0 は未計算を表す */
+    /** 共有されている値は変更されないため常にキャッシュする */
+    if(cached && (cache || m_value.use_count() > 1)){
+      cached->store(h, std::memory_order_relaxed);
+    }
+    return h;
+  }
+
   /** const json& で undefined を返却する場合のインスタンス保有をする */
-  static const json& undefined() {
-    static const json undefined_const;
+  static const basic_json& undefined() {
+    static const basic_json undefined_const;
     return undefined_const;
   }
 
@@ -236,44 +614,44 @@ public:
   /************** インスタンス生成・破棄 ***************/
 
   /** デフォルト・コピー・ムーブ */
-  json() = default;
-  json(const json& s) : m_value(s.m_value) {}
-  json(json&& s) : m_value(std::move(s.m_value)) {}
+  basic_json() = default;
+  basic_json(const basic_json& s) : m_value(s.m_value) {}
+  basic_json(basic_json&& s) : m_value(std::move(s.m_value)) {}
 
   /** 整数型（内部では int64_t） */
   template <typename T, std::enable_if_t<is_integer_compatible<T>::value, bool> = true>
-  json(const T& v) : m_value(static_cast<int64_t>(v)) {}
+  basic_json(const T& v) : m_value(static_cast<int64_t>(v)) {}
 
   /** 浮動小数点型（内部では double） */
   template <typename T, std::enable_if_t<is_floating_point_compatible<T>::value, bool> = true>
-  json(const T& v) : m_value(static_cast<double>(v)) {}
+  basic_json(const T& v) : m_value(static_cast<double>(v)) {}
 
   /** その他の許容可能な型 */
   template <typename T, std::enable_if_t<
     pure_value_type_traits<T>::available &&
     (!is_number_type<T>::value)
   , bool> = true>
-  json(T&& v) : m_value(std::forward<T>(v)) {}
+  basic_json(T&& v) : m_value(std::forward<T>(v)) {}
 
-  /** C文字列を受け入れる（内部では std::string） */
-  json(const char* v) : m_value(std::string(v)) {}
+  /** C文字列を受け入れる（内部では string_type） */
+  basic_json(const char* v) : m_value(string_type(v)) {}
 
   /** object型の initialize_list で構築*/
-  json(std::initializer_list<object_type::value_type>&& list) : m_value(object_type(list)) {}
+  basic_json(std::initializer_list<typename object_type::value_type>&& list) : m_value(object_type(list)) {}
 
   /** デストラクタ */
-  ~json() = default;
+  ~basic_json() = default;
 
 
   /************** 設定（関数） ***************/
-  void set(const json& src) { m_value = src.m_value; }
-  void set(json&& j) {
+  void set(const basic_json& src) { m_value = src.m_value; }
+  void set(basic_json&& j) {
     m_value = std::move(j.m_value);
   }
 
   /************** 設定（代入） ***************/
-  json& operator =(const json& j) { set(j); return *this; }
-  json& operator =(json&& j) { set(std::move(j)); return *this; }
+  basic_json& operator =(const basic_json& j) { set(j); return *this; }
+  basic_json& operator =(basic_json&& j) { set(std::move(j)); return *this; }
 
 
   /************** 取得 ***************/
@@ -287,6 +665,9 @@ public:
     else if(m_value.value_type_id() == value_type_id::floating_point){
       return static_cast<T>(m_value.get<double>());
     }
+    else if(m_value.value_type_id() == value_type_id::raw_number){
+      return convert_raw_number<T>(m_value.get<raw_number>());
+    }
     else{
       throw_bad_cast<T>(m_value.value_type_string());
     }
@@ -316,12 +697,24 @@ public:
 
   /************** メモリ管理 ***************/
   /** 自身を複製する（deep copy） */
-  json clone() const {
-    json j;
+  basic_json clone() const {
+    basic_json j;
     j.m_value= m_value.clone();
     return j;
   }
 
+  /**
+   * raw_number を integral（int64_t の範囲の整数）または floating_point に変換した値を返却する。
+   * raw_number 以外はそのまま複製する。
+   **/
+  basic_json resolve_number() const {
+    if(value_type_id() != value_type_id::raw_number) return clone();
+    const auto& r = m_value.get<raw_number>();
+    int64_t v;
+    if(raw_number_to_integer(r, v)) return basic_json(v);
+    return basic_json(convert_raw_number<double>(r));
+  }
+
   /** 保持している値を開放し、開放された値を返却する。 json は undefined となる。 */
   template <typename T, std::enable_if_t<value_type_traits<T>::available, bool> = true>
   T release() {
@@ -329,9 +722,60 @@ public:
   }
 
 
+  /************** 比較・ハッシュ ***************/
+  /**
+   * 構造の比較。数値は integral / floating_point を区別せず値で比較し、object はキーの順序を区別しない。
+   * 同じ領域を共有している値（dedup_pool 等）は中身を比較しない。
+   * キャッシュしたハッシュ値は取得済みの参照を介した子の変更で古くなる場合があるため、比較には使用しない。
+   **/
+  bool operator ==(const basic_json& j) const {
+    if(is_number_value(*this) && is_number_value(j)){
+      return number_equals(*this, j);
+    }
+    if(value_type_id() != j.value_type_id()) return false;
+    const auto pa = m_value.payload_address();
+    if(pa && pa == j.m_value.payload_address()) return true;
+    switch(value_type_id()){
+      case value_type_id::boolean:  { return m_value.get<bool>() == j.m_value.get<bool>(); }
+      case value_type_id::string:   { return m_value.get<string_type>() == j.m_value.get<string_type>(); }
+      case value_type_id::array: {
+        const auto& x = m_value.get<array_type>();
+        const auto& y = j.m_value.get<array_type>();
+        if(x.size() != y.size()) return false;
+        for(std::size_t i = 0; i < x.size(); i++){
+          if(!(x[i] == y[i])) return false;
+        }
+        return true;
+      }
+      case value_type_id::object: {
+        const auto& x = m_value.get<object_type>();
+        const auto& y = j.m_value.get<object_type>();
+        if(x.size() != y.size()) return false;
+        for(const auto& kv : x){
+          auto it = y.find(kv.first);
+          if(it == y.end() || !(kv.second == it->second)) return false;
+        }
+        return true;
+      }
+      default: /** null, undefined */ { return true; }
+    }
+  }
+
+  bool operator !=(const basic_json& j) const { return !(*this == j); }
+
+  /**
+   * operator == と矛盾しない構造のハッシュ値。
+   * 共有されている値のハッシュ値は常にキャッシュする。
+   * cache = true の場合は全ての string / array / object のハッシュ値をキャッシュし、２回目以降は O(1) となる。
+   * キャッシュは非 const で取得した時点で破棄されるが、取得済みの参照を介して子を変更した場合は親のキャッシュが残る点に注意すること。
+   **/
+  std::size_t hash(bool cache = false) const {
+    return compute_hash(cache);
+  }
+
   /************** 状態・属性 ***************/
   /** 値の型を取得 */
-  const value_type_id value_type_id() const { return m_value.value_type_id(); }
+  const enum value_type_id value_type_id() const { return m_value.value_type_id(); }
 
   /* undefined, null 確認用関数 */
   bool is_undefined() const         { return value_type_id() == value_type_id::undefined; }
@@ -344,8 +788,7 @@ public:
   /** T で取得可能か判定する */
   template<typename T, std::enable_if_t<is_number_type<T>::value, bool> = true>
   bool acquirable() const {
-    auto&& self_type_id = value_type_id();
-    return self_type_id == value_type_id::integral || self_type_id == value_type_id::floating_point;
+    return is_number_value(*this);
   }
 
   template<typename T, std::enable_if_t<value_type_traits<T>::available && !is_number_type<T>::value, bool> = true>
@@ -357,54 +800,72 @@ public:
   /** object型に対する [] アクセス */
 
   /** const では見つからない場合、 undefined を返却する */
-  const json& operator [](const char * key) const {
+  const basic_json& operator [](const char * key) const {
     if(value_type_id() != value_type_id::object) return undefined();
     auto&& obj = get<object_type>();
     auto it = obj.find(key);
     return it != obj.end() ? it->second : undefined();
   }
 
-  const json& operator [](const std::string& key) const {
+  const basic_json& operator [](const std::string& key) const {
     return (*this)[key.c_str()];
   }
 
   /** 非const では見つからない場合、 object を作成する */
-  json& operator [](const char * key) {
+  basic_json& operator [](const char * key) {
     if(value_type_id() != value_type_id::object){
       m_value.set(object_type());
     }
     auto&& obj = get<object_type>();
     auto it = obj.find(key);
     if(it != obj.end()) return it->second;
-    obj[key] = json();
+    obj[key] = basic_json();
     return obj[key];
   }
 
-  json& operator [](const std::string& key) {
+  basic_json& operator [](const std::string& key) {
     return (*this)[key.c_str()];
   }
 
   /** array型に対する [] アクセス */
 
   /** const では見つからない場合、 undefined を返却する */
-  const json& operator [](int index) const {
+  const basic_json& operator [](int index) const {
     if(value_type_id() != value_type_id::array) return undefined();
     auto&& arr = get<array_type>();
     return (index < arr.size()) ? arr[index] : undefined();
   }
 
   /** 非const では見つからない場合、 欠番を nullptr で埋める */
-  json& operator [](int index) {
+  basic_json& operator [](int index) {
     if(value_type_id() != value_type_id::array){
       m_value.set(array_type());
     }
     auto&& arr = get<array_type>();
     if(index < arr.size()) return arr[index];
-    arr.resize(index + 1, json(nullptr));
+    arr.resize(index + 1, basic_json(nullptr));
     return arr[index];
   }
 
 };
+
+/** 既定の文字列・コンテナを使用する json */
+using json = basic_json<json_traits>;
+
+/** T が basic_json またはその派生クラス（array / object）であるか判定する */
+template <typename T> struct is_basic_json {
+private:
+  template <typename Traits> static std::true_type test(const basic_json<Traits>*);
+  static std::false_type test(...);
+public:
+  static constexpr bool value = decltype(test(static_cast<const T*>(nullptr)))::value;
+};
 } /** namespace cppjson */
 
+namespace std {
+  template <typename Traits> struct hash<cppjson::basic_json<Traits>> {
+    std::size_t operator()(const cppjson::basic_json<Traits>& j) const { return j.hash(); }
+  };
+}
+
 #endif /* !defined(__cppjson_h_json__) */
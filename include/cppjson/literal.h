@@ -0,0 +1,333 @@
+#if !defined(__cppjson_h_literal__)
+#define __cppjson_h_literal__
+
+#include "json.h"
+#include "deserializer.h"
+#include "utf8.h"
+#include <sstream>
+
+namespace cppjson {
+
+/**
+ * ソースコードに埋め込む json のリテラル。
+ * literal::valid() はコンパイル時に評価でき、CPPJSON_LITERAL() / _json（C++20）は不正なリテラルをコンパイルエラーにする。
+ * const json& conf = CPPJSON_LITERAL(R"({"retry": 3, "hosts": ["a", "b"]})");
+ *
+ * valid() は deserializer が受理する文法の部分集合（RFC 8259 に準拠した値とコメント）のみを正しいと判定するため、
+ * valid() が true であれば実行時の解析は失敗しない（double の範囲の境界付近の浮動小数点は安全側に倒して不正とする）。
+ * 値は最初に参照した時点で１度だけ解析し、静的な初期化（main の前）では解析しない。
+ **/
+class literal {
+private:
+  static constexpr std::size_t max_depth = 256;
+
+  struct cursor {
+    const char* s;
+    std::size_t pos;
+  };
+
+  static constexpr char peek(const cursor& c, std::size_t n = 0) { return c.s[c.pos + n]; }
+  static constexpr bool is_digit(char c) { return c >= '0' && c <= '9'; }
+  static constexpr bool is_hex(char c) { return is_digit(c) || (c >= 'a' && c <= 'f') || (c >= 'A' && c <= 'F'); }
+
+  /** 空白とコメントを読み飛ばす（閉じていないブロックコメントは false） */
+  static constexpr bool skip_space(cursor& c) {
+    for(;;){
+      const char ch = peek(c);
+      if(ch == ' ' || ch == '\t' || ch == '\r' || ch == '\n' || ch == '\v' || ch == '\f'){
+        c.pos++;
+      }
+      else if(ch == '/' && peek(c, 1) == '/'){
+        c.pos += 2;
+        while(peek(c) != '\0' && peek(c) != '\n' && peek(c) != '\r') c.pos++;
+      }
+      else if(ch == '/' && peek(c, 1) == '*'){
+        c.pos += 2;
+        while(!(peek(c) == '*' && peek(c, 1) == '/')){
+          if(peek(c) == '\0') return false;
+          c.pos++;
+        }
+        c.pos += 2;
+      }
+      else{
+        return true;
+      }
+    }
+  }
+
+  static constexpr uint32_t hex_value(char c) {
+    return is_digit(c) ? static_cast<uint32_t>(c - '0') : (c >= 'a' && c <= 'f') ? static_cast<uint32_t>(c - 'a' + 10) : static_cast<uint32_t>(c - 'A' + 10);
+  }
+
+  /** c.s[c.pos + n] から 4 つの HEX 文字（不正な場合は false） */
+  static constexpr bool hex4(const cursor& c, std::size_t n, uint32_t& v) {
+    v = 0;
+    for(std::size_t i = 0; i < 4; i++){
+      if(!is_hex(peek(c, n + i))) return false;
+      v = (v << 4) | hex_value(peek(c, n + i));
+    }
+    return true;
+  }
+
+  /** 文字列（先頭は '"'）。length に文字列のバイト数（エスケープ前）を設定する */
+  static constexpr bool string(cursor& c, std::size_t& length) {
+    c.pos++;
+    const auto start = c.pos;
+    for(;;){
+      const auto ch = static_cast<unsigned char>(peek(c));
+      if(ch == '"'){
+        length = c.pos - start;
+        c.pos++;
+        return true;
+      }
+      if(ch < 0x20) return false; /** 終端と制御文字 */
+      if(ch == '\\'){
+        const char e = peek(c, 1);
+        if(e == 'u'){
+          /** サロゲートは対であること */
+          uint32_t unit = 0;
+          uint32_t low = 0;
+          if(!hex4(c, 2, unit) || utf8::is_low_surrogate(unit)) return false;
+          if(utf8::is_high_surrogate(unit)){
+            if(peek(c, 6) != '\\' || peek(c, 7) != 'u' || !hex4(c, 8, low) || !utf8::is_low_surrogate(low)) return false;
+            c.pos += 6;
+          }
+          c.pos += 6;
+        }
+        else if(e == '"' || e == '\\' || e == '/' || e == 'b' || e == 'f' || e == 'n' || e == 'r' || e == 't'){
+          c.pos += 2;
+        }
+        else{
+          return false;
+        }
+      }
+      else if(ch >= 0x80){
+        std::size_t invalid = 0;
+        const auto n = utf8::sequence_length(c.s + c.pos, invalid);
+        if(n == 0) return false;
+        c.pos += n;
+      }
+      else{
+        c.pos++;
+      }
+    }
+  }
+
+  /** 数値（RFC 8259）。整数は int64_t の範囲、浮動小数点は double の正規化数の範囲を判定する */
+  static constexpr bool number(cursor& c) {
+    const bool negative = peek(c) == '-';
+    if(negative) c.pos++;
+    const auto int_begin = c.pos;
+    if(peek(c) == '0'){
+      c.pos++;
+    }
+    else if(is_digit(peek(c))){
+      while(is_digit(peek(c))) c.pos++;
+    }
+    else{
+      return false;
+    }
+    const auto int_end = c.pos;
+    bool is_float = false;
+    std::size_t frac_begin = 0;
+    std::size_t frac_end = 0;
+    if(peek(c) == '.'){
+      c.pos++;
+      if(!is_digit(peek(c))) return false;
+      frac_begin = c.pos;
+      while(is_digit(peek(c))) c.pos++;
+      frac_end = c.pos;
+      is_float = true;
+    }
+    long exponent = 0;
+    if(peek(c) == 'e' || peek(c) == 'E'){
+      c.pos++;
+      bool exponent_negative = false;
+      if(peek(c) == '+' || peek(c) == '-'){
+        exponent_negative = peek(c) == '-';
+        c.pos++;
+      }
+      if(!is_digit(peek(c))) return false;
+      while(is_digit(peek(c))){
+        if(exponent < 100000) exponent = exponent * 10 + (peek(c) - '0');
+        c.pos++;
+      }
+      if(exponent_negative) exponent = -exponent;
+      is_float = true;
+    }
+
+    if(!is_float){
+      /** int64_t の範囲 */
+      const char* limit = negative ? "9223372036854775808" : "9223372036854775807";
+      const auto digits = int_end - int_begin;
+      if(digits != 19) return digits < 19;
+      for(std::size_t i = 0; i < digits; i++){
+        if(c.s[int_begin + i] != limit[i]) return c.s[int_begin + i] < limit[i];
+      }
+      return true;
+    }
+
+    /** 先頭の 0 でない数字の桁（10 の指数）で範囲を判定し、境界の桁では有効数字を double の最大値・正規化数の最小値と比較する */
+    long magnitude = 0;
+    std::size_t first = 0;
+    bool found = false;
+    for(auto i = int_begin; i < int_end && !found; i++){
+      if(c.s[i] != '0'){
+        magnitude = static_cast<long>(int_end - i) - 1;
+        first = i;
+        found = true;
+      }
+    }
+    for(auto i = frac_begin; i < frac_end && !found; i++){
+      if(c.s[i] != '0'){
+        magnitude = -static_cast<long>(i - frac_begin) - 1;
+        first = i;
+        found = true;
+      }
+    }
+    if(!found) return true; /** 0 */
+    magnitude += exponent;
+    const auto last = frac_end != 0 ? frac_end : int_end;
+    if(magnitude == 308) return compare_digits(c, first, last, "17976931348623157") <= 0;
+    if(magnitude == -308) return compare_digits(c, first, last, "22250738585072014") >= 0;
+    return magnitude < 308 && magnitude > -308;
+  }
+
+  /** first から last までの有効数字（小数点を除く）と limit を比較する */
+  static constexpr int compare_digits(const cursor& c, std::size_t first, std::size_t last, const char* limit) {
+    std::size_t n = 0;
+    for(auto i = first; i < last; i++){
+      const char d = c.s[i];
+      if(d == '.') continue;
+      if(limit[n] == '\0'){
+        if(d != '0') return 1;
+      }
+      else if(d != limit[n]){
+        return d < limit[n] ? -1 : 1;
+      }
+      else{
+        n++;
+      }
+    }
+    return limit[n] == '\0' ? 0 : -1;
+  }
+
+  static constexpr bool word(cursor& c, const char* w) {
+    for(std::size_t i = 0; w[i] != '\0'; i++){
+      if(peek(c, i) != w[i]) return false;
+    }
+    while(w[0] != '\0'){
+      c.pos++;
+      w++;
+    }
+    return true;
+  }
+
+  static constexpr bool value(cursor& c, std::size_t depth) {
+    if(!skip_space(c)) return false;
+    const char ch = peek(c);
+    if(ch == '{'){
+      if(depth >= max_depth) return false;
+      c.pos++;
+      if(!skip_space(c)) return false;
+      if(peek(c) == '}'){
+        c.pos++;
+        return true;
+      }
+      for(;;){
+        std::size_t length = 0;
+        if(peek(c) != '"' || !string(c, length) || length == 0) return false; /** 空のキーは deserializer が受理しない */
+        if(!skip_space(c) || peek(c) != ':') return false;
+        c.pos++;
+        if(!value(c, depth + 1) || !skip_space(c)) return false;
+        if(peek(c) == '}'){
+          c.pos++;
+          return true;
+        }
+        if(peek(c) != ',') return false;
+        c.pos++;
+        if(!skip_space(c)) return false;
+      }
+    }
+    if(ch == '['){
+      if(depth >= max_depth) return false;
+      c.pos++;
+      if(!skip_space(c)) return false;
+      if(peek(c) == ']'){
+        c.pos++;
+        return true;
+      }
+      for(;;){
+        if(!value(c, depth + 1) || !skip_space(c)) return false;
+        if(peek(c) == ']'){
+          c.pos++;
+          return true;
+        }
+        if(peek(c) != ',') return false;
+        c.pos++;
+      }
+    }
+    if(ch == '"'){
+      std::size_t length = 0;
+      return string(c, length);
+    }
+    if(ch == 't') return word(c, "true");
+    if(ch == 'f') return word(c, "false");
+    if(ch == 'n') return word(c, "null");
+    if(ch == '-' || is_digit(ch)) return number(c);
+    return false;
+  }
+
+public:
+  /** s（'\0' 終端）が１つの値（前後の空白・コメントを含む）であれば true */
+  static constexpr bool valid(const char* s) {
+    cursor c{s, 0};
+    return value(c, 0) && skip_space(c) && peek(c) == '\0';
+  }
+
+  /** 実行時に解析する（不正な場合は bad_json を送出する） */
+  static json parse(const char* s, std::size_t size) {
+    std::stringstream ss(std::string(s, size));
+    return deserializer(ss).execute();
+  }
+};
+
+namespace literals {
+#if defined(__cpp_nontype_template_args) && __cpp_nontype_template_args >= 201911L
+  /** C++20 : 文字列リテラルをテンプレート引数として受け取り、コンパイル時に検証する */
+  template <std::size_t N>
+  struct literal_string {
+    char data[N];
+    constexpr literal_string(const char (&s)[N]) : data() {
+      for(std::size_t i = 0; i < N; i++) data[i] = s[i];
+    }
+  };
+
+  /** "..."_json は最初に参照した時点で１度だけ解析した json を返却する */
+  template <literal_string S>
+  const json& operator ""_json() {
+    static_assert(literal::valid(S.data), "invalid json literal");
+    static const json j = literal::parse(S.data, sizeof(S.data) - 1);
+    return j;
+  }
+#else
+  /** C++14 / C++17 : 実行時に解析する（コンパイル時の検証は CPPJSON_LITERAL を使用する） */
+  inline json operator "" _json(const char* s, std::size_t size) {
+    return literal::parse(s, size);
+  }
+#endif
+} /** namespace literals */
+
+} /** namespace cppjson */
+
+/**
+ * text（文字列リテラル）をコンパイル時に検証し、最初に参照した時点で１度だけ解析した json を返却する（C++14 以降）
+ **/
+#define CPPJSON_LITERAL(text) \
+  ([]() -> const cppjson::json& { \
+    static_assert(cppjson::literal::valid(text), "invalid json literal"); \
+    static const cppjson::json j = cppjson::literal::parse(text, sizeof(text) - 1); \
+    return j; \
+  }())
+
+#endif /* !defined(__cppjson_h_literal__) */
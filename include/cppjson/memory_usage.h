@@ -0,0 +1,232 @@
+#if !defined(__cppjson_h_memory_usage__)
+#define __cppjson_h_memory_usage__
+
+#include "json.h"
+#include <array>
+#include <algorithm>
+#include <unordered_set>
+
+namespace cppjson {
+
+/**
+ * json が保持しているヒープ領域の内訳。
+ * json 自身（ルート）の領域は含まず、ルートから辿れる全ての領域を集計する。
+ * unordered_map のノードとバケットの大きさは、標準ライブラリの一般的な実装
+ * （ノード = 次ノードへのポインタ + ハッシュ値 + 要素、バケット = ポインタの配列）に基づく推定値である。
+ * malloc の管理領域・アラインメントによる切り上げは含まない。
+ * dedup_pool 等で共有されている値は１度だけ集計する（２度目以降は shared_references に計上し、子を辿らない）。
+ **/
+struct memory_usage {
+  struct usage {
+    std::size_t bytes = 0;
+    std::size_t allocations = 0;
+
+    usage& operator +=(const usage& u) {
+      bytes += u.bytes;
+      allocations += u.allocations;
+      return *this;
+    }
+  };
+
+  /** 全体 */
+  usage total;
+
+  /** 値の型ごとの内訳（合計は total と一致する。子の値はそれぞれの型に計上する） */
+  std::array<usage, 9> by_type;
+
+  /** 用途ごとの内訳（合計は total と一致する） */
+  usage holders;              /** value_container が new した std::string / array_type / object_type / raw_number 自身（参照数を含む） */
+  usage string_payload;       /** 文字列値と raw_number の文字領域（SSO に収まる場合は 0） */
+  usage key_payload;          /** object のキーの文字領域（SSO に収まる場合は 0） */
+  usage container_overhead;   /** array のバッファ、object のノードとバケット */
+
+  /** container_overhead のうち、array の未使用領域（capacity - size） */
+  std::size_t array_slack_bytes = 0;
+  /** container_overhead のうち、object のバケット配列 */
+  std::size_t bucket_bytes = 0;
+
+  /** 値の数（ルートを含む。共有されている値の子は１度だけ数える） */
+  std::size_t nodes = 0;
+  /** 集計済みの共有された値を参照していた数 */
+  std::size_t shared_references = 0;
+  std::array<std::size_t, 9> nodes_by_type;
+
+  /** 入れ子の深さ（array / object を含まない場合は 0） */
+  std::size_t max_depth = 0;
+
+  /** 最大の要素数・文字数 */
+  std::size_t largest_array = 0;
+  std::size_t largest_object = 0;
+  std::size_t largest_string = 0;
+
+  memory_usage() {
+    nodes_by_type.fill(0);
+  }
+
+  const usage& of(enum json::value_type_id type) const { return by_type[static_cast<std::size_t>(type)]; }
+  std::size_t count(enum json::value_type_id type) const { return nodes_by_type[static_cast<std::size_t>(type)]; }
+
+  /** メトリクスへの出力用 */
+  json to_json() const {
+    auto u = [](const usage& x) -> json {
+      return {{"bytes", x.bytes}, {"allocations", x.allocations}};
+    };
+    json types = json::object_type();
+    for(std::size_t i = 0; i < by_type.size(); i++){
+      const auto type = static_cast<enum json::value_type_id>(i);
+      types[json::value_type_string(type)] = {
+        {"nodes", nodes_by_type[i]},
+        {"bytes", by_type[i].bytes},
+        {"allocations", by_type[i].allocations}
+      };
+    }
+    return {
+      {"total", u(total)},
+      {"by_type", types},
+      {"holders", u(holders)},
+      {"string_payload", u(string_payload)},
+      {"key_payload", u(key_payload)},
+      {"container_overhead", u(container_overhead)},
+      {"array_slack_bytes", array_slack_bytes},
+      {"bucket_bytes", bucket_bytes},
+      {"nodes", nodes},
+      {"shared_references", shared_references},
+      {"max_depth", max_depth},
+      {"largest_array", largest_array},
+      {"largest_object", largest_object},
+      {"largest_string", largest_string}
+    };
+  }
+};
+
+/**
+ * json を走査して memory_usage を集計する。
+ * memory_usage usage = memory_inspector(j).execute();
+ **/
+class memory_inspector {
+private:
+  const json& m_json;
+
+  using usage = memory_usage::usage;
+  template <typename T> using payload = json::payload<T>;
+
+  /** 文字列の文字領域（SSO の容量を超える場合のみヒープを確保する） */
+  static usage string_heap(const std::string& s) {
+    static const std::size_t sso_capacity = std::string().capacity();
+    usage u;
+    if(s.capacity() > sso_capacity){
+      u.bytes = s.capacity() + 1;
+      u.allocations = 1;
+    }
+    return u;
+  }
+
+  static usage holder(std::size_t size) {
+    usage u;
+    u.bytes = size;
+    u.allocations = 1;
+    return u;
+  }
+
+  static void proceed(const json& j, std::size_t depth, memory_usage& m, std::unordered_set<const void*>& shared) {
+    if(j.m_value.use_count() > 1 && !shared.insert(j.m_value.payload_address()).second){
+      m.shared_references++;
+      return;
+    }
+    const auto type = j.value_type_id();
+    const auto index = static_cast<std::size_t>(type);
+    auto& self = m.by_type[index];
+    m.nodes++;
+    m.nodes_by_type[index]++;
+
+    switch(type){
+      case json::value_type_id::string: {
+        const auto& s = j.get<std::string>();
+        const auto h = holder(sizeof(payload<std::string>));
+        const auto chars = string_heap(s);
+        m.holders += h;
+        m.string_payload += chars;
+        self += h;
+        self += chars;
+        m.largest_string = std::max(m.largest_string, s.size());
+        break;
+      }
+      case json::value_type_id::raw_number: {
+        const auto h = holder(sizeof(payload<json::raw_number>));
+        const auto chars = string_heap(j.get<json::raw_number>().text());
+        m.holders += h;
+        m.string_payload += chars;
+        self += h;
+        self += chars;
+        break;
+      }
+      case json::value_type_id::array: {
+        const auto& arr = j.get<json::array_type>();
+        const auto h = holder(sizeof(payload<json::array_type>));
+        usage buffer;
+        if(arr.capacity() > 0){
+          buffer.bytes = arr.capacity() * sizeof(json);
+          buffer.allocations = 1;
+        }
+        m.holders += h;
+        m.container_overhead += buffer;
+        m.array_slack_bytes += (arr.capacity() - arr.size()) * sizeof(json);
+        self += h;
+        self += buffer;
+        m.largest_array = std::max(m.largest_array, arr.size());
+        m.max_depth = std::max(m.max_depth, depth + 1);
+        for(const auto& v : arr){
+          proceed(v, depth + 1, m, shared);
+        }
+        break;
+      }
+      case json::value_type_id::object: {
+        const auto& obj = j.get<json::object_type>();
+        const auto h = holder(sizeof(payload<json::object_type>));
+        usage nodes;
+        nodes.bytes = obj.size() * (sizeof(void*) + sizeof(std::size_t) + sizeof(json::object_type::value_type));
+        nodes.allocations = obj.size();
+        usage buckets;
+        if(obj.bucket_count() > 1){
+          buckets.bytes = obj.bucket_count() * sizeof(void*);
+          buckets.allocations = 1;
+        }
+        m.holders += h;
+        m.container_overhead += nodes;
+        m.container_overhead += buckets;
+        m.bucket_bytes += buckets.bytes;
+        self += h;
+        self += nodes;
+        self += buckets;
+        m.largest_object = std::max(m.largest_object, obj.size());
+        m.max_depth = std::max(m.max_depth, depth + 1);
+        for(const auto& kv : obj){
+          const auto key = string_heap(kv.first);
+          m.key_payload += key;
+          self += key;
+          proceed(kv.second, depth + 1, m, shared);
+        }
+        break;
+      }
+      default: {
+        break; /** value_container 内に直接保持するためヒープを使用しない */
+      }
+    }
+  }
+
+public:
+  memory_inspector(const json& j) : m_json(j) {}
+
+  memory_usage execute() const {
+    memory_usage m;
+    std::unordered_set<const void*> shared;
+    proceed(m_json, 0, m, shared);
+    for(const auto& u : m.by_type){
+      m.total += u;
+    }
+    return m;
+  }
+};
+
+} /** namespace cppjson */
+#endif /* !defined(__cppjson_h_memory_usage__) */
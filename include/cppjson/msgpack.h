@@ -0,0 +1,339 @@
+#if !defined(__cppjson_h_msgpack__)
+#define __cppjson_h_msgpack__
+
+#include "json.h"
+#include <ostream>
+#include <cstring>
+#include <limits>
+
+namespace cppjson {
+
+/**
+ * MessagePack との相互変換。
+ * 整数・浮動小数点・文字列・array・map は値に応じて最も短いフォーマットを選択する。
+ * （浮動小数点は float32 で誤差無く表現できる場合は float32）
+ * MessagePack には undefined が無いため、serializer と同様に nil として出力する。
+ * map のキーが重複する場合は deserializer と同じく最初の値を採用する。
+ **/
+class msgpack_serializer {
+private:
+  const json& m_json;
+
+  static void write_be(std::string& out, uint64_t value, int bytes) {
+    char buf[8];
+    for(auto i = 0; i < bytes; i++){
+      buf[i] = static_cast<char>(value >> ((bytes - 1 - i) * 8));
+    }
+    out.append(buf, bytes);
+  }
+
+  static void write_marker(std::string& out, uint8_t marker, uint64_t value, int bytes) {
+    out += static_cast<char>(marker);
+    write_be(out, value, bytes);
+  }
+
+  static void write_integer(std::string& out, int64_t v) {
+    if(v >= 0){
+      if(v <= 0x7F)               { out += static_cast<char>(v); }
+      else if(v <= 0xFF)          { write_marker(out, 0xCC, v, 1); }
+      else if(v <= 0xFFFF)        { write_marker(out, 0xCD, v, 2); }
+      else if(v <= 0xFFFFFFFFll)  { write_marker(out, 0xCE, v, 4); }
+      else                        { write_marker(out, 0xCF, v, 8); }
+    }
+    else{
+      const auto u = static_cast<uint64_t>(v);
+      if(v >= -32)                { out += static_cast<char>(v); }
+      else if(v >= INT8_MIN)      { write_marker(out, 0xD0, u, 1); }
+      else if(v >= INT16_MIN)     { write_marker(out, 0xD1, u, 2); }
+      else if(v >= INT32_MIN)     { write_marker(out, 0xD2, u, 4); }
+      else                        { write_marker(out, 0xD3, u, 8); }
+    }
+  }
+
+  static void write_double(std::string& out, double v) {
+    const float f = static_cast<float>(v);
+    if(static_cast<double>(f) == v || v != v){
+      uint32_t bits;
+      std::memcpy(&bits, &f, sizeof(bits));
+      write_marker(out, 0xCA, bits, 4);
+    }
+    else{
+      uint64_t bits;
+      std::memcpy(&bits, &v, sizeof(bits));
+      write_marker(out, 0xCB, bits, 8);
+    }
+  }
+
+  static void write_string(std::string& out, const std::string& s) {
+    const auto n = s.size();
+    if(n < 32)            { out += static_cast<char>(0xA0 | n); }
+    else if(n <= 0xFF)    { write_marker(out, 0xD9, n, 1); }
+    else if(n <= 0xFFFF)  { write_marker(out, 0xDA, n, 2); }
+    else                  { write_marker(out, 0xDB, n, 4); }
+    out.append(s);
+  }
+
+  static void write_container(std::string& out, uint8_t fix, uint8_t marker16, std::size_t n) {
+    if(n < 16)            { out += static_cast<char>(fix | n); }
+    else if(n <= 0xFFFF)  { write_marker(out, marker16, n, 2); }
+    else                  { write_marker(out, marker16 + 1, n, 4); }
+  }
+
+  static void proceed(std::string& out, const json& j) {
+    switch(j.value_type_id()){
+      case json::value_type_id::integral: {
+        write_integer(out, j.get<int64_t>());
+        break;
+      }
+      case json::value_type_id::floating_point: {
+        write_double(out, j.get<double>());
+        break;
+      }
+      case json::value_type_id::raw_number: {
+        proceed(out, j.resolve_number());
+        break;
+      }
+      case json::value_type_id::boolean: {
+        out += static_cast<char>(j.get<bool>() ? 0xC3 : 0xC2);
+        break;
+      }
+      case json::value_type_id::string: {
+        write_string(out, j.get<std::string>());
+        break;
+      }
+      case json::value_type_id::array: {
+        const auto& arr = j.get<json::array_type>();
+        write_container(out, 0x90, 0xDC, arr.size());
+        for(const auto& v : arr){
+          proceed(out, v);
+        }
+        break;
+      }
+      case json::value_type_id::object: {
+        const auto& obj = j.get<json::object_type>();
+        write_container(out, 0x80, 0xDE, obj.size());
+        for(const auto& kv : obj){
+          write_string(out, kv.first);
+          proceed(out, kv.second);
+        }
+        break;
+      }
+      case json::value_type_id::null:
+      case json::value_type_id::undefined: {
+        out += static_cast<char>(0xC0);
+        break;
+      }
+    }
+  }
+
+public:
+  msgpack_serializer(const json& j) : m_json(j) {}
+
+  void execute(std::ostream& os) const {
+    const auto s = execute();
+    os.write(s.data(), s.size());
+  }
+
+  void execute(std::string& out) const {
+    proceed(out, m_json);
+  }
+
+  std::string execute() const {
+    std::string out;
+    execute(out);
+    return out;
+  }
+};
+
+/**
+ * MessagePack のバイト列から json を生成する。
+ * 入力は連続したバッファを参照するだけで、文字列は直接 std::string へ一括コピーする。
+ * execute() を繰り返し呼び出すことで、バッファ上に連続したメッセージを順に読み出せる。
+ * bin 型は std::string として取り出す。ext 型は取り扱えない。
+ **/
+class msgpack_deserializer {
+private:
+  const uint8_t* m_begin;
+  const uint8_t* m_cur;
+  const uint8_t* m_end;
+
+  [[noreturn]] void throwError(const std::string& err) const {
+    std::stringstream ss;
+    ss << "offset(" << (m_cur - m_begin) << ") : " << err;
+    throw bad_msgpack(ss.str());
+  }
+
+  void require(std::size_t n) const {
+    if(static_cast<std::size_t>(m_end - m_cur) < n){
+      throwError("illegal eof");
+    }
+  }
+
+  uint64_t read_be(int bytes) {
+    require(bytes);
+    uint64_t v = 0;
+    for(auto i = 0; i < bytes; i++){
+      v = (v << 8) | m_cur[i];
+    }
+    m_cur += bytes;
+    return v;
+  }
+
+  /** 要素数が残りのバイト数を超えることは無いので、不正な入力で巨大な領域を確保しないよう確認する */
+  std::size_t checked_count(uint64_t n) const {
+    if(n > static_cast<uint64_t>(m_end - m_cur)){
+      throwError("illegal length");
+    }
+    return static_cast<std::size_t>(n);
+  }
+
+  void read_bytes(std::size_t n, std::string& s) {
+    n = checked_count(n);
+    s.assign(reinterpret_cast<const char*>(m_cur), n);
+    m_cur += n;
+  }
+
+  void read_array(std::size_t n, json& j) {
+    json::array_type arr;
+    arr.resize(checked_count(n));
+    for(auto& v : arr){
+      deserialize(v);
+    }
+    j.set(std::move(arr));
+  }
+
+  void read_map(std::size_t n, json& j) {
+    json::object_type obj;
+    obj.reserve(checked_count(n));
+    std::string key;
+    for(std::size_t i = 0; i < n; i++){
+      read_key(key);
+      if(obj.find(key) != obj.end()){
+        /** キーが重複する場合は、deserializer と同じく最初の値を採用する */
+        json ignored;
+        deserialize(ignored);
+        continue;
+      }
+      deserialize(obj[key]);
+    }
+    j.set(std::move(obj));
+  }
+
+  void read_key(std::string& key) {
+    require(1);
+    const uint8_t b = *m_cur++;
+    if((b & 0xE0) == 0xA0)  { read_bytes(b & 0x1F, key); return; }
+    switch(b){
+      case 0xC4:
+      case 0xD9: { read_bytes(read_be(1), key); return; }
+      case 0xC5:
+      case 0xDA: { read_bytes(read_be(2), key); return; }
+      case 0xC6:
+      case 0xDB: { read_bytes(read_be(4), key); return; }
+    }
+    m_cur--;
+    throwError("object key must be a string");
+  }
+
+  void read_unsigned(uint64_t v, json& j) {
+    if(v > static_cast<uint64_t>(std::numeric_limits<int64_t>::max())){
+      throwError("integer out of range");
+    }
+    j.set(static_cast<int64_t>(v));
+  }
+
+  void deserialize(json& j) {
+    require(1);
+    const uint8_t b = *m_cur++;
+
+    if(b <= 0x7F)           { j.set(static_cast<int64_t>(b)); return; }
+    if(b >= 0xE0)           { j.set(static_cast<int64_t>(static_cast<int8_t>(b))); return; }
+    if((b & 0xF0) == 0x80)  { read_map(b & 0x0F, j); return; }
+    if((b & 0xF0) == 0x90)  { read_array(b & 0x0F, j); return; }
+    if((b & 0xE0) == 0xA0)  {
+      std::string s;
+      read_bytes(b & 0x1F, s);
+      j.set(std::move(s));
+      return;
+    }
+
+    switch(b){
+      case 0xC0: { j.set(nullptr); return; }
+      case 0xC2: { j.set(false); return; }
+      case 0xC3: { j.set(true); return; }
+      case 0xC4:
+      case 0xC5:
+      case 0xC6:
+      case 0xD9:
+      case 0xDA:
+      case 0xDB: {
+        const int bytes = (b == 0xC4 || b == 0xD9) ? 1 : (b == 0xC5 || b == 0xDA) ? 2 : 4;
+        std::string s;
+        read_bytes(read_be(bytes), s);
+        j.set(std::move(s));
+        return;
+      }
+      case 0xCA: {
+        const auto bits = static_cast<uint32_t>(read_be(4));
+        float f;
+        std::memcpy(&f, &bits, sizeof(f));
+        j.set(static_cast<double>(f));
+        return;
+      }
+      case 0xCB: {
+        const auto bits = read_be(8);
+        double d;
+        std::memcpy(&d, &bits, sizeof(d));
+        j.set(d);
+        return;
+      }
+      case 0xCC: { read_unsigned(read_be(1), j); return; }
+      case 0xCD: { read_unsigned(read_be(2), j); return; }
+      case 0xCE: { read_unsigned(read_be(4), j); return; }
+      case 0xCF: { read_unsigned(read_be(8), j); return; }
+      case 0xD0: { j.set(static_cast<int64_t>(static_cast<int8_t>(read_be(1)))); return; }
+      case 0xD1: { j.set(static_cast<int64_t>(static_cast<int16_t>(read_be(2)))); return; }
+      case 0xD2: { j.set(static_cast<int64_t>(static_cast<int32_t>(read_be(4)))); return; }
+      case 0xD3: { j.set(static_cast<int64_t>(read_be(8))); return; }
+      case 0xDC: { read_array(read_be(2), j); return; }
+      case 0xDD: { read_array(read_be(4), j); return; }
+      case 0xDE: { read_map(read_be(2), j); return; }
+      case 0xDF: { read_map(read_be(4), j); return; }
+      default: {
+        m_cur--;
+        throwError("unsupported format");
+      }
+    }
+  }
+
+public:
+  msgpack_deserializer(const void* data, std::size_t size)
+    : m_begin(static_cast<const uint8_t*>(data)),
+      m_cur(static_cast<const uint8_t*>(data)),
+      m_end(static_cast<const uint8_t*>(data) + size) {}
+
+  msgpack_deserializer(const std::string& s)
+    : msgpack_deserializer(s.data(), s.size()) {}
+
+  ~msgpack_deserializer() = default;
+
+  /** 現在位置から１つのメッセージを読み出す */
+  json execute() {
+    json j;
+    deserialize(j);
+    return j;
+  }
+
+  void execute(json& j) {
+    deserialize(j);
+  }
+
+  /** 読み出し済みのバイト数 */
+  std::size_t consumed() const { return m_cur - m_begin; }
+
+  /** 全て読み出したか */
+  bool eof() const { return m_cur >= m_end; }
+};
+
+} /** namespace cppjson */
+#endif /* !defined(__cppjson_h_msgpack__) */
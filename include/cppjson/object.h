@@ -6,41 +6,47 @@
 
 namespace cppjson {
 
-class object : public json {
+template <typename Traits>
+class basic_object : public basic_json<Traits> {
 public:
-  object(std::initializer_list<json::object_type::value_type>&& list) {
-    set(object_type(list));
+  using json_type = basic_json<Traits>;
+  using typename json_type::object_type;
+
+  basic_object(std::initializer_list<typename object_type::value_type>&& list) {
+    this->set(object_type(list));
   }
 
   struct util {
-    template<typename ITER> static json to_json(ITER begin, ITER end) {
-      return create([&](json::object_type& obj){
+    template<typename ITER> static json_type to_json(ITER begin, ITER end) {
+      return create([&](object_type& obj){
         obj.insert(begin, end);
       });
     }
 
-    template<typename T> static json to_json(const T& src){
+    template<typename T> static json_type to_json(const T& src){
       return to_json(std::cbegin(src), std::cend(src));
     }
 
-    static json create(std::function<void(json::object_type&)> f) {
-      json j = create();
-      f(j.get<json::object_type>());
+    static json_type create(std::function<void(object_type&)> f) {
+      json_type j = create();
+      f(j.template get<object_type>());
       return j;
     }
 
-    static json create() {
-      return json::object_type();
+    static json_type create() {
+      return object_type();
     }
 
-    static json& edit(json& j, std::function<void(json::object_type&)> f){
-      auto& obj = j.get<json::object_type>();
+    static json_type& edit(json_type& j, std::function<void(object_type&)> f){
+      auto& obj = j.template get<object_type>();
       f(obj);
       return j;
     }
   };
 };
 
+using object = basic_object<json_traits>;
+
 } /** namespace cppjson */
 
 #endif /** !defined(__cppjson_h_object__) */
\ No newline at end of file
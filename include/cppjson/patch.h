@@ -0,0 +1,491 @@
+#if !defined(__cppjson_h_patch__)
+#define __cppjson_h_patch__
+
+#include "json.h"
+#include "array.h"
+#include <algorithm>
+#include <functional>
+#include <unordered_map>
+#include <cstring>
+
+namespace cppjson {
+
+/**
+ * JSON Patch（RFC 6902）の生成と適用。
+ * json patch = json_patch::diff(a, b);  // a を b にする patch を生成する
+ * json_patch::apply(a, patch);          // a を直接変更する（a は b と等しくなる）
+ *
+ * diff は同一の部分木をハッシュ値で読み飛ばし、array は LCS で対応する要素を求める。
+ * 部分木のハッシュ値は diff の間のみ保持し、a と b のキャッシュには書き込まない。
+ * 数値は integral / floating_point を区別せず値で比較する。object のキーの順序は区別しない。
+ * apply は変更の無い部分を複製せずに適用する。途中の操作が失敗した場合は、
+ * それまでの操作を取り消して（doc を元に戻して）から bad_patch を送出する。
+ **/
+class json_patch {
+private:
+  using tokens = std::vector<std::string>;
+
+  /** 取り消し用の記録（操作の逆） */
+  struct undo_entry {
+    enum class kind { add, remove, replace, move };
+    kind    op;
+    tokens  path;
+    json    value;      /** add, replace : 戻す値、move : path で置き換えられた値 */
+    tokens  from;       /** move : 移動元 */
+    bool    replaced;   /** move : path の値を置き換えたか */
+  };
+  using undo_log = std::vector<undo_entry>;
+
+  /** array の LCS を計算する上限（要素数の積）。超える場合は先頭から順に比較する */
+  static constexpr std::size_t lcs_limit = 4 * 1024 * 1024;
+
+  [[noreturn]] static void throw_bad_patch(std::size_t index, const std::string& err) {
+    std::stringstream ss;
+    ss << "operation(" << index << ") : " << err;
+    throw bad_patch(ss.str());
+  }
+
+  /************** JSON Pointer ***************/
+  static std::string escape(const std::string& token) {
+    std::string s;
+    for(const auto c : token){
+      if(c == '~')      s += "~0";
+      else if(c == '/') s += "~1";
+      else              s += c;
+    }
+    return s;
+  }
+
+  static std::string to_pointer(const tokens& path) {
+    std::string s;
+    for(const auto& t : path){
+      s += '/';
+      s += escape(t);
+    }
+    return s;
+  }
+
+  static tokens parse_pointer(std::size_t index, const std::string& pointer) {
+    tokens path;
+    if(pointer.empty()) return path;
+    if(pointer[0] != '/') throw_bad_patch(index, "invalid pointer : " + pointer);
+    std::string token;
+    for(std::size_t i = 1; i <= pointer.size(); i++){
+      if(i == pointer.size() || pointer[i] == '/'){
+        path.push_back(std::move(token));
+        token.clear();
+      }
+      else if(pointer[i] == '~'){
+        if(i + 1 >= pointer.size() || (pointer[i + 1] != '0' && pointer[i + 1] != '1')){
+          throw_bad_patch(index, "invalid pointer : " + pointer);
+        }
+        token += (pointer[i + 1] == '0') ? '~' : '/';
+        i++;
+      }
+      else{
+        token += pointer[i];
+      }
+    }
+    return path;
+  }
+
+  /** array の添字（先頭の 0 や符号は許容しない）。"-" は末尾 */
+  static std::size_t to_index(std::size_t index, const std::string& token, std::size_t size, bool allow_end) {
+    if(allow_end && token == "-") return size;
+    if(token.empty() || (token.size() > 1 && token[0] == '0') ||
+       !std::all_of(token.begin(), token.end(), [](char c){ return c >= '0' && c <= '9'; })){
+      throw_bad_patch(index, "invalid array index : " + token);
+    }
+    const auto i = static_cast<std::size_t>(std::strtoull(token.c_str(), nullptr, 10));
+    if(i > size || (i == size && !allow_end)){
+      throw_bad_patch(index, "array index out of range : " + token);
+    }
+    return i;
+  }
+
+  /** path が指す値（存在しない場合は nullptr） */
+  static json* find(json& doc, const tokens& path, std::size_t count) {
+    json* cur = &doc;
+    for(std::size_t i = 0; i < count; i++){
+      const auto& t = path[i];
+      if(cur->value_type_id() == json::value_type_id::object){
+        auto& obj = cur->get<json::object_type>();
+        auto it = obj.find(t);
+        if(it == obj.end()) return nullptr;
+        cur = &it->second;
+      }
+      else if(cur->value_type_id() == json::value_type_id::array){
+        auto& arr = cur->get<json::array_type>();
+        if(t.empty() || (t.size() > 1 && t[0] == '0') ||
+           !std::all_of(t.begin(), t.end(), [](char c){ return c >= '0' && c <= '9'; })){
+          return nullptr;
+        }
+        const auto index = static_cast<std::size_t>(std::strtoull(t.c_str(), nullptr, 10));
+        if(index >= arr.size()) return nullptr;
+        cur = &arr[index];
+      }
+      else{
+        return nullptr;
+      }
+    }
+    return cur;
+  }
+
+  static json& find_parent(std::size_t index, json& doc, const tokens& path) {
+    auto parent = find(doc, path, path.size() - 1);
+    if(!parent) throw_bad_patch(index, "path not found : " + to_pointer(path));
+    return *parent;
+  }
+
+  /************** 操作 ***************/
+  /**
+   * path に value を追加する。既存の値を置き換えた場合は old に移して true を返却する。
+   * array の "-" は実際の添字に書き換える（取り消し用）。失敗した場合 value は変更しない。
+   **/
+  static bool add(std::size_t index, json& doc, tokens& path, json&& value, json& old) {
+    if(path.empty()){
+      old = std::move(doc);
+      doc = std::move(value);
+      return true;
+    }
+    auto& parent = find_parent(index, doc, path);
+    const auto& last = path.back();
+    if(parent.value_type_id() == json::value_type_id::object){
+      auto& obj = parent.get<json::object_type>();
+      auto it = obj.find(last);
+      if(it != obj.end()){
+        old = std::move(it->second);
+        it->second = std::move(value);
+        return true;
+      }
+      obj.insert({last, std::move(value)});
+      return false;
+    }
+    else if(parent.value_type_id() == json::value_type_id::array){
+      auto& arr = parent.get<json::array_type>();
+      const auto i = to_index(index, last, arr.size(), true);
+      arr.insert(arr.begin() + i, std::move(value));
+      path.back() = std::to_string(i);
+      return false;
+    }
+    throw_bad_patch(index, "parent is not a container : " + to_pointer(path));
+  }
+
+  static json remove(std::size_t index, json& doc, const tokens& path) {
+    if(path.empty()){
+      throw_bad_patch(index, "cannot remove the root");
+    }
+    auto& parent = find_parent(index, doc, path);
+    const auto& last = path.back();
+    json removed;
+    if(parent.value_type_id() == json::value_type_id::object){
+      auto& obj = parent.get<json::object_type>();
+      auto it = obj.find(last);
+      if(it == obj.end()) throw_bad_patch(index, "path not found : " + to_pointer(path));
+      removed = std::move(it->second);
+      obj.erase(it);
+    }
+    else if(parent.value_type_id() == json::value_type_id::array){
+      auto& arr = parent.get<json::array_type>();
+      const auto i = to_index(index, last, arr.size(), false);
+      removed = std::move(arr[i]);
+      arr.erase(arr.begin() + i);
+    }
+    else{
+      throw_bad_patch(index, "path not found : " + to_pointer(path));
+    }
+    return removed;
+  }
+
+  /** path の値を value に置き換え、元の値を返却する */
+  static json replace(std::size_t index, json& doc, const tokens& path, json value) {
+    auto target = find(doc, path, path.size());
+    if(!target) throw_bad_patch(index, "path not found : " + to_pointer(path));
+    json old = std::move(*target);
+    *target = std::move(value);
+    return old;
+  }
+
+  /** 値を追加し、取り消し用の記録を残す */
+  static void add_with_undo(std::size_t index, json& doc, tokens path, json value, undo_log& undo) {
+    json old;
+    if(add(index, doc, path, std::move(value), old)){
+      undo.push_back({undo_entry::kind::replace, std::move(path), std::move(old), {}, false});
+    }
+    else{
+      undo.push_back({undo_entry::kind::remove, std::move(path), json(), {}, false});
+    }
+  }
+
+  static void rollback(json& doc, undo_log& undo) {
+    json unused;
+    for(auto it = undo.rbegin(); it != undo.rend(); ++it){
+      switch(it->op){
+        case undo_entry::kind::add:     { add(0, doc, it->path, std::move(it->value), unused); break; }
+        case undo_entry::kind::remove:  { remove(0, doc, it->path); break; }
+        case undo_entry::kind::replace: { replace(0, doc, it->path, std::move(it->value)); break; }
+        case undo_entry::kind::move: {
+          auto moved = it->replaced ? replace(0, doc, it->path, std::move(it->value)) : remove(0, doc, it->path);
+          add(0, doc, it->from, std::move(moved), unused);
+          break;
+        }
+      }
+    }
+  }
+
+  static const json& member(std::size_t index, const json& op, const char* name) {
+    const auto& v = op[name];
+    if(v.is_undefined()) throw_bad_patch(index, std::string("missing member : ") + name);
+    return v;
+  }
+
+  static const std::string& pointer_member(std::size_t index, const json& op, const char* name) {
+    const auto& v = member(index, op, name);
+    if(v.value_type_id() != json::value_type_id::string) throw_bad_patch(index, std::string(name) + " must be a string");
+    return v.get<std::string>();
+  }
+
+  static void apply_operation(std::size_t index, json& doc, const json& op, undo_log& undo) {
+    if(op.value_type_id() != json::value_type_id::object) throw_bad_patch(index, "operation must be an object");
+    const auto& name = pointer_member(index, op, "op");
+    auto path = parse_pointer(index, pointer_member(index, op, "path"));
+    if(name == "add"){
+      add_with_undo(index, doc, std::move(path), member(index, op, "value").clone(), undo);
+    }
+    else if(name == "remove"){
+      auto removed = remove(index, doc, path);
+      undo.push_back({undo_entry::kind::add, std::move(path), std::move(removed), {}, false});
+    }
+    else if(name == "replace"){
+      auto old = replace(index, doc, path, member(index, op, "value").clone());
+      undo.push_back({undo_entry::kind::replace, std::move(path), std::move(old), {}, false});
+    }
+    else if(name == "move"){
+      const auto from = parse_pointer(index, pointer_member(index, op, "from"));
+      if(from == path) return;
+      if(from.size() < path.size() && std::equal(from.begin(), from.end(), path.begin())){
+        throw_bad_patch(index, "cannot move a value into its child");
+      }
+      /** 移動する値は複製しない */
+      auto moved = remove(index, doc, from);
+      json old;
+      bool replaced;
+      try{
+        replaced = add(index, doc, path, std::move(moved), old);
+      }
+      catch(...){
+        json unused;
+        auto restore = from;
+        add(index, doc, restore, std::move(moved), unused);
+        throw;
+      }
+      undo.push_back({undo_entry::kind::move, std::move(path), std::move(old), from, replaced});
+    }
+    else if(name == "copy"){
+      const auto from = parse_pointer(index, pointer_member(index, op, "from"));
+      const auto source = find(doc, from, from.size());
+      if(!source) throw_bad_patch(index, "path not found : " + to_pointer(from));
+      add_with_undo(index, doc, std::move(path), source->clone(), undo);
+    }
+    else if(name == "test"){
+      const auto target = find(doc, path, path.size());
+      if(!target || *target != member(index, op, "value")){
+        throw_bad_patch(index, "test failed : " + to_pointer(path));
+      }
+    }
+    else{
+      throw_bad_patch(index, "unknown op : " + name);
+    }
+  }
+
+  /************** 差分 ***************/
+  static json operation(const char* op, const tokens& path) {
+    return {{"op", op}, {"path", to_pointer(path)}};
+  }
+
+  static json operation(const char* op, const tokens& path, const json& value) {
+    return {{"op", op}, {"path", to_pointer(path)}, {"value", value}};
+  }
+
+  /**
+   * diff の間のみ保持する部分木の構造のハッシュ値（operator == と矛盾しない）。
+   * a と b のハッシュ値のキャッシュには書き込まない（取得済みの参照を介した変更でキャッシュが古くなるため）。
+   **/
+  class subtree_hashes {
+  private:
+    std::unordered_map<const json*, std::size_t> m_hashes; /** array / object のみ */
+
+    static std::size_t mix(std::size_t h, std::size_t v) {
+      return h ^ (v + 0x9e3779b97f4a7c15ull + (h << 6) + (h >> 2));
+    }
+
+  public:
+    std::size_t operator ()(const json& j) {
+      const auto type = j.value_type_id();
+      if(type != json::value_type_id::array && type != json::value_type_id::object) return j.hash();
+      const auto it = m_hashes.find(&j);
+      if(it != m_hashes.end()) return it->second;
+      std::size_t h = static_cast<std::size_t>(type);
+      if(type == json::value_type_id::array){
+        for(const auto& v : j.get<json::array_type>()) h = mix(h, (*this)(v));
+      }
+      else{
+        /** キーの順序に依存しないよう、各要素のハッシュ値を加算する */
+        std::size_t sum = 0;
+        for(const auto& kv : j.get<json::object_type>()) sum += mix(std::hash<std::string>()(kv.first), (*this)(kv.second));
+        h = mix(h, sum);
+      }
+      m_hashes.emplace(&j, h);
+      return h;
+    }
+  };
+
+  /** ハッシュ値が異なれば比較しない（等しい場合のみ衝突を除くため比較する） */
+  static bool same(const json& a, const json& b, subtree_hashes& hashes) {
+    return hashes(a) == hashes(b) && a == b;
+  }
+
+  static void diff_value(const json& a, const json& b, tokens& path, json::array_type& out, subtree_hashes& hashes) {
+    /** 等しい部分木は辿らない */
+    if(same(a, b, hashes)) return;
+    if(a.value_type_id() == b.value_type_id()){
+      if(a.value_type_id() == json::value_type_id::object){
+        diff_object(a.get<json::object_type>(), b.get<json::object_type>(), path, out, hashes);
+        return;
+      }
+      if(a.value_type_id() == json::value_type_id::array){
+        diff_array(a.get<json::array_type>(), b.get<json::array_type>(), path, out, hashes);
+        return;
+      }
+    }
+    out.push_back(operation("replace", path, b));
+  }
+
+  static void diff_object(const json::object_type& a, const json::object_type& b, tokens& path, json::array_type& out, subtree_hashes& hashes) {
+    if(&a == &b) return;
+    /** 出力を一定にするためキーの順に処理する */
+    std::vector<const std::string*> keys;
+    for(const auto& kv : a) keys.push_back(&kv.first);
+    for(const auto& kv : b) if(!a.count(kv.first)) keys.push_back(&kv.first);
+    std::sort(keys.begin(), keys.end(), [](const std::string* x, const std::string* y){ return *x < *y; });
+
+    for(const auto key : keys){
+      auto ia = a.find(*key);
+      auto ib = b.find(*key);
+      path.push_back(*key);
+      if(ib == b.end()){
+        out.push_back(operation("remove", path));
+      }
+      else if(ia == a.end()){
+        out.push_back(operation("add", path, ib->second));
+      }
+      else{
+        diff_value(ia->second, ib->second, path, out, hashes);
+      }
+      path.pop_back();
+    }
+  }
+
+  static void diff_array(const json::array_type& a, const json::array_type& b, tokens& path, json::array_type& out, subtree_hashes& hashes) {
+    if(&a == &b) return;
+
+    /** 先頭・末尾の一致する要素を除く */
+    std::size_t head = 0;
+    while(head < a.size() && head < b.size() && same(a[head], b[head], hashes)) head++;
+    std::size_t tail = 0;
+    while(tail < a.size() - head && tail < b.size() - head && same(a[a.size() - 1 - tail], b[b.size() - 1 - tail], hashes)) tail++;
+    const auto n = a.size() - head - tail;
+    const auto m = b.size() - head - tail;
+
+    /** 対応する要素の組（a の添字, b の添字）。末尾に番兵を置く */
+    std::vector<std::pair<std::size_t, std::size_t>> matches;
+    if(n > 0 && m > 0 && n * m <= lcs_limit){
+      std::vector<std::size_t> ha(n), hb(m);
+      for(std::size_t i = 0; i < n; i++) ha[i] = hashes(a[head + i]);
+      for(std::size_t j = 0; j < m; j++) hb[j] = hashes(b[head + j]);
+      /** lcs[i][j] = a[i..] と b[j..] の LCS の長さ */
+      std::vector<uint32_t> lcs((n + 1) * (m + 1), 0);
+      auto at = [&](std::size_t i, std::size_t j) -> uint32_t& { return lcs[i * (m + 1) + j]; };
+      for(std::size_t i = n; i-- > 0;){
+        for(std::size_t j = m; j-- > 0;){
+          if(ha[i] == hb[j] && a[head + i] == b[head + j]){
+            at(i, j) = at(i + 1, j + 1) + 1;
+          }
+          else{
+            at(i, j) = std::max(at(i + 1, j), at(i, j + 1));
+          }
+        }
+      }
+      for(std::size_t i = 0, j = 0; i < n && j < m;){
+        if(ha[i] == hb[j] && at(i, j) == at(i + 1, j + 1) + 1 && a[head + i] == b[head + j]){
+          matches.push_back({i, j});
+          i++;
+          j++;
+        }
+        else if(at(i + 1, j) >= at(i, j + 1)){
+          i++;
+        }
+        else{
+          j++;
+        }
+      }
+    }
+    matches.push_back({n, m});
+
+    /** 対応しない区間毎に、同じ位置の要素は再帰的に比較し、残りを削除・追加する */
+    std::size_t ia = 0, ib = 0;
+    for(const auto& match : matches){
+      const auto removes = match.first - ia;
+      const auto adds = match.second - ib;
+      const auto pairs = std::min(removes, adds);
+      for(std::size_t k = 0; k < pairs; k++){
+        path.push_back(std::to_string(head + ib + k));
+        diff_value(a[head + ia + k], b[head + ib + k], path, out, hashes);
+        path.pop_back();
+      }
+      for(std::size_t k = pairs; k < removes; k++){
+        path.push_back(std::to_string(head + ib + pairs));
+        out.push_back(operation("remove", path));
+        path.pop_back();
+      }
+      for(std::size_t k = pairs; k < adds; k++){
+        path.push_back(std::to_string(head + ib + k));
+        out.push_back(operation("add", path, b[head + ib + k]));
+        path.pop_back();
+      }
+      ia = match.first + 1;
+      ib = match.second + 1;
+    }
+  }
+
+public:
+  /** a を b にする patch（操作の array）を生成する */
+  static json diff(const json& a, const json& b) {
+    json::array_type out;
+    tokens path;
+    subtree_hashes hashes;
+    diff_value(a, b, path, out, hashes);
+    return out;
+  }
+
+  /** patch を doc に適用する。失敗した場合は doc を元に戻して bad_patch を送出する。 */
+  static void apply(json& doc, const json& patch) {
+    if(patch.value_type_id() != json::value_type_id::array){
+      throw bad_patch("patch must be an array");
+    }
+    undo_log undo;
+    const auto& ops = patch.get<json::array_type>();
+    for(std::size_t i = 0; i < ops.size(); i++){
+      try{
+        apply_operation(i, doc, ops[i], undo);
+      }
+      catch(...){
+        rollback(doc, undo);
+        throw;
+      }
+    }
+  }
+};
+
+} /** namespace cppjson */
+#endif /* !defined(__cppjson_h_patch__) */
@@ -6,76 +6,83 @@
 
 namespace cppjson {
 
+/** 各関数は json 以外の basic_json（basic_json<my_traits> 等）にも使用できる */
 class path_util
 {
-public:
-
-  /** path に従って object を生成して、最後に値を設定する。 */
-  static json create(const std::string& path, const json& value = json(), const char separator = '.') {
+private:
+  /** J は basic_json<Traits> または const basic_json<Traits> */
+  template <typename J>
+  static J* find_value(J& j, const std::string& path, const char separator) {
+    using json_type = std::remove_const_t<J>;
+    if(j.value_type_id() != json_type::value_type_id::object) return nullptr;
+    auto&& obj = j.template get<typename json_type::object_type>();
     const auto pos = path.find(separator);
     if(pos == std::string::npos){
-      return {{path, value}};
+      auto it = obj.find(json_type::to_string_type(path));
+      return it != obj.end() ? &it->second : nullptr;
     }
     else{
       const auto left = path.substr(0, pos);
       const auto right = path.substr(pos + 1);
-      return {{left, create(right, value, separator)}};
+      auto it = obj.find(json_type::to_string_type(left));
+      return it != obj.end() ? find_value(it->second, right, separator) : nullptr;
     }
   }
 
-  /** path に従って値を取得する。存在しない場合は nullptr を返却する。 */
-  static const json* find(const json& j, const std::string& path, const char separator = '.') {
-    if(j.value_type_id() != json::value_type_id::object) return nullptr;
-    auto&& obj = j.get<json::object_type>();
+public:
+
+  /** path に従って object を生成して、最後に値を設定する。 */
+  static json create(const std::string& path, const json& value = json(), const char separator = '.') {
+    return create<json_traits>(path, value, separator);
+  }
+
+  template <typename Traits>
+  static basic_json<Traits> create(const std::string& path, const basic_json<Traits>& value, const char separator = '.') {
+    using json_type = basic_json<Traits>;
     const auto pos = path.find(separator);
     if(pos == std::string::npos){
-      auto it = obj.find(path);
-      return it != obj.end() ? &it->second : nullptr;
+      return {{json_type::to_string_type(path), value}};
     }
     else{
       const auto left = path.substr(0, pos);
       const auto right = path.substr(pos + 1);
-      auto it = obj.find(left);
-      return it != obj.end() ? find(it->second, right, separator) : nullptr;
+      return {{json_type::to_string_type(left), create(right, value, separator)}};
     }
   }
 
   /** path に従って値を取得する。存在しない場合は nullptr を返却する。 */
-  static json* find(json& j, const std::string& path, const char separator = '.') {
-    if(j.value_type_id() != json::value_type_id::object) return nullptr;
-    auto&& obj = j.get<json::object_type>();
-    const auto pos = path.find(separator);
-    if(pos == std::string::npos){
-      auto it = obj.find(path);
-      return it != obj.end() ? &it->second : nullptr;
-    }
-    else{
-      const auto left = path.substr(0, pos);
-      const auto right = path.substr(pos + 1);
-      auto it = obj.find(left);
-      return it != obj.end() ? find(it->second, right, separator) : nullptr;
-    }
+  template <typename Traits>
+  static const basic_json<Traits>* find(const basic_json<Traits>& j, const std::string& path, const char separator = '.') {
+    return find_value(j, path, separator);
+  }
+
+  /** path に従って値を取得する。存在しない場合は nullptr を返却する。 */
+  template <typename Traits>
+  static basic_json<Traits>* find(basic_json<Traits>& j, const std::string& path, const char separator = '.') {
+    return find_value(j, path, separator);
   }
 
   /** path に従って値を取得する。存在しない or 非object の場合は作成を行う。object の場合には値を追加する。 */
-  static void put(json& j, const std::string& path, const json& value, const char separator = '.') {
-    if(j.value_type_id() != json::value_type_id::object){
-      j.set(json::object_type());
+  template <typename Traits>
+  static void put(basic_json<Traits>& j, const std::string& path, const std::common_type_t<basic_json<Traits>>& value, const char separator = '.') {
+    using json_type = basic_json<Traits>;
+    if(j.value_type_id() != json_type::value_type_id::object){
+      j.set(typename json_type::object_type());
     }
-    auto&& obj = j.get<json::object_type>();
+    auto&& obj = j.template get<typename json_type::object_type>();
     const auto pos = path.find(separator);
     if(pos == std::string::npos){
-      obj[path] = value;
+      obj[json_type::to_string_type(path)] = value;
     }
     else{
       const auto left = path.substr(0, pos);
       const auto right = path.substr(pos + 1);
-      auto it = obj.find(left);
+      auto it = obj.find(json_type::to_string_type(left));
       if(it != obj.end()){
         put(it->second, right, value, separator);
       }
       else{
-        obj[left] = create(right, value, separator);
+        obj[json_type::to_string_type(left)] = create(right, value, separator);
       }
     }
   }
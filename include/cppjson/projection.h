@@ -0,0 +1,106 @@
+#if !defined(__cppjson_h_projection__)
+#define __cppjson_h_projection__
+
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include <initializer_list>
+
+namespace cppjson {
+
+/**
+ * デシリアライズで生成する部分（パスの集合）。deserializer::project() に渡すと、指定したパスの値とその祖先のみを生成し、
+ * それ以外は値を生成せずに読み飛ばす。
+ * projection p({"user.id", "items[*].price", "meta.ts"});
+ * json j = deserializer(ss).project(p).execute();
+ *
+ * パスは path_util と同じ区切り文字で区切り、各要素の末尾の "[*]" は array の全ての要素を表す（"[*]" のみの場合はその位置の array）。
+ * 指定したパスの値は部分木ごと生成する（"user" と "user.id" を指定した場合は "user" の全体を生成する）。
+ * パスの途中の値の型が異なる場合（object を期待したが数値であった等）、object のメンバーであれば省略し、array の要素であれば null とする。
+ **/
+class projection {
+friend class deserializer;
+private:
+  static constexpr int none = -1;
+
+  struct node {
+    bool                                          whole = false;      /** 部分木ごと生成する */
+    std::unordered_map<std::string, std::size_t>  members;            /** キー毎の子（m_nodes のインデックス） */
+    int                                           elements = none;    /** [*] の子 */
+  };
+
+  std::vector<node> m_nodes;
+
+  std::size_t member(std::size_t n, const std::string& key) {
+    auto it = m_nodes[n].members.find(key);
+    if(it != m_nodes[n].members.end()) return it->second;
+    m_nodes.emplace_back();
+    m_nodes[n].members[key] = m_nodes.size() - 1;
+    return m_nodes.size() - 1;
+  }
+
+  std::size_t elements(std::size_t n) {
+    if(m_nodes[n].elements == none){
+      m_nodes.emplace_back();
+      m_nodes[n].elements = static_cast<int>(m_nodes.size() - 1);
+    }
+    return static_cast<std::size_t>(m_nodes[n].elements);
+  }
+
+  /** 区切り文字で区切った要素を n の子として追加し、その子のインデックスを返却する */
+  std::size_t add_segment(std::size_t n, std::string segment) {
+    static const std::string wildcard("[*]");
+    std::size_t wildcards = 0;
+    while(segment.size() >= wildcard.size() && segment.compare(segment.size() - wildcard.size(), wildcard.size(), wildcard) == 0){
+      segment.resize(segment.size() - wildcard.size());
+      wildcards++;
+    }
+    if(!segment.empty() || wildcards == 0){
+      n = member(n, segment);
+    }
+    for(std::size_t i = 0; i < wildcards; i++){
+      n = elements(n);
+    }
+    return n;
+  }
+
+  const node& root() const { return m_nodes.front(); }
+  const node& at(std::size_t n) const { return m_nodes[n]; }
+
+  /** key の子（生成しない場合は nullptr） */
+  const node* find_member(const node& n, const std::string& key) const {
+    auto it = n.members.find(key);
+    return it != n.members.end() ? &m_nodes[it->second] : nullptr;
+  }
+
+  const node* find_elements(const node& n) const {
+    return n.elements != none ? &m_nodes[n.elements] : nullptr;
+  }
+
+public:
+  projection(const std::vector<std::string>& paths, const char separator = '.') : m_nodes(1) {
+    for(const auto& path : paths){
+      add(path, separator);
+    }
+  }
+
+  projection(std::initializer_list<std::string> paths, const char separator = '.')
+    : projection(std::vector<std::string>(paths), separator) {}
+
+  /** path を追加する */
+  projection& add(const std::string& path, const char separator = '.') {
+    std::size_t n = 0;
+    std::size_t begin = 0;
+    for(;;){
+      const auto pos = path.find(separator, begin);
+      n = add_segment(n, path.substr(begin, pos == std::string::npos ? std::string::npos : pos - begin));
+      if(pos == std::string::npos) break;
+      begin = pos + 1;
+    }
+    m_nodes[n].whole = true;
+    return *this;
+  }
+};
+
+} /** namespace cppjson */
+#endif /* !defined(__cppjson_h_projection__) */
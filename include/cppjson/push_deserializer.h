@@ -0,0 +1,506 @@
+#if !defined(__cppjson_h_push_deserializer__)
+#define __cppjson_h_push_deserializer__
+
+#include "json.h"
+#include "utf8.h"
+#include <vector>
+#include <string>
+
+namespace cppjson {
+
+/**
+ * 分割して到着する入力（ソケットの受信チャンクなど）を逐次解析する deserializer。
+ * feed() で受け取った分だけ解析を進め、文字列・エスケープ・数値・コメントの途中で
+ * チャンクが途切れても状態を保持して次の feed() で続きから解析する。
+ * 全ての入力を渡し終えたら finish() で json を取り出す。
+ * 文法は deserializer と同一で、同じ入力は分割の仕方によらず deserializer と同じく受理・拒否する
+ * （array の要素の間のカンマの省略・重複と末尾のカンマ、object の末尾のカンマを受理し、最初の値の後の入力は読み飛ばす）。
+ * auto p = push_deserializer();
+ * p.feed(chunk1, size1);
+ * p.feed(chunk2, size2);
+ * json j = p.finish();
+ **/
+class push_deserializer {
+private:
+  /** 字句解析の状態 */
+  enum class lexer_mode {
+    none,               /** トークン間 */
+    string,             /** 文字列の中 */
+    string_escape,      /** \ の直後 */
+    string_unicode,     /** \u の後の HEX 文字 */
+    number,             /** 数値の中 */
+    literal,            /** true / false / null の中 */
+    comment_start,      /** / の直後 */
+    block_comment,      /** ブロックコメントの中 */
+    block_comment_end,  /** ブロックコメント中の * の直後 */
+    line_comment        /** ラインコメントの中 */
+  };
+
+  /** 構文解析で次に期待するもの */
+  enum class grammar_mode {
+    value,              /** 値 */
+    value_or_close,     /** 値 or ]（[ の直後） */
+    key_or_close,       /** キー or }（{ とカンマの直後） */
+    separator,          /** : */
+    comma_or_close,     /** object は , or }、array は , or ] or 値 */
+    end                 /** 値の終端（以降の入力は読み飛ばす） */
+  };
+
+  /** 構築中の array / object */
+  struct frame {
+    bool              is_object;
+    json::array_type  arr;
+    json::object_type obj;
+    std::string       key;
+
+    explicit frame(bool object) : is_object(object) {}
+  };
+
+  lexer_mode          m_lexer;
+  grammar_mode        m_grammar;
+  std::vector<frame>  m_frames;
+  json                m_root;
+
+  std::string         m_token;          /** 文字列・数値の途中経過 */
+  bool                m_token_is_key;
+  const char*         m_literal;        /** 解析中のリテラル（"true" など） */
+  std::size_t         m_literal_pos;
+  uint16_t            m_unicode;
+  int                 m_unicode_digits;
+  uint16_t            m_high_surrogate;   /** 対となる \uDC00-\uDFFF を待っている上位サロゲート（0 は無し） */
+  utf8_policy         m_utf8_policy;
+
+  int                 m_line;
+  int                 m_col;
+  bool                m_prev_cr;
+
+  [[noreturn]] void throwError(const std::string& err) {
+    std::stringstream ss;
+    ss << "line(" << (m_line + 1) << "), col(" << (m_col + 1) << ") : " << err;
+    throw bad_json(ss.str());
+  }
+
+  static bool is_blacket(char c) {
+    return c == '\"';
+  }
+
+  static bool is_number_parts(char c){
+    switch(c){
+      case '0': case '1': case '2': case '3': case '4':
+      case '5': case '6': case '7': case '8': case '9':
+      case '-': case '+': case 'e': case 'E': case '.':
+      {
+        return true;
+      }
+    }
+    return false;
+  }
+
+  static int hex_value(char c) {
+    if('0' <= c && c <= '9') return c - '0';
+    if('a' <= c && c <= 'f') return c - 'a' + 10;
+    if('A' <= c && c <= 'F') return c - 'A' + 10;
+    return -1;
+  }
+
+  /** 行・列の更新（\r\n は１つの改行として扱う） */
+  void advance(char c) {
+    if(c == '\n'){
+      if(!m_prev_cr){
+        m_line++;
+      }
+      m_col = 0;
+      m_prev_cr = false;
+    }
+    else if(c == '\r'){
+      m_line++;
+      m_col = 0;
+      m_prev_cr = true;
+    }
+    else{
+      m_col++;
+      m_prev_cr = false;
+    }
+  }
+
+  /** 完成した値を親（array / object）またはルートに格納する */
+  void complete_value(json&& v) {
+    if(m_frames.empty()){
+      m_root = std::move(v);
+      m_grammar = grammar_mode::end;
+      return;
+    }
+    auto& f = m_frames.back();
+    if(f.is_object){
+      f.obj.insert({std::move(f.key), std::move(v)});
+    }
+    else{
+      f.arr.push_back(std::move(v));
+    }
+    m_grammar = grammar_mode::comma_or_close;
+  }
+
+  void close_container() {
+    auto f = std::move(m_frames.back());
+    m_frames.pop_back();
+    if(f.is_object){
+      complete_value(json(std::move(f.obj)));
+    }
+    else{
+      complete_value(json(std::move(f.arr)));
+    }
+  }
+
+  /**
+   * 文字列を確定する。チャンクの境界で分割された UTF-8 の並びも検証できるよう、文字列の全体をまとめて検証する
+   * （エスケープから生成した部分は常に正しいため、生の部分と組み合わさって正しい並びになることはない）。
+   **/
+  void complete_string() {
+    flush_surrogate();
+    if(m_utf8_policy == utf8_policy::reject){
+      if(!utf8::valid(m_token)) throwError("invalid utf-8 sequence");
+    }
+    else{
+      utf8::sanitize(m_token);
+    }
+    if(m_token_is_key){
+      if(m_token.empty()){
+        throwError("object key is empty");
+      }
+      m_frames.back().key = std::move(m_token);
+      m_grammar = grammar_mode::separator;
+    }
+    else{
+      complete_value(json(std::move(m_token)));
+    }
+    m_token.clear();
+    m_lexer = lexer_mode::none;
+  }
+
+  void complete_number() {
+    bool bFloat = false;
+    for(auto c : m_token){
+      if(c == '.' || c == 'e' || c == 'E'){
+        bFloat = true;
+        break;
+      }
+    }
+    json v;
+    try{
+      if(bFloat){
+        v.set(std::stod(m_token));
+      }
+      else{
+        v.set(static_cast<int64_t>(std::stoll(m_token)));
+      }
+    }
+    catch(std::exception& e){
+      std::stringstream errss;
+      errss << "cannot convert to number : \"" << m_token << "\" (" << e.what() << ")" << std::endl;
+      throwError(errss.str());
+    }
+    m_token.clear();
+    m_lexer = lexer_mode::none;
+    complete_value(std::move(v));
+  }
+
+  void complete_literal() {
+    m_lexer = lexer_mode::none;
+    switch(m_literal[0]){
+      case 't': { complete_value(json(true));    break; }
+      case 'f': { complete_value(json(false));   break; }
+      default:  { complete_value(json(nullptr)); break; }
+    }
+  }
+
+  /** 対になっていないサロゲート */
+  void unpaired_surrogate() {
+    if(m_utf8_policy == utf8_policy::reject) throwError("unpaired surrogate");
+    utf8::append(m_token, utf8::replacement_character);
+  }
+
+  /** 上位サロゲートの直後に下位サロゲートが続かなかった */
+  void flush_surrogate() {
+    if(m_high_surrogate){
+      m_high_surrogate = 0;
+      unpaired_surrogate();
+    }
+  }
+
+  /** utf16 -> utf8 へ変換（サロゲートは直後の \uXXXX と対にする） */
+  void append_unicode(uint16_t unicode) {
+    if(m_high_surrogate && utf8::is_low_surrogate(unicode)){
+      utf8::append(m_token, utf8::combine(m_high_surrogate, unicode));
+      m_high_surrogate = 0;
+      return;
+    }
+    flush_surrogate();
+    if(utf8::is_high_surrogate(unicode)){
+      m_high_surrogate = unicode;
+    }
+    else if(utf8::is_low_surrogate(unicode)){
+      unpaired_surrogate();
+    }
+    else{
+      utf8::append(m_token, unicode);
+    }
+  }
+
+  /** トークン間の文字を処理する */
+  void process_token_start(char c) {
+    if(std::isspace(static_cast<unsigned char>(c))){
+      return;
+    }
+    if(c == '/'){
+      m_lexer = lexer_mode::comment_start;
+      return;
+    }
+
+    switch(m_grammar){
+      case grammar_mode::value_or_close:
+      case grammar_mode::value: {
+        if(c == ']' && m_grammar == grammar_mode::value_or_close){
+          close_container();
+        }
+        else if(c == '{'){
+          m_frames.emplace_back(true);
+          m_grammar = grammar_mode::key_or_close;
+        }
+        else if(c == '['){
+          m_frames.emplace_back(false);
+          m_grammar = grammar_mode::value_or_close;
+        }
+        else if(is_blacket(c)){
+          m_token_is_key = false;
+          m_lexer = lexer_mode::string;
+        }
+        else if(c == 't' || c == 'f' || c == 'n'){
+          m_literal = (c == 't') ? "true" : (c == 'f') ? "false" : "null";
+          m_literal_pos = 1;
+          m_lexer = lexer_mode::literal;
+        }
+        else if(is_number_parts(c)){
+          m_token += c;
+          m_lexer = lexer_mode::number;
+        }
+        else{
+          throwError("syntax error");
+        }
+        break;
+      }
+      case grammar_mode::key_or_close: {
+        if(c == '}'){
+          close_container();
+        }
+        else if(is_blacket(c)){
+          m_token_is_key = true;
+          m_lexer = lexer_mode::string;
+        }
+        else{
+          throwError("syntax error");
+        }
+        break;
+      }
+      case grammar_mode::separator: {
+        if(c != ':') throwError("syntax error");
+        m_grammar = grammar_mode::value;
+        break;
+      }
+      case grammar_mode::comma_or_close: {
+        if(m_frames.back().is_object){
+          if(c == ',')      { m_grammar = grammar_mode::key_or_close; }
+          else if(c == '}') { close_container(); }
+          else              { throwError("syntax error"); }
+        }
+        else{
+          /** deserializer と同じく、要素の間のカンマは省略・重複でき、末尾のカンマも受理する */
+          if(c == ',')      { /** 何もしない */ }
+          else if(c == ']') { close_container(); }
+          else{
+            m_grammar = grammar_mode::value;
+            process_token_start(c);
+          }
+        }
+        break;
+      }
+      case grammar_mode::end: {
+        break;
+      }
+    }
+  }
+
+  /** 1文字を処理する */
+  void process(char c) {
+    if(m_grammar == grammar_mode::end && m_lexer == lexer_mode::none){
+      return; /** deserializer と同じく、値の後の入力は読み出さない */
+    }
+    switch(m_lexer){
+      case lexer_mode::none: {
+        process_token_start(c);
+        break;
+      }
+      case lexer_mode::string: {
+        if(is_blacket(c)){
+          complete_string();
+        }
+        else if(c == '\\'){
+          m_lexer = lexer_mode::string_escape;
+        }
+        else if(c == '\r' || c == '\n' || c == '\b' || c == '\f' || c == '\t' ){
+          throwError("string literal cannot contain control codes.");
+        }
+        else{
+          flush_surrogate();
+          m_token += c;
+        }
+        break;
+      }
+      case lexer_mode::string_escape: {
+        m_lexer = lexer_mode::string;
+        if(c != 'u') flush_surrogate();
+        switch(c){
+          case '"':
+          case '\\':
+          case '/': { m_token += c;    break; }
+          case 'b': { m_token += '\b'; break; }
+          case 'f': { m_token += '\f'; break; }
+          case 'n': { m_token += '\n'; break; }
+          case 'r': { m_token += '\r'; break; }
+          case 't': { m_token += '\t'; break; }
+          case 'u': {
+            m_unicode = 0;
+            m_unicode_digits = 0;
+            m_lexer = lexer_mode::string_unicode;
+            break;
+          }
+          default: {
+            throwError("invalid escape character");
+          }
+        }
+        break;
+      }
+      case lexer_mode::string_unicode: {
+        const auto h = hex_value(c);
+        if(h < 0) throwError("invalid unicode character");
+        m_unicode = static_cast<uint16_t>((m_unicode << 4) | h);
+        if(++m_unicode_digits == 4){
+          append_unicode(m_unicode);
+          m_lexer = lexer_mode::string;
+        }
+        break;
+      }
+      case lexer_mode::number: {
+        if(is_number_parts(c)){
+          m_token += c;
+        }
+        else{
+          complete_number();
+          process(c); /** 数値の終端文字は次のトークンとして処理する */
+        }
+        break;
+      }
+      case lexer_mode::literal: {
+        if(m_literal[m_literal_pos] != c) throwError("syntax error");
+        if(m_literal[++m_literal_pos] == '\0'){
+          complete_literal();
+        }
+        break;
+      }
+      case lexer_mode::comment_start: {
+        if(c == '*')      { m_lexer = lexer_mode::block_comment; }
+        else if(c == '/') { m_lexer = lexer_mode::line_comment; }
+        else              { throwError("syntax error"); }
+        break;
+      }
+      case lexer_mode::block_comment: {
+        if(c == '*') m_lexer = lexer_mode::block_comment_end;
+        break;
+      }
+      case lexer_mode::block_comment_end: {
+        if(c == '/')      { m_lexer = lexer_mode::none; }
+        else if(c != '*') { m_lexer = lexer_mode::block_comment; }
+        break;
+      }
+      case lexer_mode::line_comment: {
+        if(c == '\r' || c == '\n') m_lexer = lexer_mode::none;
+        break;
+      }
+    }
+  }
+
+public:
+  push_deserializer() : m_utf8_policy(utf8_policy::reject) {
+    reset();
+  }
+
+  /**
+   * 文字列中の不正な UTF-8 の並びと対になっていないサロゲートの取り扱い（既定値は utf8_policy::reject）。
+   * reset() / finish() では変更しない。
+   **/
+  push_deserializer& on_invalid_utf8(utf8_policy policy) {
+    m_utf8_policy = policy;
+    return *this;
+  }
+
+  ~push_deserializer() = default;
+
+  /** 解析状態を初期化する（インスタンスの再利用） */
+  void reset() {
+    m_lexer = lexer_mode::none;
+    m_grammar = grammar_mode::value;
+    m_frames.clear();
+    m_root = json();
+    m_token.clear();
+    m_token_is_key = false;
+    m_literal = nullptr;
+    m_literal_pos = 0;
+    m_unicode = 0;
+    m_unicode_digits = 0;
+    m_high_surrogate = 0;
+    m_line = 0;
+    m_col = 0;
+    m_prev_cr = false;
+  }
+
+  /** 入力の一部を渡す。渡した分は全て解析され、途中状態は次回の feed() に引き継がれる。 */
+  void feed(const char* data, std::size_t size) {
+    for(std::size_t i = 0; i < size; i++){
+      const char c = data[i];
+      process(c);
+      advance(c);
+    }
+  }
+
+  void feed(const std::string& s) {
+    feed(s.data(), s.size());
+  }
+
+  /** ドキュメントの値が完結しているか（数値の終端は finish() まで確定しない） */
+  bool completed() const {
+    return m_grammar == grammar_mode::end;
+  }
+
+  /** 入力の終端を通知して、解析結果を返却する。インスタンスは初期状態に戻る。 */
+  json finish() {
+    json j;
+    finish(j);
+    return j;
+  }
+
+  void finish(json& j) {
+    if(m_lexer == lexer_mode::number){
+      complete_number();
+    }
+    else if(m_lexer == lexer_mode::line_comment){
+      m_lexer = lexer_mode::none;
+    }
+    if(m_lexer != lexer_mode::none || m_grammar != grammar_mode::end){
+      throwError("illegal eof");
+    }
+    j = std::move(m_root);
+    reset();
+  }
+};
+
+} /** namespace cppjson */
+#endif /* !defined(__cppjson_h_push_deserializer__) */
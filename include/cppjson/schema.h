@@ -0,0 +1,558 @@
+#if !defined(__cppjson_h_schema__)
+#define __cppjson_h_schema__
+
+#include "json.h"
+#include <regex>
+#include <cmath>
+#include <limits>
+
+namespace cppjson {
+
+/**
+ * JSON Schema を検証用の内部表現に変換（コンパイル）したもの。
+ * 既存の json を検証する（validate）ほか、deserializer に渡すことでデシリアライズ中に検証を行い、
+ * 型が異なる値・許可されていないキー・要素数の超過などを値の生成前に検出できる。
+ * auto s = schema::compile(schema_json);
+ * s.validate(j);                  // 既存の json を検証
+ * deserializer(ss, s).execute();  // デシリアライズしながら検証（違反した時点で schema_violation）
+ *
+ * 対応しているキーワード
+ * type, enum, const,
+ * minimum, maximum, exclusiveMinimum, exclusiveMaximum（数値と draft4 の bool 形式）, multipleOf,
+ * minLength, maxLength, pattern,
+ * items（スキーマと配列形式）, prefixItems, minItems, maxItems, uniqueItems,
+ * properties, patternProperties, additionalProperties, required, minProperties, maxProperties,
+ * allOf, anyOf, oneOf, not, $ref（同一ドキュメント内の JSON Pointer のみ）, true / false スキーマ
+ * その他のキーワードは無視する。
+ **/
+class schema {
+friend class deserializer;
+private:
+  static constexpr int none = -1;
+  static constexpr std::size_t unlimited = std::numeric_limits<std::size_t>::max();
+
+  enum type_bit : uint32_t {
+    type_null     = 1 << 0,
+    type_boolean  = 1 << 1,
+    type_object   = 1 << 2,
+    type_array    = 1 << 3,
+    type_number   = 1 << 4,
+    type_integer  = 1 << 5,
+    type_string   = 1 << 6
+  };
+
+  /** コンパイル済みのスキーマ（サブスキーマは m_nodes のインデックスで参照する） */
+  struct node {
+    bool              reject_all = false;   /** false スキーマ */
+    uint32_t          types = 0;            /** 0 は全ての型を許容 */
+
+    bool              has_enum = false;
+    json::array_type  enum_values;
+    bool              has_const = false;
+    json              const_value;
+
+    bool              has_minimum = false;
+    double            minimum = 0;
+    bool              has_exclusive_minimum = false;
+    double            exclusive_minimum = 0;
+    bool              has_maximum = false;
+    double            maximum = 0;
+    bool              has_exclusive_maximum = false;
+    double            exclusive_maximum = 0;
+    double            multiple_of = 0;
+
+    std::size_t       min_length = 0;
+    std::size_t       max_length = unlimited;
+    bool              has_pattern = false;
+    std::regex        pattern;
+
+    int               items = none;
+    std::vector<int>  prefix_items;
+    std::size_t       min_items = 0;
+    std::size_t       max_items = unlimited;
+    bool              unique_items = false;
+
+    std::unordered_map<std::string, int>  properties;
+    std::vector<std::pair<std::regex, int>> pattern_properties;
+    bool              additional_properties_false = false;
+    int               additional_properties = none;
+    std::vector<std::string> required;
+    std::size_t       min_properties = 0;
+    std::size_t       max_properties = unlimited;
+
+    std::vector<int>  all_of;
+    std::vector<int>  any_of;
+    std::vector<int>  one_of;
+    int               not_schema = none;
+    int               ref = none;
+  };
+
+  std::vector<node>                     m_nodes;
+
+  /** コンパイル中のみ使用 */
+  struct compiler {
+    const json&                           root;
+    std::vector<node>&                    nodes;
+    std::unordered_map<std::string, int>  refs;
+  };
+
+  [[noreturn]] static void throw_bad_schema(const std::string& s) {
+    throw bad_schema(s);
+  }
+
+  static std::size_t to_size(const json& j, const char* keyword) {
+    if(!j.acquirable<double>() || j.get<double>() < 0){
+      throw_bad_schema(std::string(keyword) + " must be a non-negative number");
+    }
+    return j.get<std::size_t>();
+  }
+
+  static double to_number(const json& j, const char* keyword) {
+    if(!j.acquirable<double>()){
+      throw_bad_schema(std::string(keyword) + " must be a number");
+    }
+    return j.get<double>();
+  }
+
+  static uint32_t type_from_name(const std::string& s) {
+    if(s == "null")     return type_null;
+    if(s == "boolean")  return type_boolean;
+    if(s == "object")   return type_object;
+    if(s == "array")    return type_array;
+    if(s == "number")   return type_number | type_integer;
+    if(s == "integer")  return type_integer;
+    if(s == "string")   return type_string;
+    throw_bad_schema("unknown type : " + s);
+  }
+
+  /** JSON Pointer（#/definitions/name など）で root から参照先を取得する */
+  static const json& resolve_pointer(const json& root, const std::string& ref) {
+    if(ref.empty() || ref[0] != '#'){
+      throw_bad_schema("unsupported $ref : " + ref);
+    }
+    const json* cur = &root;
+    std::size_t pos = 1;
+    while(pos < ref.size()){
+      if(ref[pos] != '/') throw_bad_schema("invalid $ref : " + ref);
+      const auto next = ref.find('/', pos + 1);
+      auto token = ref.substr(pos + 1, next == std::string::npos ? std::string::npos : next - pos - 1);
+      std::string unescaped;
+      for(std::size_t i = 0; i < token.size(); i++){
+        if(token[i] == '~' && i + 1 < token.size()){
+          unescaped += (token[i + 1] == '1') ? '/' : '~';
+          i++;
+        }
+        else{
+          unescaped += token[i];
+        }
+      }
+      if(cur->value_type_id() == json::value_type_id::array){
+        const auto& arr = cur->get<json::array_type>();
+        const auto index = static_cast<std::size_t>(std::strtoull(unescaped.c_str(), nullptr, 10));
+        if(index >= arr.size()) throw_bad_schema("unresolvable $ref : " + ref);
+        cur = &arr[index];
+      }
+      else{
+        const auto& v = (*cur)[unescaped];
+        if(v.is_undefined()) throw_bad_schema("unresolvable $ref : " + ref);
+        cur = &v;
+      }
+      pos = (next == std::string::npos) ? ref.size() : next;
+    }
+    return *cur;
+  }
+
+  static int compile_ref(compiler& c, const std::string& ref) {
+    auto it = c.refs.find(ref);
+    if(it != c.refs.end()) return it->second;
+    const auto& target = resolve_pointer(c.root, ref);
+    const int index = static_cast<int>(c.nodes.size());
+    c.nodes.emplace_back();
+    c.refs[ref] = index; /** 再帰参照に備えて先に登録する */
+    compile_into(c, target, index);
+    return index;
+  }
+
+  static int compile_node(compiler& c, const json& s) {
+    const int index = static_cast<int>(c.nodes.size());
+    c.nodes.emplace_back();
+    compile_into(c, s, index);
+    return index;
+  }
+
+  static std::vector<int> compile_list(compiler& c, const json& s, const char* keyword) {
+    if(s.value_type_id() != json::value_type_id::array || s.get<json::array_type>().empty()){
+      throw_bad_schema(std::string(keyword) + " must be a non-empty array");
+    }
+    std::vector<int> list;
+    for(const auto& sub : s.get<json::array_type>()){
+      list.push_back(compile_node(c, sub));
+    }
+    return list;
+  }
+
+  /** s をコンパイルして nodes[index] に格納する（nodes は再確保されるので参照を保持しない） */
+  static void compile_into(compiler& c, const json& s, int index) {
+    node n;
+    if(s.value_type_id() == json::value_type_id::boolean){
+      n.reject_all = !s.get<bool>();
+      c.nodes[index] = std::move(n);
+      return;
+    }
+    if(s.value_type_id() != json::value_type_id::object){
+      throw_bad_schema("schema must be an object or boolean");
+    }
+
+    for(const auto& kv : s.get<json::object_type>()){
+      const auto& key = kv.first;
+      const auto& v = kv.second;
+      if(key == "type"){
+        if(v.value_type_id() == json::value_type_id::string){
+          n.types |= type_from_name(v.get<std::string>());
+        }
+        else if(v.value_type_id() == json::value_type_id::array){
+          for(const auto& t : v.get<json::array_type>()){
+            if(!t.acquirable<std::string>()) throw_bad_schema("type must be a string");
+            n.types |= type_from_name(t.get<std::string>());
+          }
+        }
+        else{
+          throw_bad_schema("type must be a string or array");
+        }
+      }
+      else if(key == "enum"){
+        if(!v.acquirable<json::array_type>()) throw_bad_schema("enum must be an array");
+        n.has_enum = true;
+        n.enum_values = v.get<json::array_type>();
+      }
+      else if(key == "const"){
+        n.has_const = true;
+        n.const_value = v;
+      }
+      else if(key == "minimum"){
+        n.has_minimum = true;
+        n.minimum = to_number(v, "minimum");
+      }
+      else if(key == "maximum"){
+        n.has_maximum = true;
+        n.maximum = to_number(v, "maximum");
+      }
+      else if(key == "exclusiveMinimum"){
+        if(v.acquirable<bool>()){
+          if(v.get<bool>()){
+            const auto& m = s["minimum"];
+            if(m.acquirable<double>()){
+              n.has_exclusive_minimum = true;
+              n.exclusive_minimum = m.get<double>();
+            }
+          }
+        }
+        else{
+          n.has_exclusive_minimum = true;
+          n.exclusive_minimum = to_number(v, "exclusiveMinimum");
+        }
+      }
+      else if(key == "exclusiveMaximum"){
+        if(v.acquirable<bool>()){
+          if(v.get<bool>()){
+            const auto& m = s["maximum"];
+            if(m.acquirable<double>()){
+              n.has_exclusive_maximum = true;
+              n.exclusive_maximum = m.get<double>();
+            }
+          }
+        }
+        else{
+          n.has_exclusive_maximum = true;
+          n.exclusive_maximum = to_number(v, "exclusiveMaximum");
+        }
+      }
+      else if(key == "multipleOf"){
+        n.multiple_of = to_number(v, "multipleOf");
+        if(n.multiple_of <= 0) throw_bad_schema("multipleOf must be greater than 0");
+      }
+      else if(key == "minLength")     { n.min_length = to_size(v, "minLength"); }
+      else if(key == "maxLength")     { n.max_length = to_size(v, "maxLength"); }
+      else if(key == "pattern"){
+        if(!v.acquirable<std::string>()) throw_bad_schema("pattern must be a string");
+        n.has_pattern = true;
+        n.pattern = std::regex(v.get<std::string>(), std::regex::ECMAScript);
+      }
+      else if(key == "items"){
+        if(v.value_type_id() == json::value_type_id::array){
+          for(const auto& sub : v.get<json::array_type>()){
+            n.prefix_items.push_back(compile_node(c, sub));
+          }
+        }
+        else{
+          n.items = compile_node(c, v);
+        }
+      }
+      else if(key == "prefixItems"){
+        n.prefix_items = compile_list(c, v, "prefixItems");
+      }
+      else if(key == "minItems")      { n.min_items = to_size(v, "minItems"); }
+      else if(key == "maxItems")      { n.max_items = to_size(v, "maxItems"); }
+      else if(key == "uniqueItems"){
+        n.unique_items = v.acquirable<bool>() && v.get<bool>();
+      }
+      else if(key == "properties"){
+        if(!v.acquirable<json::object_type>()) throw_bad_schema("properties must be an object");
+        for(const auto& p : v.get<json::object_type>()){
+          n.properties[p.first] = compile_node(c, p.second);
+        }
+      }
+      else if(key == "patternProperties"){
+        if(!v.acquirable<json::object_type>()) throw_bad_schema("patternProperties must be an object");
+        for(const auto& p : v.get<json::object_type>()){
+          n.pattern_properties.emplace_back(std::regex(p.first, std::regex::ECMAScript), compile_node(c, p.second));
+        }
+      }
+      else if(key == "additionalProperties"){
+        if(v.acquirable<bool>()){
+          n.additional_properties_false = !v.get<bool>();
+        }
+        else{
+          n.additional_properties = compile_node(c, v);
+        }
+      }
+      else if(key == "required"){
+        if(!v.acquirable<json::array_type>()) throw_bad_schema("required must be an array");
+        for(const auto& r : v.get<json::array_type>()){
+          if(!r.acquirable<std::string>()) throw_bad_schema("required must be an array of string");
+          n.required.push_back(r.get<std::string>());
+        }
+      }
+      else if(key == "minProperties") { n.min_properties = to_size(v, "minProperties"); }
+      else if(key == "maxProperties") { n.max_properties = to_size(v, "maxProperties"); }
+      else if(key == "allOf")         { n.all_of = compile_list(c, v, "allOf"); }
+      else if(key == "anyOf")         { n.any_of = compile_list(c, v, "anyOf"); }
+      else if(key == "oneOf")         { n.one_of = compile_list(c, v, "oneOf"); }
+      else if(key == "not")           { n.not_schema = compile_node(c, v); }
+      else if(key == "$ref"){
+        if(!v.acquirable<std::string>()) throw_bad_schema("$ref must be a string");
+        n.ref = compile_ref(c, v.get<std::string>());
+      }
+      /** その他のキーワード（definitions, title など）は無視する */
+    }
+    c.nodes[index] = std::move(n);
+  }
+
+  static uint32_t type_of(const json& j) {
+    switch(j.value_type_id()){
+      case json::value_type_id::null:     { return type_null; }
+      case json::value_type_id::boolean:  { return type_boolean; }
+      case json::value_type_id::object:   { return type_object; }
+      case json::value_type_id::array:    { return type_array; }
+      case json::value_type_id::string:   { return type_string; }
+      case json::value_type_id::integral: { return type_integer; }
+      case json::value_type_id::floating_point: {
+        const auto d = j.get<double>();
+        return (std::isfinite(d) && std::floor(d) == d) ? type_integer : type_number;
+      }
+      case json::value_type_id::raw_number: { return type_of(j.resolve_number()); }
+      default: { return 0; }
+    }
+  }
+
+  /** utf8 の文字数 */
+  static std::size_t utf8_length(const std::string& s) {
+    std::size_t n = 0;
+    for(auto c : s){
+      if((static_cast<unsigned char>(c) & 0xC0) != 0x80) n++;
+    }
+    return n;
+  }
+
+  static bool fail(std::string* reason, const std::string& s) {
+    if(reason) *reason = s;
+    return false;
+  }
+
+  /** 子の検証に失敗した場合に位置を前置する */
+  static bool fail_at(std::string* reason, const std::string& location) {
+    if(reason) *reason = location + *reason;
+    return false;
+  }
+
+  /** 親に渡す前にオブジェクトの要素を追加できるか（additionalProperties: false） */
+  const node* property_node(const node& n, const std::string& key, bool& allowed) const {
+    allowed = true;
+    auto it = n.properties.find(key);
+    if(it != n.properties.end()) return &m_nodes[it->second];
+    if(!n.pattern_properties.empty()){
+      for(const auto& pp : n.pattern_properties){
+        if(std::regex_search(key, pp.first)) return nullptr; /** 複数のスキーマが適用される可能性がある */
+      }
+    }
+    if(n.additional_properties_false){
+      allowed = false;
+      return nullptr;
+    }
+    return n.additional_properties != none ? &m_nodes[n.additional_properties] : nullptr;
+  }
+
+  const node* item_node(const node& n, std::size_t index) const {
+    if(index < n.prefix_items.size()) return &m_nodes[n.prefix_items[index]];
+    return n.items != none ? &m_nodes[n.items] : nullptr;
+  }
+
+  /** デシリアライズ中、値の生成前に受け入れ可能か判定する */
+  static bool accepts(const node& n, uint32_t type) {
+    if(n.reject_all) return false;
+    return n.types == 0 || (n.types & type) != 0;
+  }
+
+  /**
+   * n で j を検証する。
+   * children が false の場合、properties / items による子の検証は（デシリアライズ中に実施済みとして）省略する。
+   **/
+  bool check(const node& n, const json& j, std::string* reason, bool children = true) const {
+    if(n.reject_all) return fail(reason, ": false schema");
+
+    const auto type = type_of(j);
+    if(n.types != 0 && (n.types & type) == 0){
+      return fail(reason, std::string(": type ") + json::value_type_string(j.value_type_id()) + " is not allowed");
+    }
+
+    if(n.has_enum){
+      bool found = false;
+      for(const auto& e : n.enum_values){
+        if(e == j){
+          found = true;
+          break;
+        }
+      }
+      if(!found) return fail(reason, ": value is not in enum");
+    }
+    if(n.has_const && n.const_value != j){
+      return fail(reason, ": value is not const");
+    }
+
+    if(type == type_integer || type == type_number){
+      const auto d = j.get<double>();
+      if(n.has_minimum && d < n.minimum)                     return fail(reason, ": less than minimum");
+      if(n.has_exclusive_minimum && d <= n.exclusive_minimum) return fail(reason, ": less than or equal to exclusiveMinimum");
+      if(n.has_maximum && d > n.maximum)                     return fail(reason, ": greater than maximum");
+      if(n.has_exclusive_maximum && d >= n.exclusive_maximum) return fail(reason, ": greater than or equal to exclusiveMaximum");
+      if(n.multiple_of > 0){
+        const auto q = d / n.multiple_of;
+        if(std::fabs(q - std::round(q)) > 1e-9) return fail(reason, ": not a multiple of multipleOf");
+      }
+    }
+    else if(type == type_string){
+      const auto& s = j.get<std::string>();
+      if(n.min_length > 0 || n.max_length != unlimited){
+        const auto len = utf8_length(s);
+        if(len < n.min_length) return fail(reason, ": shorter than minLength");
+        if(len > n.max_length) return fail(reason, ": longer than maxLength");
+      }
+      if(n.has_pattern && !std::regex_search(s, n.pattern)){
+        return fail(reason, ": does not match pattern");
+      }
+    }
+    else if(type == type_array){
+      const auto& arr = j.get<json::array_type>();
+      if(arr.size() < n.min_items) return fail(reason, ": fewer items than minItems");
+      if(arr.size() > n.max_items) return fail(reason, ": more items than maxItems");
+      if(n.unique_items){
+        for(std::size_t a = 0; a < arr.size(); a++){
+          for(std::size_t b = a + 1; b < arr.size(); b++){
+            if(arr[a] == arr[b]) return fail(reason, ": items are not unique");
+          }
+        }
+      }
+      if(children){
+        for(std::size_t i = 0; i < arr.size(); i++){
+          const auto sub = item_node(n, i);
+          if(sub && !check(*sub, arr[i], reason)){
+            return fail_at(reason, "/" + std::to_string(i));
+          }
+        }
+      }
+    }
+    else if(type == type_object){
+      const auto& obj = j.get<json::object_type>();
+      if(obj.size() < n.min_properties) return fail(reason, ": fewer properties than minProperties");
+      if(obj.size() > n.max_properties) return fail(reason, ": more properties than maxProperties");
+      for(const auto& r : n.required){
+        if(obj.find(r) == obj.end()) return fail(reason, ": required property \"" + r + "\" is missing");
+      }
+      if(children || !n.pattern_properties.empty()){
+        for(const auto& kv : obj){
+          bool matched = false;
+          auto it = n.properties.find(kv.first);
+          if(it != n.properties.end()){
+            matched = true;
+            if(!check(m_nodes[it->second], kv.second, reason)) return fail_at(reason, "/" + kv.first);
+          }
+          for(const auto& pp : n.pattern_properties){
+            if(std::regex_search(kv.first, pp.first)){
+              matched = true;
+              if(!check(m_nodes[pp.second], kv.second, reason)) return fail_at(reason, "/" + kv.first);
+            }
+          }
+          if(!matched){
+            if(n.additional_properties_false){
+              return fail(reason, "/" + kv.first + ": additional property is not allowed");
+            }
+            if(n.additional_properties != none && !check(m_nodes[n.additional_properties], kv.second, reason)){
+              return fail_at(reason, "/" + kv.first);
+            }
+          }
+        }
+      }
+    }
+
+    for(const auto i : n.all_of){
+      if(!check(m_nodes[i], j, reason)) return false;
+    }
+    if(!n.any_of.empty()){
+      bool any = false;
+      for(const auto i : n.any_of){
+        if(check(m_nodes[i], j, nullptr)){
+          any = true;
+          break;
+        }
+      }
+      if(!any) return fail(reason, ": no schema in anyOf matched");
+    }
+    if(!n.one_of.empty()){
+      std::size_t count = 0;
+      for(const auto i : n.one_of){
+        if(check(m_nodes[i], j, nullptr)) count++;
+      }
+      if(count != 1) return fail(reason, ": not exactly one schema in oneOf matched");
+    }
+    if(n.not_schema != none && check(m_nodes[n.not_schema], j, nullptr)){
+      return fail(reason, ": value matches not");
+    }
+    if(n.ref != none && !check(m_nodes[n.ref], j, reason)){
+      return false;
+    }
+    return true;
+  }
+
+  const node& root() const { return m_nodes.front(); }
+
+public:
+  /** スキーマ（json）をコンパイルする。不正なスキーマの場合は bad_schema を送出する。 */
+  static schema compile(const json& s) {
+    schema result;
+    compiler c{s, result.m_nodes, {}};
+    compile_node(c, s);
+    return result;
+  }
+
+  /** j を検証する。違反している場合は false を返却し、reason に違反箇所（JSON Pointer）と理由を設定する。 */
+  bool validate(const json& j, std::string* reason = nullptr) const {
+    if(!check(root(), j, reason)){
+      if(reason) *reason = "#" + *reason;
+      return false;
+    }
+    return true;
+  }
+};
+
+} /** namespace cppjson */
+#endif /* !defined(__cppjson_h_schema__) */
@@ -2,17 +2,42 @@
 #define __cppjson_h_serializer__
 
 #include "json.h"
+#include "binding.h"
 #include <ostream>
-#include <iomanip>
+#include <sstream>
+#include <locale>
+#include <functional>
+#include <map>
+#include <memory>
+#include <thread>
+#include <atomic>
+#include <future>
+#include <mutex>
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#if __cplusplus >= 201703L
+#include <optional>
+#endif
 
 namespace cppjson {
 class serializer {
 private:
-  const json& m_json;
+  struct parallel_plan;
+
   const std::string m_indent;
+  bool m_canonical;
+  /** 出力関数（json は basic_json の型毎、構造体は型毎の関数を保持する） */
+  std::function<void(const serializer&, std::ostream&)> m_writer;
+  /** 並列シリアライズの計画を立てる関数（basic_json のみ） */
+  std::function<void(const serializer&, parallel_plan&, std::size_t)> m_planner;
+
+  /** canonical の場合は空白を出力しない */
+  bool indented() const { return !m_canonical && m_indent.size() > 0; }
 
   void insertIndent(std::ostream& os, int level) const {
-    if(level > 0 && m_indent.size() > 0){
+    if(level > 0 && indented()){
       for(auto i = 0; i < level; i++){
         os << m_indent;
       }
@@ -20,10 +45,11 @@ private:
   }
 
   void insertNewLine(std::ostream& os) const {
-    if(m_indent.size() > 0) os << std::endl;
+    if(indented()) os << std::endl;
   }
 
- void escape(std::ostream& os, const std::string& src) const {
+ template <typename S>
+ void escape(std::ostream& os, const S& src) const {
     for(auto c : src){
       switch(c){
         case '"' : { os << "\\\"";  break; }
@@ -37,7 +63,39 @@ private:
         default:
         {
           if((0x00 <= c) && (c <= 0x1F)){
-            os << "\\u" << std::hex << std::setw(4) << std::setfill('0') << static_cast<int>(c);
+            /** os の書式（std::hex 等）を変更しない */
+            char buf[8];
+            std::snprintf(buf, sizeof(buf), "\\u%04x", static_cast<int>(c));
+            os << buf;
+          }
+          else{
+            os << c;
+          }
+          break;
+        }
+      }
+    }
+  }
+
+  /************** canonical（RFC 8785 JCS） ***************/
+  /** 制御文字・引用符・バックスラッシュのみエスケープする（\u は小文字の16進数） */
+  template <typename S>
+  static void escape_canonical(std::ostream& os, const S& src) {
+    for(auto c : src){
+      switch(c){
+        case '"' : { os << "\\\"";  break; }
+        case '\\': { os << "\\\\"; break; }
+        case '\b': { os << "\\b";  break; }
+        case '\f': { os << "\\f";  break; }
+        case '\n': { os << "\\n";  break; }
+        case '\r': { os << "\\r";  break; }
+        case '\t': { os << "\\t";  break; }
+        default:
+        {
+          if((0x00 <= c) && (c <= 0x1F)){
+            char buf[8];
+            std::snprintf(buf, sizeof(buf), "\\u%04x", static_cast<int>(c));
+            os << buf;
           }
           else{
             os << c;
@@ -48,34 +106,159 @@ private:
     }
   }
 
-  void proceed(std::ostream& os, const json& j, int level) const {
+  /** ECMAScript の Number.prototype.toString と同じ書式（元の値に戻る最短の桁数） */
+  static void write_canonical_number(std::ostream& os, double d) {
+    if(!std::isfinite(d)){
+      os << "null"; /** JSON.stringify と同様 */
+      return;
+    }
+    if(d == 0){
+      os << "0"; /** -0 も 0 とする */
+      return;
+    }
+    /** snprintf / strtod は C のロケール（LC_NUMERIC）の小数点に従うため、"C" ロケールのストリームで変換する */
+    std::ostringstream out;
+    std::istringstream in;
+    out.imbue(std::locale::classic());
+    in.imbue(std::locale::classic());
+    out << std::scientific;
+    std::string buf;
+    for(int precision = 1; precision <= 17; precision++){
+      out.str("");
+      out.precision(precision - 1);
+      out << d;
+      buf = out.str();
+      in.clear();
+      in.str(buf);
+      double r = 0;
+      if((in >> r) && r == d) break;
+    }
+    /** buf = [-]d.ddde[+-]xx を 仮数部の数字列 digits と 10 進の指数 n（値 = 0.digits * 10^n）に分解する */
+    std::string digits;
+    const char* p = buf.c_str();
+    if(*p == '-'){
+      os << '-';
+      p++;
+    }
+    for(; *p != 'e'; p++){
+      if(*p != '.') digits += *p;
+    }
+    const int n = std::atoi(p + 1) + 1;
+    while(digits.size() > 1 && digits.back() == '0') digits.pop_back();
+    const int k = static_cast<int>(digits.size());
+
+    if(k <= n && n <= 21){
+      os << digits << std::string(n - k, '0');
+    }
+    else if(0 < n && n <= 21){
+      os << digits.substr(0, n) << '.' << digits.substr(n);
+    }
+    else if(-6 < n && n <= 0){
+      os << "0." << std::string(-n, '0') << digits;
+    }
+    else{
+      os << digits[0];
+      if(k > 1) os << '.' << digits.substr(1);
+      os << 'e' << (n - 1 >= 0 ? "+" : "-") << std::to_string(std::abs(n - 1));
+    }
+  }
+
+  /** UTF-8 の文字列を UTF-16 のコード単位の順で比較する（RFC 8785 のキーの順序） */
+  template <typename S>
+  static bool utf16_less(const S& a, const S& b) {
+    const auto n = std::min(a.size(), b.size());
+    std::size_t i = 0;
+    while(i < n && a[i] == b[i]) i++;
+    if(i == n) return a.size() < b.size();
+    const auto ca = static_cast<unsigned char>(a[i]);
+    const auto cb = static_cast<unsigned char>(b[i]);
+    /** U+E000 以上の BMP の文字（EE..EF で始まる）とサロゲートペアの文字（F0.. で始まる）の順序のみ UTF-8 と異なる */
+    if(ca >= 0xEE && cb >= 0xEE){
+      const bool sa = ca >= 0xF0;
+      const bool sb = cb >= 0xF0;
+      if(sa != sb) return sa; /** U+D800.. のサロゲートは U+E000.. より小さい */
+    }
+    return ca < cb;
+  }
+
+  /** canonical の場合はキーの順に、それ以外は格納順に f(key, value, first) を呼び出す（値は複製しない） */
+  template <typename MAP, typename F>
+  void for_each_member(const MAP& m, F&& f) const {
+    if(!m_canonical){
+      bool first = true;
+      for(const auto& kv : m){
+        f(kv.first, kv.second, first);
+        first = false;
+      }
+      return;
+    }
+    std::vector<const typename MAP::value_type*> items;
+    items.reserve(m.size());
+    for(const auto& kv : m){
+      items.push_back(&kv);
+    }
+    std::sort(items.begin(), items.end(), [](const typename MAP::value_type* x, const typename MAP::value_type* y){
+      return utf16_less(x->first, y->first);
+    });
+    for(std::size_t i = 0; i < items.size(); i++){
+      f(items[i]->first, items[i]->second, i == 0);
+    }
+  }
+
+  template <typename S>
+  void write_string(std::ostream& os, const S& s) const {
+    os << "\"";
+    if(m_canonical) escape_canonical(os, s);
+    else            escape(os, s);
+    os << "\"";
+  }
+
+  /** canonical の場合は os のロケール（桁区切り等）に依存しない */
+  template <typename T>
+  void write_integer(std::ostream& os, T v) const {
+    if(m_canonical) os << std::to_string(v);
+    else            os << v;
+  }
+
+  void write_double(std::ostream& os, double d) const {
+    if(m_canonical) write_canonical_number(os, d);
+    else            os << d;
+  }
+
+  template <typename Traits>
+  void proceed(std::ostream& os, const basic_json<Traits>& j, int level) const {
+    using json_type = basic_json<Traits>;
     switch(j.value_type_id()) {
-      case json::value_type_id::integral: {
-        os << j.get<int64_t>();
+      case json_type::value_type_id::integral: {
+        write_integer(os, j.template get<int64_t>());
+        break;
+      }
+      case json_type::value_type_id::floating_point: {
+        write_double(os, j.template get<double>());
         break;
       }
-      case json::value_type_id::floating_point: {
-        os << j.get<double>();
+      case json_type::value_type_id::raw_number: {
+        /** 文字列のまま出力する（正規化する場合は数値に変換する） */
+        if(m_canonical) proceed(os, j.resolve_number(), level);
+        else            os << j.template get<typename json_type::raw_number>().text();
         break;
       }
-      case json::value_type_id::string: {
-        os << "\"";
-        escape(os, j.get<std::string>());
-        os << "\"";
+      case json_type::value_type_id::string: {
+        write_string(os, j.template get<typename json_type::string_type>());
         break;
       }
-      case json::value_type_id::boolean: {
-        os << (j.get<bool>() ? "true" : "false");
+      case json_type::value_type_id::boolean: {
+        os << (j.template get<bool>() ? "true" : "false");
         break;
       }
-      case json::value_type_id::null: {
+      case json_type::value_type_id::null: {
         os << "null";
         break;
       }
-      case json::value_type_id::array: {
+      case json_type::value_type_id::array: {
         os << "[";
         insertNewLine(os);
-        const auto& arr = j.get<json::array_type>();
+        const auto& arr = j.template get<typename json_type::array_type>();
         for(auto it = arr.begin(); it != arr.end(); it++){
           if(it != arr.begin()){
             os << ",";
@@ -89,28 +272,23 @@ private:
         os << "]";
         break;
       }
-      case json::value_type_id::object: {
+      case json_type::value_type_id::object: {
         os << "{";
         insertNewLine(os);
-        const auto& obj = j.get<json::object_type>();
-        for(auto it = obj.begin(); it != obj.end(); it++){
-          if(it != obj.begin()){
+        for_each_member(j.template get<typename json_type::object_type>(), [&](const auto& key, const json_type& value, bool first){
+          if(!first){
             os << ",";
             insertNewLine(os);
           }
-          insertIndent(os, level + 1);
-          os << "\"";
-          escape(os, it->first);
-          os << "\"" << ":";
-          if(m_indent.size() > 0) os << " ";
-          proceed(os, it->second, level + 1);
-        }
+          write_key(os, key, level + 1);
+          proceed(os, value, level + 1);
+        });
         insertNewLine(os);
         insertIndent(os, level);
         os << "}";
         break;
       }
-      case json::value_type_id::undefined: {
+      case json_type::value_type_id::undefined: {
         /**
          * json では undefined を表現できない。
          * また、JSON.strigify()では undefined は null となるため仕様を合わせた
@@ -122,12 +300,299 @@ private:
   }
 
 
+  /************** 構造体バインディング（中間の json を生成せずに出力する） ***************/
+  template <typename Traits>
+  void write_value(std::ostream& os, const basic_json<Traits>& v, int level) const {
+    proceed(os, v, level);
+  }
+
+  void write_value(std::ostream& os, bool v, int) const {
+    os << (v ? "true" : "false");
+  }
+
+  /** 符号無しの型は uint64_t として出力する（int64_t では UINT64_MAX が -1 になる） */
+  template <typename T, std::enable_if_t<json::is_integer_compatible<T>::value, bool> = true>
+  void write_value(std::ostream& os, const T& v, int) const {
+    write_integer(os, static_cast<std::conditional_t<std::is_unsigned<T>::value, uint64_t, int64_t>>(v));
+  }
+
+  template <typename T, std::enable_if_t<json::is_floating_point_compatible<T>::value, bool> = true>
+  void write_value(std::ostream& os, const T& v, int) const {
+    write_double(os, static_cast<double>(v));
+  }
+
+  void write_value(std::ostream& os, const std::string& v, int) const {
+    write_string(os, v);
+  }
+
+  template <typename T, typename A>
+  void write_value(std::ostream& os, const std::vector<T, A>& v, int level) const {
+    os << "[";
+    insertNewLine(os);
+    for(auto it = v.begin(); it != v.end(); it++){
+      if(it != v.begin()){
+        os << ",";
+        insertNewLine(os);
+      }
+      insertIndent(os, level + 1);
+      write_value(os, static_cast<const T&>(*it), level + 1);
+    }
+    insertNewLine(os);
+    insertIndent(os, level);
+    os << "]";
+  }
+
+  template <typename MAP>
+  void write_map(std::ostream& os, const MAP& v, int level) const {
+    os << "{";
+    insertNewLine(os);
+    for_each_member(v, [&](const std::string& key, const typename MAP::mapped_type& value, bool first){
+      if(!first){
+        os << ",";
+        insertNewLine(os);
+      }
+      write_key(os, key, level + 1);
+      write_value(os, value, level + 1);
+    });
+    insertNewLine(os);
+    insertIndent(os, level);
+    os << "}";
+  }
+
+  template <typename T, typename C, typename A>
+  void write_value(std::ostream& os, const std::map<std::string, T, C, A>& v, int level) const {
+    write_map(os, v, level);
+  }
+
+  template <typename T, typename H, typename E, typename A>
+  void write_value(std::ostream& os, const std::unordered_map<std::string, T, H, E, A>& v, int level) const {
+    write_map(os, v, level);
+  }
+
+#if __cplusplus >= 201703L
+  template <typename T>
+  void write_value(std::ostream& os, const std::optional<T>& v, int level) const {
+    if(v) write_value(os, *v, level);
+    else  os << "null";
+  }
+#endif
+
+  template <typename T>
+  static bool is_empty_optional(const T&) { return false; }
+
+#if __cplusplus >= 201703L
+  template <typename T>
+  static bool is_empty_optional(const std::optional<T>& v) { return !v.has_value(); }
+#endif
+
+  template <typename T, std::enable_if_t<binding<T>::available, bool> = true>
+  void write_value(std::ostream& os, const T& v, int level) const {
+    os << "{";
+    insertNewLine(os);
+    bool first = true;
+    const auto fields = binding<T>::fields();
+    auto write_field = [&](const auto& f){
+      const auto& member = v.*(f.member);
+      if(is_empty_optional(member)) return; /** 空の optional はキーごと省略する */
+      if(!first){
+        os << ",";
+        insertNewLine(os);
+      }
+      first = false;
+      write_key(os, std::string(f.name), level + 1);
+      write_value(os, member, level + 1);
+    };
+    if(m_canonical){
+      /** キーの順に出力する */
+      std::vector<std::pair<std::string, std::size_t>> order;
+      for_each_binding_field(fields, [&](const auto& f, std::size_t i){ order.push_back({f.name, i}); });
+      std::sort(order.begin(), order.end(), [](const std::pair<std::string, std::size_t>& x, const std::pair<std::string, std::size_t>& y){
+        return utf16_less(x.first, y.first);
+      });
+      for(const auto& o : order){
+        for_each_binding_field(fields, [&](const auto& f, std::size_t i){ if(i == o.second) write_field(f); });
+      }
+    }
+    else{
+      for_each_binding_field(fields, [&](const auto& f, std::size_t){ write_field(f); });
+    }
+    insertNewLine(os);
+    insertIndent(os, level);
+    os << "}";
+  }
+
+  template <typename S>
+  void write_key(std::ostream& os, const S& key, int level) const {
+    insertIndent(os, level);
+    write_string(os, key);
+    os << ":";
+    if(indented()) os << " ";
+  }
+
+  /************** 並列シリアライズ ***************/
+  /**
+   * 出力を順序通りに並べた断片の集まり。
+   * 要素数の多い array / object は chunk_size 毎の断片に分割し、断片の出力はタスクとして後で（並列に）実行する。
+   * その他の部分は計画を立てる時点で出力してしまう。
+   **/
+  struct parallel_plan {
+    const std::ostream&                               format;
+    std::vector<std::unique_ptr<std::ostringstream>>  outputs;
+    std::vector<std::function<void()>>                tasks;
+
+    parallel_plan(const std::ostream& fmt) : format(fmt) {
+      add_output();
+    }
+
+    std::ostream& current() { return *outputs.back(); }
+
+    /** 出力先の書式（精度など）を引き継いだ断片を追加する */
+    std::ostringstream& add_output() {
+      outputs.push_back(std::make_unique<std::ostringstream>());
+      outputs.back()->copyfmt(format);
+      return *outputs.back();
+    }
+  };
+
+  template <typename Traits>
+  void plan_parallel(parallel_plan& p, const basic_json<Traits>& j, int level, std::size_t chunk_size) const {
+    using json_type = basic_json<Traits>;
+    using member_type = typename json_type::object_type::value_type;
+    switch(j.value_type_id()) {
+      case json_type::value_type_id::array: {
+        const auto& arr = j.template get<typename json_type::array_type>();
+        p.current() << "[";
+        insertNewLine(p.current());
+        if(arr.size() > chunk_size){
+          for(std::size_t b = 0; b < arr.size(); b += chunk_size){
+            const auto e = std::min(arr.size(), b + chunk_size);
+            auto& out = p.add_output();
+            p.tasks.push_back([this, &arr, &out, b, e, level](){
+              for(auto i = b; i < e; i++){
+                if(i != 0){
+                  out << ",";
+                  insertNewLine(out);
+                }
+                insertIndent(out, level + 1);
+                proceed(out, arr[i], level + 1);
+              }
+            });
+          }
+          p.add_output();
+        }
+        else{
+          for(auto it = arr.begin(); it != arr.end(); it++){
+            if(it != arr.begin()){
+              p.current() << ",";
+              insertNewLine(p.current());
+            }
+            insertIndent(p.current(), level + 1);
+            plan_parallel(p, *it, level + 1, chunk_size);
+          }
+        }
+        insertNewLine(p.current());
+        insertIndent(p.current(), level);
+        p.current() << "]";
+        break;
+      }
+      case json_type::value_type_id::object: {
+        const auto& obj = j.template get<typename json_type::object_type>();
+        p.current() << "{";
+        insertNewLine(p.current());
+        if(obj.size() > chunk_size){
+          /** unordered_map は分割できないので、要素へのポインタを出力順に並べる */
+          auto items = std::make_shared<std::vector<const member_type*>>();
+          items->reserve(obj.size());
+          for(const auto& kv : obj){
+            items->push_back(&kv);
+          }
+          if(m_canonical){
+            std::sort(items->begin(), items->end(), [](const member_type* x, const member_type* y){
+              return utf16_less(x->first, y->first);
+            });
+          }
+          for(std::size_t b = 0; b < items->size(); b += chunk_size){
+            const auto e = std::min(items->size(), b + chunk_size);
+            auto& out = p.add_output();
+            p.tasks.push_back([this, items, &out, b, e, level](){
+              for(auto i = b; i < e; i++){
+                if(i != 0){
+                  out << ",";
+                  insertNewLine(out);
+                }
+                write_key(out, (*items)[i]->first, level + 1);
+                proceed(out, (*items)[i]->second, level + 1);
+              }
+            });
+          }
+          p.add_output();
+        }
+        else{
+          for_each_member(obj, [&](const auto& key, const json_type& value, bool first){
+            if(!first){
+              p.current() << ",";
+              insertNewLine(p.current());
+            }
+            write_key(p.current(), key, level + 1);
+            plan_parallel(p, value, level + 1, chunk_size);
+          });
+        }
+        insertNewLine(p.current());
+        insertIndent(p.current(), level);
+        p.current() << "}";
+        break;
+      }
+      default: {
+        proceed(p.current(), j, level);
+        break;
+      }
+    }
+  }
+
+  static void write_plan(std::ostream& os, const parallel_plan& p) {
+    for(const auto& out : p.outputs){
+      const auto s = out->str();
+      os.write(s.data(), s.size());
+    }
+  }
+
+  template <typename Traits>
+  void bind(const basic_json<Traits>& j) {
+    m_writer = [&j](const serializer& s, std::ostream& os){ s.proceed(os, j, 0); };
+    m_planner = [&j](const serializer& s, parallel_plan& p, std::size_t chunk_size){ s.plan_parallel(p, j, 0, chunk_size); };
+  }
+
 public:
   serializer(const json& j, const std::string& indent = std::string(""))
-    : m_json(j), m_indent(indent) {}
+    : m_indent(indent), m_canonical(false) {
+    bind(j);
+  }
+
+  /** json_traits 以外の basic_json（basic_json<my_traits> 等） */
+  template <typename Traits>
+  serializer(const basic_json<Traits>& j, const std::string& indent = std::string(""))
+    : m_indent(indent), m_canonical(false) {
+    bind(j);
+  }
+
+  /** 構造体（CPPJSON_BINDING で登録した型）や、そのコンテナを直接シリアライズする */
+  template <typename T, std::enable_if_t<!std::is_convertible<const T&, const json&>::value && !is_basic_json<T>::value, bool> = true>
+  serializer(const T& v, const std::string& indent = std::string(""))
+    : m_indent(indent), m_canonical(false),
+      m_writer([&v](const serializer& s, std::ostream& os){ s.write_value(os, v, 0); }) {}
+
+  /**
+   * RFC 8785（JCS）形式で出力する。同じ内容の json は常に同じバイト列となる。
+   * キーは UTF-16 のコード単位の順、浮動小数点は元の値に戻る最短の桁数（ECMAScript と同じ書式）で出力し、空白（indent）は出力しない。
+   * 整数（integral）は丸めずにそのまま出力する。
+   **/
+  serializer& canonical(bool enable = true) {
+    m_canonical = enable;
+    return *this;
+  }
 
   void execute(std::ostream& os) const{
-    proceed(os, m_json, 0);
+    m_writer(*this, os);
   }
 
   std::string execute() const {
@@ -135,6 +600,93 @@ public:
     execute(ss);
     return ss.str();
   }
+
+  /** タスクを実行する関数（タスクを別スレッドで実行して直ちに戻っても良いし、その場で実行しても良い） */
+  using executor = std::function<void(std::function<void()>)>;
+
+  /**
+   * 要素数が chunk_size を超える array / object を分割して threads 個のスレッドでシリアライズする。
+   * 出力は execute() と同一（インデントや os の書式設定を含む）。threads が 0 の場合は CPU のコア数とする。
+   **/
+  void execute_parallel(std::ostream& os, std::size_t threads = 0, std::size_t chunk_size = 4096) const {
+    if(!m_planner){
+      execute(os);
+      return;
+    }
+    parallel_plan p(os);
+    m_planner(*this, p, std::max<std::size_t>(chunk_size, 1));
+    if(threads == 0){
+      threads = std::max(1u, std::thread::hardware_concurrency());
+    }
+    threads = std::min(threads, p.tasks.size());
+
+    std::atomic<std::size_t> next(0);
+    std::exception_ptr error;
+    std::mutex error_mutex;
+    auto worker = [&](){
+      for(auto i = next++; i < p.tasks.size(); i = next++){
+        try{
+          p.tasks[i]();
+        }
+        catch(...){
+          std::lock_guard<std::mutex> lock(error_mutex);
+          if(!error) error = std::current_exception();
+        }
+      }
+    };
+    std::vector<std::thread> workers;
+    for(std::size_t i = 1; i < threads; i++){
+      workers.emplace_back(worker);
+    }
+    worker();
+    for(auto& t : workers){
+      t.join();
+    }
+    if(error) std::rethrow_exception(error);
+    write_plan(os, p);
+  }
+
+  /** 分割したタスクを ex で実行する */
+  void execute_parallel(std::ostream& os, const executor& ex, std::size_t chunk_size = 4096) const {
+    if(!m_planner){
+      execute(os);
+      return;
+    }
+    parallel_plan p(os);
+    m_planner(*this, p, std::max<std::size_t>(chunk_size, 1));
+    std::vector<std::future<void>> futures;
+    futures.reserve(p.tasks.size());
+    std::exception_ptr error;
+    for(auto& task : p.tasks){
+      auto pt = std::make_shared<std::packaged_task<void()>>(task);
+      futures.push_back(pt->get_future());
+      try{
+        ex([pt](){ (*pt)(); });
+      }
+      catch(...){
+        /** ex が破棄したタスクの future は broken_promise で完了する */
+        error = std::current_exception();
+        break;
+      }
+    }
+    /** 実行中のタスクは p と木を参照するため、例外の有無によらず全てのタスクの終了を待ってから送出する */
+    for(auto& f : futures){
+      try{
+        f.get();
+      }
+      catch(...){
+        if(!error) error = std::current_exception();
+      }
+    }
+    if(error) std::rethrow_exception(error);
+    write_plan(os, p);
+  }
+
+  std::string execute_parallel(std::size_t threads = 0, std::size_t chunk_size = 4096) const {
+    std::stringstream ss;
+    execute_parallel(ss, threads, chunk_size);
+    return ss.str();
+  }
 };
 } /** namespace cppjson */
 #endif /* !defined(__cppjson_h_serializer__) */
\ No newline at end of file
@@ -0,0 +1,164 @@
+#if !defined(__cppjson_h_shared_document__)
+#define __cppjson_h_shared_document__
+
+#include "json.h"
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <functional>
+#include <utility>
+
+namespace cppjson {
+
+/**
+ * 多数のスレッドから読み出され、まれに丸ごと置き換えられる json（設定ファイル等）の保持者（RCU）。
+ * shared_document config(load());
+ * // 読み出し側（ロックも共有の参照カウントも使用しない）
+ * {
+ *   auto r = config.read();
+ *   use((*r)["key"]);
+ * }
+ * // 書き込み側
+ * config.publish(load());
+ *
+ * 読み出し側はスレッド毎に分散した読み出し中のカウンタ（エポックの偶奇毎）を増減するのみで、
+ * 他のスレッドとキャッシュラインを奪い合わない。
+ * publish() は新しい json に切り替えた後にエポックを進め、古いエポックで読み出し中のスレッドが全て抜けるまで待ってから古い json を破棄する。
+ * 古い json の破棄は publish() を呼び出したスレッドで行うため、読み出し側が破棄の負担を負うことはない。
+ * read() で得た参照は reader の破棄まで有効である。reader を保持したまま同じスレッドで publish() を呼び出してはならない（待ち続ける）。
+ * 読み出し側は const でのみ参照すること。
+ **/
+class shared_document {
+private:
+  static constexpr std::size_t shard_count = 64;
+
+  /** 読み出し中のスレッド数（エポックの偶奇毎）。隣接するシャードとキャッシュラインを共有しないよう詰め物をする */
+  struct shard {
+    std::atomic<std::size_t> readers[2];
+    char padding[64 - 2 * sizeof(std::atomic<std::size_t>)];
+
+    shard() {
+      readers[0].store(0);
+      readers[1].store(0);
+    }
+  };
+
+  std::atomic<const json*> m_current;
+  std::atomic<uint64_t> m_epoch;
+  shard m_shards[shard_count];
+  std::mutex m_writer;
+
+  static std::size_t shard_index() {
+    static thread_local const std::size_t index = std::hash<std::thread::id>()(std::this_thread::get_id()) % shard_count;
+    return index;
+  }
+
+  /** 古いエポックで読み出し中のスレッドが無くなるまで待つ（m_writer をロックしていること） */
+  void wait_for_readers(uint64_t epoch) {
+    const auto parity = epoch & 1;
+    for(auto& s : m_shards){
+      while(s.readers[parity].load() != 0){
+        std::this_thread::yield();
+      }
+    }
+  }
+
+public:
+  /** 読み出し中であることを示す（破棄するまで参照先の json は破棄されない） */
+  class reader {
+  private:
+    std::atomic<std::size_t>* m_counter;
+    const json* m_json;
+
+    friend class shared_document;
+
+    reader(std::atomic<std::size_t>* counter, const json* j) : m_counter(counter), m_json(j) {}
+
+  public:
+    reader(const reader&) = delete;
+    reader& operator =(const reader&) = delete;
+
+    reader(reader&& src) : m_counter(src.m_counter), m_json(src.m_json) {
+      src.m_counter = nullptr;
+      src.m_json = nullptr;
+    }
+
+    ~reader() {
+      if(m_counter) m_counter->fetch_sub(1);
+    }
+
+    const json& operator *() const { return *m_json; }
+    const json* operator ->() const { return m_json; }
+    const json& get() const { return *m_json; }
+  };
+
+  shared_document() : shared_document(json()) {}
+
+  shared_document(json&& j) : m_current(new json(std::move(j))), m_epoch(0) {}
+
+  shared_document(const shared_document&) = delete;
+  shared_document& operator =(const shared_document&) = delete;
+
+  /** 読み出し中の reader が無いこと */
+  ~shared_document() {
+    delete m_current.load();
+  }
+
+  /** 現在の json を読み出す（ロックフリー） */
+  reader read() {
+    auto& s = m_shards[shard_index()];
+    for(;;){
+      const auto epoch = m_epoch.load();
+      auto& counter = s.readers[epoch & 1];
+      counter.fetch_add(1);
+      /**
+       * カウンタを増やす前にエポックが進んでいた場合、publish() はこのカウンタを待たずに破棄する可能性があるためやり直す。
+       * （エポックが進んでいなければ、publish() はこのカウンタが 0 になるまで待つ）
+       **/
+      if(m_epoch.load() == epoch){
+        return reader(&counter, m_current.load());
+      }
+      counter.fetch_sub(1);
+    }
+  }
+
+  /** f(const json&) を読み出し中に呼び出し、その結果を返却する */
+  template <typename F>
+  auto read(F&& f) -> decltype(f(std::declval<const json&>())) {
+    const auto r = read();
+    return f(*r);
+  }
+
+  /**
+   * j に置き換える。置き換える前の json を読み出し中のスレッドが全て抜けてから、古い json を破棄して復帰する。
+   * 書き込み側同士は直列化される。
+   **/
+  void publish(json&& j) {
+    std::unique_ptr<const json> retired;
+    {
+      std::lock_guard<std::mutex> lock(m_writer);
+      retired.reset(m_current.exchange(new json(std::move(j))));
+      const auto epoch = m_epoch.load();
+      m_epoch.store(epoch + 1);
+      wait_for_readers(epoch);
+    }
+    /** retired の破棄（木の解放）はロックの外で行う */
+  }
+
+  void publish(const json& j) {
+    publish(j.clone());
+  }
+
+  /** 現在の json の複製（更新して publish() する場合に使用する） */
+  json snapshot() {
+    const auto r = read();
+    return r->clone();
+  }
+
+  /** 更新された回数 */
+  uint64_t version() const { return m_epoch.load(); }
+};
+
+} /** namespace cppjson */
+#endif /* !defined(__cppjson_h_shared_document__) */
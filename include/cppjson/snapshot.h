@@ -0,0 +1,415 @@
+#if !defined(__cppjson_h_snapshot__)
+#define __cppjson_h_snapshot__
+
+#include "json.h"
+#include <ostream>
+#include <cstring>
+#include <algorithm>
+
+namespace cppjson {
+
+/**
+ * json をそのまま読み出せる形でバイナリ化したスナップショット。
+ * 全ての参照はファイル先頭からのオフセットで表現するため、
+ * ファイルを mmap したメモリ（または読み込んだバッファ）をデシリアライズせずに直接参照できる。
+ *
+ * レイアウト（数値はネイティブのバイトオーダー、各テーブルは 8 バイト境界に配置）
+ * header   : magic(8) version(4) byte_order(4) total_size(8) root(slot)
+ * slot     : type(1) reserved(3) size(4) payload(8)
+ *            integral / floating_point / boolean は payload に値を直接保持する。
+ *            string は size に長さ、payload に文字列（'\0' 終端）のオフセットを保持する。
+ *            array は size に要素数、payload に slot の配列のオフセットを保持する。
+ *            object は size に要素数、payload に entry の配列（キーで昇順ソート済み）のオフセットを保持する。
+ * entry    : key_offset(8) key_size(4) reserved(4) value(slot)
+ **/
+namespace snapshot_format {
+  static constexpr char     magic[8] = {'C', 'P', 'J', 'S', 'N', 'A', 'P', '\0'};
+  static constexpr uint32_t version = 1;
+  static constexpr uint32_t byte_order = 0x01020304;
+
+  struct slot {
+    uint8_t   type;
+    uint8_t   reserved[3];
+    uint32_t  size;
+    uint64_t  payload;
+  };
+
+  struct entry {
+    uint64_t  key_offset;
+    uint32_t  key_size;
+    uint32_t  reserved;
+    slot      value;
+  };
+
+  struct header {
+    char      magic[8];
+    uint32_t  version;
+    uint32_t  byte_order;
+    uint64_t  total_size;
+    slot      root;
+  };
+
+  static_assert(sizeof(slot) == 16, "unexpected snapshot slot size");
+  static_assert(sizeof(entry) == 32, "unexpected snapshot entry size");
+  static_assert(sizeof(header) == 40, "unexpected snapshot header size");
+} /** namespace snapshot_format */
+
+/** json からスナップショットのバイト列を生成する */
+class snapshot_serializer {
+private:
+  using slot = snapshot_format::slot;
+  using entry = snapshot_format::entry;
+  using header = snapshot_format::header;
+
+  const json& m_json;
+
+  static std::size_t allocate(std::string& out, std::size_t size) {
+    const auto offset = (out.size() + 7) & ~static_cast<std::size_t>(7);
+    out.resize(offset + size, '\0');
+    return offset;
+  }
+
+  static uint32_t checked_size(std::size_t n) {
+    if(n > 0xFFFFFFFFull){
+      throw bad_snapshot("snapshot cannot hold more than 2^32-1 elements or bytes");
+    }
+    return static_cast<uint32_t>(n);
+  }
+
+  static std::size_t write_string(std::string& out, const std::string& s) {
+    const auto offset = out.size();
+    out.append(s);
+    out += '\0';
+    return offset;
+  }
+
+  static slot make_slot(enum json::value_type_id type, uint32_t size, uint64_t payload) {
+    slot s;
+    std::memset(&s, 0, sizeof(s));
+    s.type = static_cast<uint8_t>(type);
+    s.size = size;
+    s.payload = payload;
+    return s;
+  }
+
+  static slot proceed(std::string& out, const json& j) {
+    const auto type = j.value_type_id();
+    switch(type){
+      case json::value_type_id::integral: {
+        return make_slot(type, 0, static_cast<uint64_t>(j.get<int64_t>()));
+      }
+      case json::value_type_id::floating_point: {
+        const double d = j.get<double>();
+        uint64_t bits;
+        std::memcpy(&bits, &d, sizeof(bits));
+        return make_slot(type, 0, bits);
+      }
+      case json::value_type_id::raw_number: {
+        return proceed(out, j.resolve_number());
+      }
+      case json::value_type_id::boolean: {
+        return make_slot(type, 0, j.get<bool>() ? 1 : 0);
+      }
+      case json::value_type_id::string: {
+        const auto& s = j.get<std::string>();
+        const auto size = checked_size(s.size());
+        return make_slot(type, size, write_string(out, s));
+      }
+      case json::value_type_id::array: {
+        const auto& arr = j.get<json::array_type>();
+        const auto n = checked_size(arr.size());
+        const auto table = allocate(out, n * sizeof(slot));
+        for(std::size_t i = 0; i < n; i++){
+          const auto s = proceed(out, arr[i]);
+          std::memcpy(&out[table + i * sizeof(slot)], &s, sizeof(slot));
+        }
+        return make_slot(type, n, table);
+      }
+      case json::value_type_id::object: {
+        const auto& obj = j.get<json::object_type>();
+        const auto n = checked_size(obj.size());
+        /** 値はコピーせず、要素へのポインタをキーでソートする */
+        std::vector<const json::object_type::value_type*> sorted;
+        sorted.reserve(n);
+        for(const auto& kv : obj){
+          sorted.push_back(&kv);
+        }
+        std::sort(sorted.begin(), sorted.end(), [](auto a, auto b){ return a->first < b->first; });
+
+        const auto table = allocate(out, n * sizeof(entry));
+        for(std::size_t i = 0; i < n; i++){
+          entry e;
+          std::memset(&e, 0, sizeof(e));
+          e.key_size = checked_size(sorted[i]->first.size());
+          e.key_offset = write_string(out, sorted[i]->first);
+          e.value = proceed(out, sorted[i]->second);
+          std::memcpy(&out[table + i * sizeof(entry)], &e, sizeof(entry));
+        }
+        return make_slot(type, n, table);
+      }
+      default: /** null, undefined */ {
+        return make_slot(type, 0, 0);
+      }
+    }
+  }
+
+public:
+  snapshot_serializer(const json& j) : m_json(j) {}
+
+  void execute(std::string& out) const {
+    out.clear();
+    out.resize(sizeof(header), '\0');
+    const auto root = proceed(out, m_json);
+    out.resize((out.size() + 7) & ~static_cast<std::size_t>(7), '\0');
+
+    header h;
+    std::memset(&h, 0, sizeof(h));
+    std::memcpy(h.magic, snapshot_format::magic, sizeof(h.magic));
+    h.version = snapshot_format::version;
+    h.byte_order = snapshot_format::byte_order;
+    h.total_size = out.size();
+    h.root = root;
+    std::memcpy(&out[0], &h, sizeof(h));
+  }
+
+  std::string execute() const {
+    std::string out;
+    execute(out);
+    return out;
+  }
+
+  void execute(std::ostream& os) const {
+    const auto s = execute();
+    os.write(s.data(), s.size());
+  }
+};
+
+/**
+ * スナップショット上の値を参照する（コピー可能な軽量オブジェクト）。
+ * 参照先のバッファは snapshot_view を使用する間、有効でなければならない。
+ * バッファは 8 バイト境界に配置されていること（mmap や new で確保した領域であれば問題ない）。
+ * auto root = snapshot_view::from(ptr, size);
+ * root["user"]["id"].get<int>();
+ **/
+class snapshot_view {
+private:
+  using slot = snapshot_format::slot;
+  using entry = snapshot_format::entry;
+  using header = snapshot_format::header;
+
+  const char*   m_base;
+  std::size_t   m_size;
+  const slot*   m_slot;
+
+  snapshot_view(const char* base, std::size_t size, const slot* s)
+    : m_base(base), m_size(size), m_slot(s) {}
+
+  static const slot* undefined_slot() {
+    static const slot s = { static_cast<uint8_t>(json::value_type_id::undefined), {0, 0, 0}, 0, 0 };
+    return &s;
+  }
+
+  snapshot_view undefined() const {
+    return snapshot_view(m_base, m_size, undefined_slot());
+  }
+
+  /**
+   * offset から size バイトがバッファ内に収まっているか確認してポインタを返却する。
+   * align は offset の境界（slot / entry として参照する場合は不正な境界の読み出しにならないよう確認する）。
+   **/
+  const char* at(uint64_t offset, uint64_t size, std::size_t align = 1) const {
+    if(offset > m_size || size > m_size - offset){
+      throw bad_snapshot("snapshot offset out of range");
+    }
+    if(offset % align != 0){
+      throw bad_snapshot("snapshot offset is misaligned");
+    }
+    return m_base + offset;
+  }
+
+  const slot* slots() const {
+    return reinterpret_cast<const slot*>(at(m_slot->payload, static_cast<uint64_t>(m_slot->size) * sizeof(slot), alignof(slot)));
+  }
+
+  const entry* entries() const {
+    return reinterpret_cast<const entry*>(at(m_slot->payload, static_cast<uint64_t>(m_slot->size) * sizeof(entry), alignof(entry)));
+  }
+
+  static int compare_key(const char* key, std::size_t key_size, const char* s, std::size_t size) {
+    const auto r = std::memcmp(key, s, std::min(key_size, size));
+    if(r != 0) return r;
+    return key_size < size ? -1 : (key_size > size ? 1 : 0);
+  }
+
+  [[noreturn]] void throw_bad_cast(enum json::value_type_id to) const {
+    std::stringstream ss;
+    ss << "bad_cast: " << json::value_type_string(value_type_id()) << " -> " << json::value_type_string(to);
+    throw bad_cast(ss.str());
+  }
+
+public:
+  /** バッファのヘッダを検証してルートの値を返却する */
+  static snapshot_view from(const void* data, std::size_t size) {
+    const auto base = static_cast<const char*>(data);
+    if(reinterpret_cast<uintptr_t>(base) % 8 != 0){
+      throw bad_snapshot("snapshot buffer must be 8-byte aligned");
+    }
+    if(size < sizeof(header)){
+      throw bad_snapshot("snapshot is too short");
+    }
+    const auto h = reinterpret_cast<const header*>(base);
+    if(std::memcmp(h->magic, snapshot_format::magic, sizeof(h->magic)) != 0){
+      throw bad_snapshot("not a snapshot");
+    }
+    if(h->byte_order != snapshot_format::byte_order){
+      throw bad_snapshot("snapshot byte order mismatch");
+    }
+    if(h->version != snapshot_format::version){
+      throw bad_snapshot("unsupported snapshot version");
+    }
+    if(h->total_size > size){
+      throw bad_snapshot("snapshot is truncated");
+    }
+    return snapshot_view(base, static_cast<std::size_t>(h->total_size), &h->root);
+  }
+
+  static snapshot_view from(const std::string& s) {
+    return from(s.data(), s.size());
+  }
+
+  /************** 状態・属性 ***************/
+  enum json::value_type_id value_type_id() const {
+    return static_cast<enum json::value_type_id>(m_slot->type);
+  }
+
+  bool is_undefined() const         { return value_type_id() == json::value_type_id::undefined; }
+  bool is_null() const              { return value_type_id() == json::value_type_id::null; }
+  bool is_null_or_undefined() const { return is_undefined() || is_null(); }
+
+  /** array / object の要素数、string の長さ */
+  std::size_t size() const {
+    switch(value_type_id()){
+      case json::value_type_id::string:
+      case json::value_type_id::array:
+      case json::value_type_id::object: { return m_slot->size; }
+      default: { return 0; }
+    }
+  }
+
+  /************** 取得 ***************/
+  /** number型（int64_t or double からの型変換を許容する） */
+  template <typename T, std::enable_if_t<json::is_number_type<T>::value, bool> = true>
+  T get() const {
+    if(is_undefined()) value_is_undefined::throw_error();
+    if(value_type_id() == json::value_type_id::integral){
+      return static_cast<T>(static_cast<int64_t>(m_slot->payload));
+    }
+    if(value_type_id() == json::value_type_id::floating_point){
+      double d;
+      std::memcpy(&d, &m_slot->payload, sizeof(d));
+      return static_cast<T>(d);
+    }
+    throw_bad_cast(std::is_integral<T>::value ? json::value_type_id::integral : json::value_type_id::floating_point);
+  }
+
+  template <typename T, std::enable_if_t<std::is_same<T, bool>::value, bool> = true>
+  T get() const {
+    if(is_undefined()) value_is_undefined::throw_error();
+    if(value_type_id() != json::value_type_id::boolean) throw_bad_cast(json::value_type_id::boolean);
+    return m_slot->payload != 0;
+  }
+
+  /** string はコピーを返却する（コピーしない場合は c_str() と size() を使用する） */
+  template <typename T, std::enable_if_t<std::is_same<T, std::string>::value, bool> = true>
+  T get() const {
+    return std::string(c_str(), size());
+  }
+
+  /** string の先頭（'\0' 終端） */
+  const char* c_str() const {
+    if(is_undefined()) value_is_undefined::throw_error();
+    if(value_type_id() != json::value_type_id::string) throw_bad_cast(json::value_type_id::string);
+    return at(m_slot->payload, static_cast<uint64_t>(m_slot->size) + 1);
+  }
+
+  /************** operator [] ***************/
+  /** object型に対する [] アクセス（二分探索）。見つからない場合は undefined を返却する。 */
+  snapshot_view operator [](const char* key) const {
+    return find(key, std::strlen(key));
+  }
+
+  snapshot_view operator [](const std::string& key) const {
+    return find(key.data(), key.size());
+  }
+
+  snapshot_view find(const char* key, std::size_t key_size) const {
+    if(value_type_id() != json::value_type_id::object) return undefined();
+    const auto e = entries();
+    std::size_t lo = 0;
+    std::size_t hi = m_slot->size;
+    while(lo < hi){
+      const auto mid = lo + (hi - lo) / 2;
+      const auto k = at(e[mid].key_offset, e[mid].key_size);
+      const auto r = compare_key(k, e[mid].key_size, key, key_size);
+      if(r == 0) return snapshot_view(m_base, m_size, &e[mid].value);
+      if(r < 0) lo = mid + 1;
+      else      hi = mid;
+    }
+    return undefined();
+  }
+
+  /** array型に対する [] アクセス。範囲外の場合は undefined を返却する。 */
+  snapshot_view operator [](std::size_t index) const {
+    if(value_type_id() != json::value_type_id::array || index >= m_slot->size) return undefined();
+    return snapshot_view(m_base, m_size, &slots()[index]);
+  }
+
+  snapshot_view operator [](int index) const {
+    return index < 0 ? undefined() : (*this)[static_cast<std::size_t>(index)];
+  }
+
+  /** object の index 番目（キーの昇順）のキーと値 */
+  std::string key_at(std::size_t index) const {
+    if(value_type_id() != json::value_type_id::object || index >= m_slot->size) return std::string();
+    const auto& e = entries()[index];
+    return std::string(at(e.key_offset, e.key_size), e.key_size);
+  }
+
+  snapshot_view value_at(std::size_t index) const {
+    if(value_type_id() != json::value_type_id::object) return (*this)[index];
+    if(index >= m_slot->size) return undefined();
+    return snapshot_view(m_base, m_size, &entries()[index].value);
+  }
+
+  /************** 変換 ***************/
+  /** json として実体化する */
+  json to_json() const {
+    switch(value_type_id()){
+      case json::value_type_id::integral:       { return json(get<int64_t>()); }
+      case json::value_type_id::floating_point: { return json(get<double>()); }
+      case json::value_type_id::boolean:        { return json(get<bool>()); }
+      case json::value_type_id::null:           { return json(nullptr); }
+      case json::value_type_id::string:         { return json(get<std::string>()); }
+      case json::value_type_id::array: {
+        json::array_type arr;
+        arr.reserve(size());
+        for(std::size_t i = 0; i < size(); i++){
+          arr.push_back((*this)[i].to_json());
+        }
+        return json(std::move(arr));
+      }
+      case json::value_type_id::object: {
+        json::object_type obj;
+        obj.reserve(size());
+        for(std::size_t i = 0; i < size(); i++){
+          obj.insert({key_at(i), value_at(i).to_json()});
+        }
+        return json(std::move(obj));
+      }
+      default: /** undefined */ { return json(); }
+    }
+  }
+};
+
+} /** namespace cppjson */
+#endif /* !defined(__cppjson_h_snapshot__) */
@@ -0,0 +1,152 @@
+#if !defined(__cppjson_h_utf8__)
+#define __cppjson_h_utf8__
+
+#include <string>
+#include <cstdint>
+#include <cstring>
+
+namespace cppjson {
+
+/** 不正な UTF-8 の並びと対になっていないサロゲート（\uD800 等）の取り扱い */
+enum class utf8_policy {
+  reject,   /** エラーとする */
+  replace   /** U+FFFD に置き換える（不正な並びは、正しい並びの先頭として成立する最長の部分毎に１つ置き換える） */
+};
+
+/**
+ * UTF-8（RFC 3629）と UTF-16 のサロゲートの取り扱い。deserializer / push_deserializer / literal で共有する。
+ * utf8::valid(s) は入力全体の検証に使用でき、ASCII の部分は 8 バイトずつ判定する。
+ **/
+class utf8 {
+private:
+  /** 末尾の手前で 4 バイトに満たない場合の読み出し（範囲外は 0） */
+  struct bounded {
+    const char* s;
+    std::size_t n;
+    char operator [](std::size_t i) const { return i < n ? s[i] : '\0'; }
+  };
+
+public:
+  static constexpr uint32_t replacement_character = 0xFFFD;
+
+  /**
+   * at[0] から始まる UTF-8 の１文字のバイト数。不正な場合は 0 を返却し、invalid に不正な部分（1 以上）のバイト数を設定する。
+   * at[i] は終端の後で継続バイトではない値（'\0' 等）を返却すること。
+   **/
+  template <typename AT>
+  static constexpr std::size_t sequence_length(const AT& at, std::size_t& invalid) {
+    const auto lead = static_cast<unsigned char>(at[0]);
+    std::size_t n = 0;
+    unsigned char lo = 0x80;
+    unsigned char hi = 0xBF;
+    if(lead < 0x80)                       { return 1; }
+    else if(lead >= 0xC2 && lead <= 0xDF) { n = 2; }
+    else if(lead == 0xE0)                 { n = 3; lo = 0xA0; }
+    else if(lead == 0xED)                 { n = 3; hi = 0x9F; } /** サロゲートを除く */
+    else if(lead >= 0xE1 && lead <= 0xEF) { n = 3; }
+    else if(lead == 0xF0)                 { n = 4; lo = 0x90; }
+    else if(lead == 0xF4)                 { n = 4; hi = 0x8F; } /** U+10FFFF まで */
+    else if(lead >= 0xF1 && lead <= 0xF3) { n = 4; }
+    else{
+      invalid = 1;
+      return 0;
+    }
+    for(std::size_t i = 1; i < n; i++){
+      const auto c = static_cast<unsigned char>(at[i]);
+      if(c < lo || c > hi){
+        invalid = i;
+        return 0;
+      }
+      lo = 0x80;
+      hi = 0xBF;
+    }
+    return n;
+  }
+
+  static constexpr bool is_high_surrogate(uint32_t u) { return u >= 0xD800 && u <= 0xDBFF; }
+  static constexpr bool is_low_surrogate(uint32_t u)  { return u >= 0xDC00 && u <= 0xDFFF; }
+
+  /** サロゲートの対からコードポイントを求める */
+  static constexpr uint32_t combine(uint32_t high, uint32_t low) {
+    return 0x10000 + ((high - 0xD800) << 10) + (low - 0xDC00);
+  }
+
+  /** cp を UTF-8 で s に追加する（S は += char が可能であること） */
+  template <typename S>
+  static void append(S& s, uint32_t cp) {
+    if(cp <= 0x7F){
+      s += static_cast<char>(cp);
+    }
+    else if(cp <= 0x7FF){
+      s += static_cast<char>(0xC0 | (cp >> 6));
+      s += static_cast<char>(0x80 | (cp & 0x3F));
+    }
+    else if(cp <= 0xFFFF){
+      s += static_cast<char>(0xE0 | (cp >> 12));
+      s += static_cast<char>(0x80 | ((cp >> 6) & 0x3F));
+      s += static_cast<char>(0x80 | (cp & 0x3F));
+    }
+    else{
+      s += static_cast<char>(0xF0 | (cp >> 18));
+      s += static_cast<char>(0x80 | ((cp >> 12) & 0x3F));
+      s += static_cast<char>(0x80 | ((cp >> 6) & 0x3F));
+      s += static_cast<char>(0x80 | (cp & 0x3F));
+    }
+  }
+
+  /** s から n バイトのうち、先頭から正しい UTF-8 である部分のバイト数（全て正しい場合は n） */
+  static std::size_t valid_prefix(const char* s, std::size_t n) {
+    std::size_t i = 0;
+    while(i < n){
+      /** ASCII は 8 バイトずつ判定する */
+      while(i + 8 <= n){
+        uint64_t w;
+        std::memcpy(&w, s + i, sizeof(w));
+        if(w & 0x8080808080808080ull) break;
+        i += 8;
+      }
+      if(i >= n) break;
+      if(static_cast<unsigned char>(s[i]) < 0x80){
+        i++;
+        continue;
+      }
+      std::size_t invalid = 0;
+      const auto len = (n - i >= 4) ? sequence_length(s + i, invalid) : sequence_length(bounded{s + i, n - i}, invalid);
+      if(len == 0) return i;
+      i += len;
+    }
+    return n;
+  }
+
+  static bool valid(const char* s, std::size_t n) {
+    return valid_prefix(s, n) == n;
+  }
+
+  static bool valid(const std::string& s) {
+    return valid(s.data(), s.size());
+  }
+
+  /** 不正な並びを U+FFFD に置き換える（置き換えた場合は true） */
+  static bool sanitize(std::string& s) {
+    auto i = valid_prefix(s.data(), s.size());
+    if(i == s.size()) return false;
+    std::string out(s, 0, i);
+    while(i < s.size()){
+      std::size_t invalid = 0;
+      const auto len = sequence_length(bounded{s.data() + i, s.size() - i}, invalid);
+      if(len == 0){
+        append(out, replacement_character);
+        i += invalid;
+      }
+      else{
+        out.append(s, i, len);
+        i += len;
+      }
+    }
+    s.swap(out);
+    return true;
+  }
+};
+
+} /** namespace cppjson */
+#endif /* !defined(__cppjson_h_utf8__) */
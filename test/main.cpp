@@ -2,9 +2,141 @@
 #include <iostream>
 #include <map>
 #include <list>
+#include <iomanip>
+#include <thread>
+#include <atomic>
+#include <fstream>
+#include <cstdio>
+#include <cassert>
+#include <locale>
+#include <chrono>
+#include <stdexcept>
+#if defined(CPPJSON_TEST_EMBEDDED)
+#include <cppjson_embedded/embedded.h> /** CMake の cppjson_embed_json() で test/embedded.json から生成する */
+#endif
 
 using namespace cppjson;
 
+struct test_item {
+  std::string name;
+  double price;
+  std::vector<int> sizes;
+};
+CPPJSON_BINDING(test_item, CPPJSON_FIELD(name), CPPJSON_FIELD(price), CPPJSON_FIELD(sizes))
+
+struct test_limits {
+  int32_t i;
+  uint64_t u;
+  int8_t s;
+};
+CPPJSON_BINDING(test_limits, CPPJSON_FIELD(i), CPPJSON_FIELD(u), CPPJSON_FIELD(s))
+
+struct test_order {
+  int64_t id;
+  bool paid;
+  std::vector<test_item> items;
+  std::map<std::string, int> counts;
+  std::string memo;
+  json extra;
+};
+CPPJSON_BINDING(test_order,
+  CPPJSON_NAMED_FIELD("order_id", id),
+  CPPJSON_FIELD(paid),
+  CPPJSON_FIELD(items),
+  CPPJSON_FIELD(counts),
+  CPPJSON_OPTIONAL_FIELD(memo),
+  CPPJSON_OPTIONAL_FIELD(extra)
+)
+
+/** 確保中の領域の数を数えるアロケータ（basic_json の Traits の確認用） */
+static std::atomic<long> test_live_allocations(0);
+
+template <typename T>
+struct test_counting_allocator {
+  using value_type = T;
+  test_counting_allocator() = default;
+  template <typename U> test_counting_allocator(const test_counting_allocator<U>&) {}
+  T* allocate(std::size_t n) {
+    test_live_allocations++;
+    return std::allocator<T>().allocate(n);
+  }
+  void deallocate(T* p, std::size_t n) {
+    test_live_allocations--;
+    std::allocator<T>().deallocate(p, n);
+  }
+  template <typename U> bool operator ==(const test_counting_allocator<U>&) const { return true; }
+  template <typename U> bool operator !=(const test_counting_allocator<U>&) const { return false; }
+};
+
+using test_string = std::basic_string<char, std::char_traits<char>, test_counting_allocator<char>>;
+
+namespace std {
+  template <> struct hash<test_string> {
+    std::size_t operator()(const test_string& s) const { return std::hash<std::string>()(std::string(s.data(), s.size())); }
+  };
+}
+
+/** キーの順に並ぶ object と、全ての領域を test_counting_allocator で確保する json */
+struct test_ordered_traits {
+  using string_type = test_string;
+  template <typename J> using array_type = std::vector<J, test_counting_allocator<J>>;
+  template <typename J> using object_type = std::map<test_string, J, std::less<test_string>, test_counting_allocator<std::pair<const test_string, J>>>;
+  template <typename T> using allocator_type = test_counting_allocator<T>;
+};
+using test_ordered_json = basic_json<test_ordered_traits>;
+
+/** キーの順に vector で保持する map（要素を追加・削除すると後続の要素のアドレスが変わる） */
+template <typename K, typename V>
+class test_flat_map {
+public:
+  using key_type = K;
+  using mapped_type = V;
+  using value_type = std::pair<K, V>;
+  using iterator = typename std::vector<value_type>::iterator;
+  using const_iterator = typename std::vector<value_type>::const_iterator;
+private:
+  std::vector<value_type> m_items;
+  template <typename I> static I lower_bound(I first, I last, const K& key) {
+    return std::lower_bound(first, last, key, [](const value_type& a, const K& b){ return a.first < b; });
+  }
+public:
+  iterator begin()             { return m_items.begin(); }
+  iterator end()               { return m_items.end(); }
+  const_iterator begin() const { return m_items.begin(); }
+  const_iterator end() const   { return m_items.end(); }
+  std::size_t size() const     { return m_items.size(); }
+  bool empty() const           { return m_items.empty(); }
+  void clear()                 { m_items.clear(); }
+  iterator find(const K& key) {
+    auto it = lower_bound(m_items.begin(), m_items.end(), key);
+    return it != m_items.end() && it->first == key ? it : m_items.end();
+  }
+  const_iterator find(const K& key) const {
+    auto it = lower_bound(m_items.begin(), m_items.end(), key);
+    return it != m_items.end() && it->first == key ? it : m_items.end();
+  }
+  std::size_t count(const K& key) const { return find(key) != end() ? 1 : 0; }
+  template <typename KK, typename VV> std::pair<iterator, bool> emplace(KK&& key, VV&& value) {
+    K k(std::forward<KK>(key));
+    auto it = lower_bound(m_items.begin(), m_items.end(), k);
+    if(it != m_items.end() && it->first == k) return {it, false};
+    return {m_items.insert(it, value_type(std::move(k), std::forward<VV>(value))), true};
+  }
+  std::pair<iterator, bool> insert(value_type&& v) { return emplace(std::move(v.first), std::move(v.second)); }
+  V& operator [](const K& key) { return emplace(key, V()).first->second; }
+  V& at(const K& key)             { return find(key)->second; }
+  const V& at(const K& key) const { return find(key)->second; }
+  iterator erase(iterator it)     { return m_items.erase(it); }
+};
+
+struct test_flat_traits {
+  using string_type = std::string;
+  template <typename J> using array_type = std::vector<J>;
+  template <typename J> using object_type = test_flat_map<std::string, J>;
+  template <typename T> using allocator_type = std::allocator<T>;
+};
+using test_flat_json = basic_json<test_flat_traits>;
+
 enum class compare { same, different };
 
 template<typename JSON_VALUE_TYPE, typename EXCEPTED_VALUE_TYPE>
@@ -472,6 +604,1995 @@ void test_019() {
   fn(true , R"( [{},[],[[]]] )");
 }
 
+void test_020() {
+  const std::string src = R"(
+    {
+      "user_id": 123,   /* abc
+      ****/
+      "name": "Alice", // name
+      "obj": {
+        "value1": 1.5e2,
+        "value2": "2",
+        "value3": [
+          1, true, /* comment */ "ABC\n\u03A9DEF", null, false
+        ]
+      }
+    }
+  )";
+  /** 1文字ずつ feed しても分割しない場合と同じ結果になる */
+  for(std::size_t chunk : {std::size_t(1), std::size_t(3), std::size_t(7), src.size()}){
+    push_deserializer p;
+    for(std::size_t pos = 0; pos < src.size(); pos += chunk){
+      p.feed(src.data() + pos, std::min(chunk, src.size() - pos));
+    }
+    assert(p.completed());
+    auto jj = p.finish();
+    valueValidation<int>(path_util::find(jj, "user_id"), 123, compare::same);
+    valueValidation<std::string>(path_util::find(jj, "name"), "Alice", compare::same);
+    valueValidation<double>(path_util::find(jj, "obj.value1"), 150.0, compare::same);
+    auto value3 = path_util::find(jj, "obj.value3");
+    valueValidation<std::string>((*value3)[2], "ABC\nΩDEF", compare::same);
+    assert((*value3)[3].is_null());
+    valueValidation<bool>((*value3)[4], false, compare::same);
+  }
+
+  /** トップレベルの数値は finish() で確定する */
+  {
+    push_deserializer p;
+    p.feed("12");
+    p.feed("34");
+    assert(!p.completed());
+    valueValidation<int>(p.finish(), 1234, compare::same);
+  }
+
+  auto fn = [](bool bWillSuccess, const char* str){
+    try{
+      push_deserializer p;
+      p.feed(str);
+      p.finish();
+      assert(bWillSuccess);
+    }
+    catch(std::exception& ex){
+      std::cout << ex.what() << std::endl;
+      assert(!bWillSuccess);
+    }
+  };
+  fn(false, R"( 1234567890123456789012345678901234567890 )");
+  fn(false, R"( {,} )");
+  fn(false, R"( [{"",1}] )");
+  fn(false, R"( [1, 2 )");
+  fn(true , R"( {"a":1} 2 )");  /** deserializer と同じく最初の値の後は読み飛ばす */
+  fn(true , R"( [{},[],[[]]] // end )");
+
+  /** 同じ入力は分割の仕方によらず deserializer と同じく受理・拒否する */
+  const std::vector<std::string> inputs = {
+    "[1 2]", "[1,,2]", "[1,]", "[,1]", "[,]", "[]", "{}", "[[],{}]",
+    R"({"a":1,})", "{,}", R"({"a":1,,"b":2})", R"({"a" 1})", R"({"a":1 "b":2})", R"({"a":1,"a":2})", R"({"":1})",
+    "1 2", R"({"a":1} x)", "truex", "tru", "[nul]", "[true false]", "12x", "-", "[+1]", "[1-2]", "[.5]", "[1e]", "99999999999999999999", "1e999",
+    R"("a\qb")", R"("\ud800")", R"("\ud800A")", R"("\ud800\uzzzz")", R"("\udc00")", R"("😀")", R"("\u00e")",
+    "\"a\xC3(b\"", "\"\xE3\x81\"", "\"a\tb\"", "\"a\x01b\"", "\"abc",
+    "/* x", "1 /*", "[1 /* */ 2]", "// c\n 3", "/ 1", "", "  ", "[1, 2"
+  };
+  for(const auto policy : {utf8_policy::reject, utf8_policy::replace}){
+    for(const auto& input : inputs){
+      std::stringstream ss(input);
+      json pulled;
+      parse_error e;
+      const bool pull_ok = deserializer(ss).on_invalid_utf8(policy).try_execute(pulled, e);
+      for(std::size_t chunk : {std::size_t(1), std::size_t(2), std::max<std::size_t>(input.size(), 1)}){
+        push_deserializer p;
+        p.on_invalid_utf8(policy);
+        bool push_ok = true;
+        json pushed;
+        try{
+          for(std::size_t pos = 0; pos < input.size(); pos += chunk){
+            p.feed(input.data() + pos, std::min(chunk, input.size() - pos));
+          }
+          pushed = p.finish();
+        }
+        catch(const bad_json&){
+          push_ok = false;
+        }
+        if(push_ok != pull_ok) std::cout << "mismatch: " << input << std::endl;
+        assert(push_ok == pull_ok);
+        assert(!push_ok || pushed == pulled);
+      }
+    }
+  }
+}
+
+void test_021() {
+  /** RFC 8949 Appendix A のエンコード例 */
+  auto hex = [](const std::string& s){
+    std::stringstream ss;
+    for(auto c : s){
+      ss << std::hex << std::setw(2) << std::setfill('0') << (static_cast<int>(c) & 0xFF);
+    }
+    return ss.str();
+  };
+  assert(hex(cbor_serializer(json(0)).execute()) == "00");
+  assert(hex(cbor_serializer(json(23)).execute()) == "17");
+  assert(hex(cbor_serializer(json(24)).execute()) == "1818");
+  assert(hex(cbor_serializer(json(1000)).execute()) == "1903e8");
+  assert(hex(cbor_serializer(json(1000000000000ll)).execute()) == "1b000000e8d4a51000");
+  assert(hex(cbor_serializer(json(-1)).execute()) == "20");
+  assert(hex(cbor_serializer(json(-1000)).execute()) == "3903e7");
+  assert(hex(cbor_serializer(json(1.5)).execute()) == "fa3fc00000");
+  assert(hex(cbor_serializer(json(1.1)).execute()) == "fb3ff199999999999a");
+  assert(hex(cbor_serializer(json(false)).execute()) == "f4");
+  assert(hex(cbor_serializer(json(nullptr)).execute()) == "f6");
+  assert(hex(cbor_serializer(json("IETF")).execute()) == "6449455446");
+  assert(hex(cbor_serializer(json(array{1, 2, 3})).execute()) == "83010203");
+
+  json x = {
+    {"aaa", 1},
+    {"bbb", -1.25},
+    {"ccc", array{"abc", 1.234, true, nullptr}},
+    {"ddd", {
+      {"1", INT64_MIN},
+      {"2", "\u03A9"}
+    }}
+  };
+  auto bin = cbor_serializer(x).execute();
+  auto y = cbor_deserializer(bin).execute();
+  valueValidation<int>(y["aaa"], 1, compare::same);
+  valueValidation<double>(y["bbb"], -1.25, compare::same);
+  valueValidation<double>(y["ccc"][1], 1.234, compare::same);
+  valueValidation<bool>(y["ccc"][2], true, compare::same);
+  assert(y["ccc"][3].is_null());
+  valueValidation<int64_t>(y["ddd"]["1"], INT64_MIN, compare::same);
+  valueValidation<std::string>(y["ddd"]["2"], "\u03A9", compare::same);
+
+  /** 長さ不定・タグ・半精度浮動小数点 */
+  const std::string indefinite("\x9f\x01\x7f\x61\x61\x61\x62\xff\xc1\xf9\x3c\x00\xff", 13);
+  auto z = cbor_deserializer(indefinite).execute();
+  valueValidation<int>(z[0], 1, compare::same);
+  valueValidation<std::string>(z[1], "ab", compare::same);
+  valueValidation<double>(z[2], 1.0, compare::same);
+
+  auto fn = [](bool bWillSuccess, const std::string& bin){
+    try{
+      cbor_deserializer(bin).execute();
+      assert(bWillSuccess);
+    }
+    catch(std::exception& ex){
+      std::cout << ex.what() << std::endl;
+      assert(!bWillSuccess);
+    }
+  };
+  fn(false, std::string("\x83\x01\x02", 3));
+  fn(false, std::string("\x9b\xff\xff\xff\xff\xff\xff\xff\xff", 9));
+  fn(false, std::string("\xa1\x01\x02", 3));
+  fn(false, std::string("\x1b\xff\xff\xff\xff\xff\xff\xff\xff", 9));
+  fn(true , std::string("\xa1\x61\x61\x02", 4));
+
+  /** 整数・タグは長さ不定にできない */
+  fn(false, std::string("\x1f", 1));
+  fn(false, std::string("\x3f", 1));
+  fn(false, std::string("\xdf\x01", 2));
+
+  /** 入れ子の深さの上限 */
+  fn(false, std::string(100000, '\x81') + '\x01');
+  fn(false, std::string(100000, '\xc1') + '\x01');
+  fn(true , std::string(cbor_deserializer::default_max_depth, '\x81') + '\x01');
+  {
+    const auto nested = std::string(3, '\x81') + '\x01';
+    assert(serializer(cbor_deserializer(nested).max_depth(3).execute()).execute() == "[[[1]]]");
+    try{
+      cbor_deserializer(nested).max_depth(2).execute();
+      assert(false);
+    }
+    catch(bad_cbor&){}
+  }
+
+  /** キーが重複する場合は最初の値（deserializer と同じ） */
+  const auto dup = cbor_deserializer(std::string("\xa2\x61\x61\x01\x61\x61\x82\x02\x03", 9)).execute();
+  assert(dup == json({{"a", 1}}));
+}
+
+void test_022() {
+  auto hex = [](const std::string& s){
+    std::stringstream ss;
+    for(auto c : s){
+      ss << std::hex << std::setw(2) << std::setfill('0') << (static_cast<int>(c) & 0xFF);
+    }
+    return ss.str();
+  };
+  assert(hex(msgpack_serializer(json(127)).execute()) == "7f");
+  assert(hex(msgpack_serializer(json(128)).execute()) == "cc80");
+  assert(hex(msgpack_serializer(json(65536)).execute()) == "ce00010000");
+  assert(hex(msgpack_serializer(json(-32)).execute()) == "e0");
+  assert(hex(msgpack_serializer(json(-33)).execute()) == "d0df");
+  assert(hex(msgpack_serializer(json(-129)).execute()) == "d1ff7f");
+  assert(hex(msgpack_serializer(json(0.5)).execute()) == "ca3f000000");
+  assert(hex(msgpack_serializer(json(0.1)).execute()) == "cb3fb999999999999a");
+  assert(hex(msgpack_serializer(json("abc")).execute()) == "a3616263");
+  assert(hex(msgpack_serializer(json(std::string(32, 'x'))).execute().substr(0, 2)) == "d920");
+  assert(hex(msgpack_serializer(json(array{true, false, nullptr})).execute()) == "93c3c2c0");
+  assert(hex(msgpack_serializer(json({{"a", 1}})).execute()) == "81a16101");
+
+  json x = {
+    {"aaa", 1},
+    {"bbb", -1.25},
+    {"ccc", array{"abc", 1.234, true, nullptr, INT64_MAX, INT64_MIN, -200, 40000}},
+    {"ddd", {
+      {"1", std::string(70000, 'z')},
+      {"2", "\u03A9"}
+    }}
+  };
+  auto bin = msgpack_serializer(x).execute();
+  auto y = msgpack_deserializer(bin).execute();
+  valueValidation<int>(y["aaa"], 1, compare::same);
+  valueValidation<double>(y["bbb"], -1.25, compare::same);
+  valueValidation<double>(y["ccc"][1], 1.234, compare::same);
+  valueValidation<int64_t>(y["ccc"][4], INT64_MAX, compare::same);
+  valueValidation<int64_t>(y["ccc"][5], INT64_MIN, compare::same);
+  valueValidation<int>(y["ccc"][6], -200, compare::same);
+  valueValidation<int>(y["ccc"][7], 40000, compare::same);
+  assert(y["ddd"]["1"].get<std::string>().size() == 70000);
+  valueValidation<std::string>(y["ddd"]["2"], "\u03A9", compare::same);
+
+  /** 連続したメッセージを順に読み出す */
+  const std::string stream = bin + msgpack_serializer(json(5)).execute();
+  msgpack_deserializer md(stream);
+  md.execute();
+  valueValidation<int>(md.execute(), 5, compare::same);
+  assert(md.eof());
+
+  auto fn = [](bool bWillSuccess, const std::string& bin){
+    try{
+      msgpack_deserializer(bin).execute();
+      assert(bWillSuccess);
+    }
+    catch(std::exception& ex){
+      std::cout << ex.what() << std::endl;
+      assert(!bWillSuccess);
+    }
+  };
+  fn(false, std::string("\x93\x01\x02", 3));
+  fn(false, std::string("\xdd\xff\xff\xff\xff", 5));
+  fn(false, std::string("\x81\x01\x02", 3));
+  fn(false, std::string("\xd4\x01\x02", 3));
+  fn(true , std::string("\x81\xc4\x01\x61\x02", 5));
+
+  /** キーが重複する場合は最初の値（deserializer と同じ） */
+  const auto dup = msgpack_deserializer(std::string("\x82\xa1\x61\x01\xa1\x61\x92\x02\x03", 9)).execute();
+  assert(dup == json({{"a", 1}}));
+}
+
+void test_023() {
+  json x = {
+    {"aaa", 1},
+    {"bbb", -1.25},
+    {"ccc", array{"abc", 1.234, true, nullptr}},
+    {"ddd", {
+      {"1", INT64_MIN},
+      {"2", "\u03A9"},
+      {"3", json::object_type()}
+    }}
+  };
+  for(auto i = 0; i < 100; i++){
+    x["many"][std::to_string(i)] = i;
+  }
+  const std::string bin = snapshot_serializer(x).execute();
+
+  /** バッファを直接参照する（デシリアライズしない） */
+  auto root = snapshot_view::from(bin.data(), bin.size());
+  assert(root.value_type_id() == json::value_type_id::object);
+  valueValidation<int>(json(root["aaa"].get<int>()), 1, compare::same);
+  valueValidation<double>(json(root["bbb"].get<double>()), -1.25, compare::same);
+  assert(root["ccc"].size() == 4);
+  assert(std::string(root["ccc"][0].c_str()) == "abc");
+  assert(root["ccc"][2].get<bool>() == true);
+  assert(root["ccc"][3].is_null());
+  assert(root["ccc"][4].is_undefined());
+  assert(root["ddd"]["1"].get<int64_t>() == INT64_MIN);
+  assert(root["ddd"]["2"].get<std::string>() == "\u03A9");
+  assert(root["ddd"]["3"].size() == 0);
+  assert(root["zzz"].is_undefined());
+  for(auto i = 0; i < 100; i++){
+    assert(root["many"][std::to_string(i)].get<int>() == i);
+  }
+  assert(root["many"].key_at(0) == "0");
+  assert(root["many"].key_at(1) == "1");
+
+  try{
+    root["aaa"].get<std::string>();
+    assert(false);
+  }
+  catch(bad_cast& e){
+    std::cout << "ok: " << e.what() << std::endl;
+  }
+
+  /** json への実体化 */
+  auto y = root.to_json();
+  valueValidation<std::string>(path_util::find(y, "ccc")->get<json::array_type>()[0], "abc", compare::same);
+  valueValidation<int>(path_util::find(y, "many.99"), 99, compare::same);
+
+  /** 不正なバッファ */
+  auto fn = [](const std::string& bin){
+    try{
+      snapshot_view::from(bin.data(), bin.size());
+      assert(false);
+    }
+    catch(bad_snapshot& e){
+      std::cout << "ok: " << e.what() << std::endl;
+    }
+  };
+  fn(bin.substr(0, 16));
+  fn(bin.substr(0, bin.size() - 8));
+  fn(std::string(64, 'x'));
+
+  /** 要素の位置が 8 バイト境界に無い（不正な境界の読み出しをしない） */
+  for(const json& v : {json(array{1, 2, "padding"}), json({{"a", 1}, {"b", 2}})}){
+    std::string broken = snapshot_serializer(v).execute();
+    const auto payload_at = offsetof(snapshot_format::header, root) + offsetof(snapshot_format::slot, payload);
+    uint64_t payload;
+    std::memcpy(&payload, &broken[payload_at], sizeof(payload));
+    payload += 4;
+    std::memcpy(&broken[payload_at], &payload, sizeof(payload));
+    const auto view = snapshot_view::from(broken);
+    try{
+      view.value_at(0);
+      assert(false);
+    }
+    catch(bad_snapshot& e){
+      std::cout << "ok: " << e.what() << std::endl;
+    }
+  }
+}
+
+void test_024() {
+  std::stringstream ss(R"(
+    {
+      "order_id": 12345678901,
+      "paid": true,
+      "unknown": { "skip": [1, 2, {"x": null}] },
+      "items": [
+        { "name": "apple", "price": 1.5, "sizes": [1, 2, 3] },
+        { "name": "orange\tjuice", "price": 2, "sizes": [] }
+      ],
+      "counts": { "apple": 3, "orange": 1 }, // comment
+      "extra": { "any": [true] }
+    }
+  )");
+  test_order o;
+  o.memo = "default";
+  deserializer(ss).execute(o);
+  assert(o.id == 12345678901ll);
+  assert(o.paid == true);
+  assert(o.items.size() == 2);
+  assert(o.items[0].name == "apple");
+  assert(o.items[0].price == 1.5);
+  assert(o.items[0].sizes.size() == 3 && o.items[0].sizes[2] == 3);
+  assert(o.items[1].name == "orange\tjuice");
+  assert(o.items[1].price == 2.0);
+  assert(o.counts["apple"] == 3);
+  assert(o.memo == "default"); /** 省略可能なメンバは変更されない */
+  valueValidation<bool>(o.extra["any"][0], true, compare::same);
+
+  /** 構造体から直接シリアライズした結果を json として読み直す */
+  const auto s = serializer(o).execute();
+  std::cout << s << std::endl;
+  std::stringstream ss2(s);
+  auto j = deserializer(ss2).execute();
+  valueValidation<int64_t>(j["order_id"], 12345678901ll, compare::same);
+  valueValidation<std::string>(j["items"][1]["name"], "orange\tjuice", compare::same);
+  valueValidation<int>(j["items"][0]["sizes"][1], 2, compare::same);
+  valueValidation<int>(j["counts"]["orange"], 1, compare::same);
+  valueValidation<std::string>(j["memo"], "default", compare::same);
+  std::cout << serializer(o, "  ").execute() << std::endl;
+
+  /** コンテナのみでも直接変換できる */
+  std::vector<std::map<std::string, double>> v;
+  std::stringstream ss3(R"([{"a": 1.5}, {"b": 2}])");
+  deserializer(ss3).execute(v);
+  assert(v.size() == 2 && v[1]["b"] == 2.0);
+  assert(serializer(v).execute() == R"([{"a":1.5},{"b":2}])");
+
+  auto fn = [](bool bWillSuccess, const char* str){
+    try{
+      std::stringstream ss(str);
+      test_item item;
+      deserializer(ss).execute(item);
+      assert(bWillSuccess);
+    }
+    catch(std::exception& ex){
+      std::cout << ex.what() << std::endl;
+      assert(!bWillSuccess);
+    }
+  };
+  fn(true , R"( {"name": "a", "price": 1, "sizes": []} )");
+  fn(false, R"( {"name": "a", "price": 1} )");
+  fn(false, R"( {"name": 1, "price": 1, "sizes": []} )");
+  fn(false, R"( {"name": "a", "price": "1", "sizes": []} )");
+  fn(false, R"( ["name"] )");
+
+  /** 整数のフィールドは範囲と小数部を確認する（丸めない） */
+  auto bind = [](const char* str, test_limits& l){
+    std::stringstream ss(str);
+    parse_error e;
+    deserializer(ss).try_execute(l, e);
+    return e.code;
+  };
+  test_limits l;
+  assert(bind(R"({"i": -2147483648, "u": 18446744073709551615, "s": 127})", l) == parse_errc::none);
+  assert(l.i == INT32_MIN && l.u == UINT64_MAX && l.s == 127);
+  assert(serializer(l).execute() == R"({"i":-2147483648,"u":18446744073709551615,"s":127})");
+  std::stringstream round(serializer(l).execute());
+  test_limits l2;
+  deserializer(round).execute(l2);
+  assert(l2.i == l.i && l2.u == l.u && l2.s == l.s);
+  assert(bind(R"({"i": 1.0, "u": 1e2, "s": -0})", l) == parse_errc::none);
+  assert(l.i == 1 && l.u == 100 && l.s == 0);
+  assert(bind(R"({"i": 4294967297, "u": 0, "s": 0})", l) == parse_errc::invalid_number);
+  assert(bind(R"({"i": 2147483648, "u": 0, "s": 0})", l) == parse_errc::invalid_number);
+  assert(bind(R"({"i": 0, "u": -1, "s": 0})", l) == parse_errc::invalid_number);
+  assert(bind(R"({"i": 0, "u": 18446744073709551616, "s": 0})", l) == parse_errc::invalid_number);
+  assert(bind(R"({"i": 0, "u": 0, "s": 128})", l) == parse_errc::invalid_number);
+  assert(bind(R"({"i": 0, "u": 0, "s": -129})", l) == parse_errc::invalid_number);
+  assert(bind(R"({"i": 0, "u": 1.8446744073709552e19, "s": 0})", l) == parse_errc::invalid_number);
+  assert(bind(R"({"i": 1.9, "u": 0, "s": 0})", l) == parse_errc::type_mismatch);
+  assert(bind(R"({"i": 0, "u": 0.5, "s": 0})", l) == parse_errc::type_mismatch);
+}
+
+void test_025() {
+  std::stringstream sss(R"(
+    {
+      "type": "object",
+      "required": ["id", "items"],
+      "additionalProperties": false,
+      "properties": {
+        "id": { "type": "integer", "minimum": 1 },
+        "name": { "type": "string", "maxLength": 5, "pattern": "^[a-z]+$" },
+        "kind": { "enum": ["a", "b"] },
+        "items": {
+          "type": "array",
+          "maxItems": 3,
+          "items": { "$ref": "#/definitions/item" }
+        },
+        "meta": {
+          "type": "object",
+          "patternProperties": { "^x-": { "type": "boolean" } }
+        }
+      },
+      "definitions": {
+        "item": {
+          "type": "object",
+          "required": ["price"],
+          "properties": {
+            "price": { "type": "number", "exclusiveMinimum": 0 },
+            "tags": { "type": "array", "uniqueItems": true }
+          }
+        }
+      }
+    }
+  )");
+  const auto s = schema::compile(deserializer(sss).execute());
+
+  auto fn = [&](bool bWillSuccess, const char* str){
+    /** 既存の json の検証 */
+    std::stringstream ss1(str);
+    std::string reason;
+    const bool valid = s.validate(deserializer(ss1).execute(), &reason);
+    std::cout << (valid ? "valid" : reason) << std::endl;
+    assert(valid == bWillSuccess);
+
+    /** デシリアライズ中の検証 */
+    try{
+      std::stringstream ss2(str);
+      deserializer(ss2, s).execute();
+      assert(bWillSuccess);
+    }
+    catch(schema_violation& ex){
+      std::cout << ex.what() << std::endl;
+      assert(!bWillSuccess);
+    }
+  };
+  fn(true , R"({"id": 1, "name": "abc", "kind": "a", "items": [{"price": 1.5, "tags": [1, 2]}], "meta": {"x-a": true, "y": 1}})");
+  fn(true , R"({"id": 2.0, "items": []})");
+  fn(false, R"({"id": 1})");
+  fn(false, R"({"id": 0, "items": []})");
+  fn(false, R"({"id": 1.5, "items": []})");
+  fn(false, R"({"id": "1", "items": []})");
+  fn(false, R"({"id": 1, "items": [], "unknown": [1, 2, 3]})");
+  fn(false, R"({"id": 1, "items": [{}, {}, {}, {}]})");
+  fn(false, R"({"id": 1, "items": [{"price": 0}]})");
+  fn(false, R"({"id": 1, "items": [{"price": 1, "tags": [1, 1.0]}]})");
+  fn(false, R"({"id": 1, "items": [], "name": "abcdef"})");
+  fn(false, R"({"id": 1, "items": [], "name": "ABC"})");
+  fn(false, R"({"id": 1, "items": [], "kind": "c"})");
+  fn(false, R"({"id": 1, "items": [], "meta": {"x-a": 1}})");
+
+  /** 組み合わせ */
+  const auto s2 = schema::compile({
+    {"anyOf", array{ json{{"type", "string"}}, json{{"type", "integer"}} }},
+    {"not", {{"const", 3}}}
+  });
+  assert(s2.validate("abc"));
+  assert(s2.validate(1));
+  assert(!s2.validate(3));
+  assert(!s2.validate(1.5));
+
+  try{
+    schema::compile({{"type", "unknown"}});
+    assert(false);
+  }
+  catch(bad_schema& e){
+    std::cout << "ok: " << e.what() << std::endl;
+  }
+}
+
+void test_026() {
+  json x = array::util::create([](auto& arr){
+    for(auto i = 0; i < 1000; i++){
+      arr.push_back({
+        {"id", i},
+        {"value", i * 0.1},
+        {"name", "item\t" + std::to_string(i)},
+        {"tags", array{true, nullptr, "x"}}
+      });
+    }
+  });
+  x[1000] = object::util::create([](auto& obj){
+    for(auto i = 0; i < 100; i++){
+      obj[std::to_string(i)] = array{i, array{}, json::object_type()};
+    }
+  });
+  json y = {{"big", x}, {"small", 1}};
+
+  for(const auto& indent : {std::string(""), std::string("  ")}){
+    for(const json* j : {&x, &y}){
+      const serializer se(*j, indent);
+      const auto expected = se.execute();
+      assert(se.execute_parallel(4, 7) == expected);
+      assert(se.execute_parallel(0) == expected);
+
+      /** os の書式設定も引き継ぐ */
+      std::stringstream ss1, ss2;
+      ss1.precision(17);
+      ss2.precision(17);
+      se.execute(ss1);
+      se.execute_parallel(ss2, 3, 16);
+      assert(ss1.str() == ss2.str());
+
+      /** executor の指定（その場で実行する） */
+      std::stringstream ss3;
+      se.execute_parallel(ss3, [](std::function<void()> task){ task(); }, 5);
+      assert(ss3.str() == expected);
+    }
+  }
+
+  /** 制御文字のエスケープは os の書式を変更しない（以降の数値が 16 進数にならない） */
+  {
+    json c = array::util::create([](auto& arr){
+      for(auto i = 0; i < 50; i++){
+        arr.push_back(std::string("\x01"));
+        arr.push_back(17);
+      }
+    });
+    const serializer se(c);
+    const auto expected = se.execute();
+    assert(expected.substr(0, 13) == "[\"\\u0001\",17,");
+    std::stringstream ss;
+    se.execute(ss);
+    ss << 17;
+    assert(ss.str() == expected + "17");
+    assert(se.execute_parallel(3, 7) == expected);
+  }
+  std::cout << "ok: parallel serialization matches" << std::endl;
+
+  /**
+   * 断片の出力やタスクの投入が例外を送出しても、投入済みのタスクが全て終了してから送出する。
+   * 断片は os の書式（ロケール・例外マスク）を引き継ぐため、特定の整数で送出する num_put で１つの断片のみ失敗させ、
+   * 出力した整数の数で execute_parallel() から戻った後にタスクが動作していないことを確認する。
+   **/
+  struct counting_num_put : std::num_put<char> {
+    std::atomic<int>* written;
+    explicit counting_num_put(std::atomic<int>* w) : written(w) {}
+    iter_type do_put(iter_type out, std::ios_base& str, char_type fill, long v) const override {
+      if(v == 4242) throw std::runtime_error("num_put");
+      (*written)++;
+      return std::num_put<char>::do_put(out, str, fill, v);
+    }
+    iter_type do_put(iter_type out, std::ios_base& str, char_type fill, long long v) const override {
+      if(v == 4242) throw std::runtime_error("num_put");
+      (*written)++;
+      return std::num_put<char>::do_put(out, str, fill, v);
+    }
+  };
+  json failing = array::util::create([](auto& arr){
+    arr.push_back(4242);
+    for(auto i = 0; i < 200; i++) arr.push_back(i);
+  });
+  const serializer fs(failing);
+  /** 最初のタスクはすぐに、以降のタスクは遅れて実行する。fail_at 回目の投入で送出する */
+  auto run = [&](int fail_at){
+    std::atomic<int> written(0);
+    std::vector<std::thread> threads;
+    int submitted = 0;
+    std::stringstream ss;
+    ss.imbue(std::locale(ss.getloc(), new counting_num_put(&written)));
+    ss << 0;  /** ロケールのキャッシュを事前に生成する */
+    ss.str("");
+    written = 0;
+    ss.exceptions(std::ios::badbit);
+    std::string what;
+    try{
+      fs.execute_parallel(ss, [&](std::function<void()> task){
+        if(submitted == fail_at) throw std::runtime_error("executor");
+        const auto delay = std::chrono::milliseconds(submitted++ == 0 ? 0 : 50);
+        threads.emplace_back([task, delay](){
+          std::this_thread::sleep_for(delay);
+          task();
+        });
+      }, 16);
+    }
+    catch(const std::runtime_error& e){
+      what = e.what();
+    }
+    const int at_return = written;
+    for(auto& t : threads) t.join();
+    assert(written == at_return);
+    return std::make_pair(what, submitted);
+  };
+  const auto chunk_failed = run(-1);
+  assert(chunk_failed.first == "num_put" && chunk_failed.second > 2);
+  const auto submit_failed = run(3);
+  assert(submit_failed.first == "executor" && submit_failed.second == 3);
+  std::cout << "ok: parallel serialization waits for all tasks on failure" << std::endl;
+}
+
+void test_027() {
+  const std::string long_text(100, 'x');
+  json x = {
+    {"a", array{1, 2.5, true, nullptr, "s"}},
+    {"b", {{"c", long_text}}},
+    {std::string(40, 'k'), 0}
+  };
+  const auto m = memory_inspector(x).execute();
+
+  assert(m.nodes == 10);
+  assert(m.count(json::value_type_id::object) == 2);
+  assert(m.count(json::value_type_id::array) == 1);
+  assert(m.count(json::value_type_id::string) == 2);
+  assert(m.count(json::value_type_id::integral) == 2);
+  assert(m.max_depth == 2);
+  assert(m.largest_array == 5);
+  assert(m.largest_object == 3);
+  assert(m.largest_string == 100);
+
+  /** 内訳の合計は total と一致する */
+  memory_usage::usage by_type, by_kind;
+  for(const auto& u : m.by_type) by_type += u;
+  by_kind += m.holders;
+  by_kind += m.string_payload;
+  by_kind += m.key_payload;
+  by_kind += m.container_overhead;
+  assert(by_type.bytes == m.total.bytes && by_type.allocations == m.total.allocations);
+  assert(by_kind.bytes == m.total.bytes && by_kind.allocations == m.total.allocations);
+
+  /** 文字列・キーの領域 */
+  assert(m.string_payload.allocations == 1);
+  assert(m.string_payload.bytes >= 101);
+  assert(m.key_payload.allocations == 1);
+  assert(m.key_payload.bytes >= 41);
+  assert(m.of(json::value_type_id::integral).bytes == 0);
+
+  /** array の未使用領域 */
+  json arr = json::array_type();
+  arr.get<json::array_type>().reserve(10);
+  arr.get<json::array_type>().push_back(1);
+  const auto ma = memory_inspector(arr).execute();
+  assert(ma.array_slack_bytes == 9 * sizeof(json));
+  assert(ma.container_overhead.bytes == 10 * sizeof(json));
+
+  /** スカラーはヒープを使用しない */
+  assert(memory_inspector(json(1)).execute().total.bytes == 0);
+  assert(memory_inspector(json()).execute().nodes == 1);
+
+  std::cout << serializer(m.to_json()["total"]).execute() << std::endl;
+  std::cout << "ok: memory usage" << std::endl;
+}
+
+void test_028() {
+  const std::string text =
+    "/* c */ {\n"
+    "  \"a\": [1, 2.5, true, false, null], // x\n"
+    "  \"b\": {\"c\": \"str\"}\n"
+    "}";
+
+  parse_stats stats;
+  std::stringstream ss(text);
+  json j = deserializer(ss).instrument(stats).execute();
+  assert(j["b"]["c"].get<std::string>() == "str");
+
+  assert(stats.bytes == text.size());
+  assert(stats.objects == 2);
+  assert(stats.arrays == 1);
+  assert(stats.keys == 3);
+  assert(stats.strings == 1);
+  assert(stats.integers == 1);
+  assert(stats.floats == 1);
+  assert(stats.trues == 1 && stats.falses == 1 && stats.nulls == 1);
+  assert(stats.comment_bytes == std::string("/* c */").size() + std::string("// x\n").size());
+  assert(stats.string_bytes == 3 * 3 + 5);
+  assert(stats.number_bytes == 4);
+  assert(stats.max_depth == 2);
+  assert(stats.allocations > 0);
+
+  /** 各種類のバイト数と構文記号の合計は全体と一致する */
+  const std::size_t punctuation = std::string("{:[,,,,],:{:}}").size();
+  const std::size_t literals = std::string("truefalsenull").size();
+  assert(stats.whitespace_bytes + stats.comment_bytes + stats.string_bytes + stats.number_bytes + punctuation + literals == stats.bytes);
+
+  /** コールバックでの取得（構造体バインディングでも集計する） */
+  std::size_t called = 0;
+  std::stringstream ss2(R"({"x": [1, 2.5], "y": []})");
+  std::map<std::string, std::vector<double>> bound;
+  deserializer(ss2).instrument([&](const parse_stats& s){
+    called++;
+    assert(s.objects == 1 && s.arrays == 2 && s.keys == 2);
+    assert(s.floats == 1 && s.integers == 1);
+    assert(s.max_depth == 2);
+  }).execute(bound);
+  assert(called == 1);
+  assert(bound["x"][1] == 2.5);
+
+  std::cout << serializer(stats.to_json()).execute() << std::endl;
+  std::cout << "ok: parse stats" << std::endl;
+}
+
+void test_029() {
+  const std::string status = "status-value-longer-than-sso";
+  json doc = array::util::create([&](auto& arr){
+    for(auto i = 0; i < 100; i++){
+      arr.push_back({
+        {"status", status},
+        {"point", array{1, 2.5}},
+        {"meta", {{"kind", "a"}, {"flag", true}}}
+      });
+    }
+  });
+  const auto expected = serializer(doc).execute();
+
+  /** 非 const で取得すると複製されるため、const で領域のアドレスを比較する */
+  auto same = [](const json& x, const json& y){
+    return x.value_type_id() == y.value_type_id() && (
+      x.value_type_id() == json::value_type_id::object ? &x.get<json::object_type>() == &y.get<json::object_type>() :
+      x.value_type_id() == json::value_type_id::array  ? &x.get<json::array_type>() == &y.get<json::array_type>() :
+      &x.get<std::string>() == &y.get<std::string>()
+    );
+  };
+  const auto before = memory_inspector(doc).execute();
+
+  dedup_pool pool;
+  pool.execute(doc);
+  assert(serializer(doc).execute() == expected);
+  assert(pool.hits() > 0);
+
+  /** 全ての要素が１つの object を共有する */
+  const json& cdoc = doc;
+  assert(cdoc[0].get<json::object_type>().size() == 3);
+  assert(same(cdoc[0], cdoc[99]));
+
+  const auto after = memory_inspector(doc).execute();
+  assert(after.total.bytes * 10 < before.total.bytes);
+  assert(after.shared_references == 99);
+
+  /** 共有された値の変更は他に影響しない（copy-on-write） */
+  doc[5]["status"] = "changed";
+  doc[6]["point"][0] = 100;
+  assert(cdoc[5]["status"].get<std::string>() == "changed");
+  assert(cdoc[4]["status"].get<std::string>() == status);
+  assert(cdoc[6]["point"][0].get<int>() == 100);
+  assert(cdoc[7]["point"][0].get<int>() == 1);
+  assert(same(cdoc[4], cdoc[7]));
+  assert(!same(cdoc[4], cdoc[5]));
+  assert(same(cdoc[4]["meta"], cdoc[5]["meta"]));
+
+  /** キーの順序は区別しない */
+  json a = {{"x", 1}, {"y", array{1, 2}}};
+  json b = json::object_type();
+  b["y"] = array{1, 2};
+  b["x"] = 1;
+  pool.execute(a);
+  pool.execute(b);
+  assert(same(a, b));
+
+  /** 整数と浮動小数点は区別する */
+  json c = array{1, 1.0};
+  json d = array{1.0, 1};
+  pool.execute(c);
+  pool.execute(d);
+  assert(!same(c, d));
+
+  /** デシリアライズしながら共有する */
+  dedup_pool pool2;
+  std::stringstream ss(expected);
+  json parsed = deserializer(ss).dedup(pool2).execute();
+  std::stringstream ss2(expected);
+  assert(serializer(parsed).execute() == serializer(deserializer(ss2).execute()).execute());
+  const json& cparsed = parsed;
+  assert(same(cparsed[0], cparsed[50]));
+
+  /** プールを破棄しても値は有効 */
+  {
+    dedup_pool pool3;
+    json e = array{status, status};
+    pool3.execute(e);
+    pool3.clear();
+    json f = e;
+    assert(f[1].get<std::string>() == status);
+  }
+
+  std::cout << "bytes: " << before.total.bytes << " -> " << after.total.bytes << std::endl;
+  std::cout << "ok: dedup" << std::endl;
+}
+
+void test_030() {
+  /** diff を適用すると一致する */
+  auto check = [](const json& a, const json& b){
+    const auto patch = json_patch::diff(a, b);
+    json x = a.clone();
+    json_patch::apply(x, patch);
+    assert(serializer(x).execute() == serializer(b).execute() || json_patch::diff(x, b).get<json::array_type>().empty());
+    return patch;
+  };
+
+  json a = {
+    {"name", "cppjson"},
+    {"tags", array{"a", "b", "c", "d"}},
+    {"nested", {{"x", 1}, {"y", array{1, 2, 3}}}},
+    {"removed", true}
+  };
+  json b = {
+    {"name", "cppjson"},
+    {"tags", array{"a", "x", "c", "d", "e"}},
+    {"nested", {{"x", 1.0}, {"y", array{1, 3}}}},
+    {"added", nullptr}
+  };
+  const auto patch = check(a, b);
+  std::cout << serializer(patch).execute() << std::endl;
+  /** 1 と 1.0 は等しい。"b" -> "x" は置き換え、2 は削除、"e" は追加 */
+  assert(patch.get<json::array_type>().size() == 5);
+
+  /** 同一であれば空 */
+  assert(json_patch::diff(a, a.clone()).get<json::array_type>().empty());
+
+  /** 等しい部分木は読み飛ばし、異なる葉のみ置き換える */
+  {
+    json big = array::util::create([](auto& arr){
+      for(auto i = 0; i < 200; i++){
+        arr.push_back({{"id", i}, {"values", array{i, i + 1, "x"}}, {"child", {{"n", i * 0.5}}}});
+      }
+    });
+    json changed = big.clone();
+    changed[120]["child"]["n"] = "changed";
+    const auto p = check(big, changed).get<json::array_type>();
+    assert(p.size() == 1);
+    assert(p[0]["op"].get<std::string>() == "replace" && p[0]["path"].get<std::string>() == "/120/child/n");
+    /** diff は a と b のハッシュ値のキャッシュに書き込まない（取得済みの参照を介した変更後もハッシュ値が正しい） */
+    json& leaf = big[3]["child"];
+    json_patch::diff(big, changed);
+    leaf = "edited";
+    json edited = changed.clone();
+    edited[120]["child"]["n"] = 60.0;
+    edited[3]["child"] = "edited";
+    assert(big == edited && big.hash() == edited.hash());
+    /** 1 と 1.0 はハッシュ値も値も等しい */
+    assert(json_patch::diff(array{1, 2.0}, array{1.0, 2}).get<json::array_type>().empty());
+  }
+
+  /** array の挿入・削除は LCS で最小限の操作になる */
+  json arr1 = array{1, 2, 3, 4, 5, 6, 7, 8};
+  json arr2 = array{0, 1, 2, 4, 5, 6, 8, 9};
+  const auto patch2 = check(arr1, arr2);
+  assert(patch2.get<json::array_type>().size() == 4);
+  check(array{}, array{1, 2});
+  check(array{1, 2}, array{});
+  check(array{array{1, 2}, 3}, array{3, array{1, 2}});
+  check(1, "x");
+  check(json::object_type(), {{"a/b", {{"~c", 1}}}});
+
+  /** RFC 6902 の操作 */
+  json doc = {{"foo", array{"bar", "baz"}}, {"q", {{"r", 1}}}};
+  std::stringstream ss(R"([
+    {"op": "add", "path": "/foo/1", "value": "qux"},
+    {"op": "add", "path": "/foo/-", "value": "end"},
+    {"op": "test", "path": "/foo/0", "value": "bar"},
+    {"op": "move", "from": "/q/r", "path": "/moved"},
+    {"op": "copy", "from": "/foo", "path": "/copied"},
+    {"op": "replace", "path": "/copied/0", "value": 10},
+    {"op": "remove", "path": "/foo/2"},
+    {"op": "test", "path": "/moved", "value": 1.0}
+  ])");
+  json_patch::apply(doc, deserializer(ss).execute());
+  assert(serializer(doc["foo"]).execute() == R"(["bar","qux","end"])");
+  assert(serializer(doc["copied"]).execute() == R"([10,"qux","baz","end"])");
+  assert(doc["moved"].get<int>() == 1);
+  assert(doc["q"].get<json::object_type>().empty());
+
+  /** 失敗した場合は元に戻す */
+  const auto before = serializer(doc).execute();
+  std::stringstream ss2(R"([
+    {"op": "remove", "path": "/foo/0"},
+    {"op": "move", "from": "/copied", "path": "/q/moved"},
+    {"op": "replace", "path": "/moved", "value": 2},
+    {"op": "add", "path": "/foo/-", "value": 1},
+    {"op": "test", "path": "/moved", "value": 3}
+  ])");
+  try{
+    json_patch::apply(doc, deserializer(ss2).execute());
+    assert(false);
+  }
+  catch(const bad_patch& e){
+    std::cout << e.what() << std::endl;
+  }
+  assert(serializer(doc).execute() == before);
+
+  for(const auto& bad : {
+    R"([{"op": "remove", "path": "/missing"}])",
+    R"([{"op": "add", "path": "/foo/10", "value": 1}])",
+    R"([{"op": "add", "path": "/foo/01", "value": 1}])",
+    R"([{"op": "move", "from": "/q", "path": "/q/x"}])",
+    R"([{"op": "unknown", "path": ""}])",
+    R"([{"op": "add", "path": "/x"}])"
+  }){
+    std::stringstream bs(bad);
+    try{
+      json_patch::apply(doc, deserializer(bs).execute());
+      assert(false);
+    }
+    catch(const bad_patch& e){
+      std::cout << e.what() << std::endl;
+    }
+  }
+  assert(serializer(doc).execute() == before);
+
+  std::cout << "ok: json patch" << std::endl;
+}
+
+void test_031() {
+  json a = {
+    {"int", 1},
+    {"float", 2.0},
+    {"arr", array{1, "x", nullptr, array{true}}},
+    {"obj", {{"k", "v"}}}
+  };
+  json b = json::object_type();
+  b["obj"] = {{"k", "v"}};
+  b["arr"] = array{1.0, "x", nullptr, array{true}};
+  b["float"] = 2;
+  b["int"] = 1.0;
+
+  /** 数値は値で比較し、キーの順序は区別しない */
+  assert(a == b);
+  assert(a.hash() == b.hash());
+  assert(std::hash<json>()(a) == std::hash<json>()(b));
+  assert(json(1) == json(1.0));
+  assert(json(1) != json(1.5));
+  assert(json(1) != json("1"));
+  assert(json(nullptr) != json());
+  assert(json(-0.0) == json(0));
+  /** int64_t は double に丸めずに比較する */
+  assert(json(int64_t(9007199254740993ll)) != json(9007199254740992.0));
+  assert(json(int64_t(9007199254740992ll)) == json(9007199254740992.0));
+
+  b["arr"][3][0] = false;
+  assert(a != b);
+
+  /** キャッシュしたハッシュ値は変更で破棄される */
+  json c = a.clone();
+  const auto h = c.hash(true);
+  assert(c.hash() == h);
+  c["obj"]["k"] = "changed";
+  assert(c.hash() != h);
+  assert(c != a);
+  c["obj"]["k"] = "v";
+  assert(c.hash(true) == h);
+  assert(c == a);
+
+  /** 取得済みの参照を介して変更し、親のハッシュ値のキャッシュが古くなっても比較は正しい */
+  {
+    json x = {{"x", 1}, {"y", 2}};
+    json y = {{"x", 3}, {"y", 2}};
+    json& xx = x["x"];
+    json& yx = y["x"];
+    x.hash(true);
+    y.hash(true);
+    xx = 5;
+    yx = 5;
+    assert(x == y);
+  }
+
+  /** 共有されている値は中身を比較しない */
+  dedup_pool pool;
+  json d = a.clone();
+  json e = a.clone();
+  pool.execute(d);
+  pool.execute(e);
+  assert(d == e);
+
+  /** unordered_map のキーとして使用する */
+  std::unordered_map<json, int> cache;
+  cache[a] = 1;
+  cache[json(array{1, 2})] = 2;
+  assert(cache.count(b) == 0);
+  assert(cache[json(array{1.0, 2.0})] == 2);
+  assert(cache.at(a.clone()) == 1);
+
+  std::cout << "ok: equality and hash" << std::endl;
+}
+
+void test_032() {
+  auto parse = [](const std::string& s){
+    std::stringstream ss(s);
+    return deserializer(ss).execute();
+  };
+  /** キーの順序に依存しない */
+  const json a = {{"b", 1}, {"a", array{true, nullptr, "x"}}, {"c", {{"z", 1.5}, {"y", 2}}}};
+  json b = json::object_type();
+  b["c"] = {{"y", 2}, {"z", 1.5}};
+  b["a"] = array{true, nullptr, "x"};
+  b["b"] = 1;
+  const auto sa = serializer(a, "  ").canonical().execute();
+  assert(sa == R"({"a":[true,null,"x"],"b":1,"c":{"y":2,"z":1.5}})");
+  assert(serializer(b).canonical().execute() == sa);
+  assert(serializer(parse(sa)).canonical().execute() == sa);
+  std::cout << "ok: canonical key order" << std::endl;
+
+  /** キーは UTF-16 のコード単位の順（RFC 8785 3.2.3 の例） */
+  {
+    json j = json::object_type();
+    j["€"] = "Euro Sign";
+    j["\r"] = "Carriage Return";
+    j["\xef\xac\xb3"] = "Hebrew Letter Dalet With Dagesh";
+    j["1"] = "One";
+    j["\xf0\x9f\x98\x80"] = "Emoji: Grinning Face";
+    j["\xc2\x80"] = "Control";
+    j["\xc3\xb6"] = "Latin Small Letter O With Diaeresis";
+    const auto s = serializer(j).canonical().execute();
+    std::vector<std::string> order = {"\\r", "1", "\xc2\x80", "\xc3\xb6", "€", "\xf0\x9f\x98\x80", "\xef\xac\xb3"};
+    std::size_t pos = 0;
+    for(const auto& k : order){
+      const auto found = s.find("\"" + k + "\":", pos);
+      assert(found != std::string::npos);
+      pos = found;
+    }
+  }
+  std::cout << "ok: canonical utf-16 key order" << std::endl;
+
+  /** 数値の書式（ECMAScript と同一） */
+  auto num = [](const json& j){ return serializer(j).canonical().execute(); };
+  assert(num(0.0) == "0");
+  assert(num(-0.0) == "0");
+  assert(num(1.0) == "1");
+  assert(num(-1.5) == "-1.5");
+  assert(num(0.1) == "0.1");
+  assert(num(1e21) == "1e+21");
+  assert(num(1e20) == "100000000000000000000");
+  assert(num(123456789012345680000.0) == "123456789012345680000");
+  assert(num(1e-6) == "0.000001");
+  assert(num(1e-7) == "1e-7");
+  assert(num(5e-324) == "5e-324");
+  assert(num(1.7976931348623157e308) == "1.7976931348623157e+308");
+  assert(num(0.30000000000000004) == "0.30000000000000004");
+  assert(num(4.5e15) == "4500000000000000");
+  assert(num(333333333.33333329) == "333333333.3333333");
+  assert(num(std::numeric_limits<double>::infinity()) == "null");
+  assert(num(std::nan("")) == "null");
+  assert(num(static_cast<int64_t>(9007199254740993ll)) == "9007199254740993");
+
+  /** os のロケール（小数点・桁区切り）に依存しない */
+  {
+    struct comma_numpunct : std::numpunct<char> {
+      char do_decimal_point() const override { return ','; }
+      char do_thousands_sep() const override { return '.'; }
+      std::string do_grouping() const override { return "\1"; }
+    };
+    const json j = array{1234567, 1.5, 1e100};
+    std::stringstream ss;
+    ss.imbue(std::locale(ss.getloc(), new comma_numpunct));
+    serializer(j).canonical().execute(ss);
+    assert(ss.str() == "[1234567,1.5,1e+100]");
+    /** 構造体のメンバも同じ */
+    std::stringstream ss2;
+    ss2.imbue(ss.getloc());
+    const test_limits l{-1234567, 18446744073709551615ull, -100};
+    serializer(l).canonical().execute(ss2);
+    assert(ss2.str() == R"({"i":-1234567,"s":-100,"u":18446744073709551615})");
+  }
+  std::cout << "ok: canonical numbers" << std::endl;
+
+  /** エスケープ（'/' と非 ASCII はそのまま出力する） */
+  assert(num(std::string("a/b\"\\\b\f\n\r\t\x01\x1f\xe3\x81\x82")) == "\"a/b\\\"\\\\\\b\\f\\n\\r\\t\\u0001\\u001f\xe3\x81\x82\"");
+  std::cout << "ok: canonical escape" << std::endl;
+
+  /** 構造体・map・並列 */
+  {
+    test_order o;
+    o.id = 1;
+    o.paid = true;
+    o.items.push_back({"pen", 0.5, {2, 1}});
+    o.counts = {{"x", 1}};
+    const auto s = serializer(o, "  ").canonical().execute();
+    assert(s == R"({"counts":{"x":1},"extra":null,"items":[{"name":"pen","price":0.5,"sizes":[2,1]}],"memo":"","order_id":1,"paid":true})");
+    assert(serializer(parse(s)).canonical().execute() == s);
+
+    json big = json::object_type();
+    for(int i = 0; i < 1000; i++){
+      big[std::to_string(i)] = array{i * 0.25, std::to_string(i)};
+    }
+    serializer se(big);
+    se.canonical();
+    const auto expected = se.execute();
+    assert(expected.compare(0, 10, R"({"0":[0,"0)") == 0);
+    assert(se.execute_parallel(4, 7) == expected);
+    assert(se.execute_parallel(0) == expected);
+  }
+  std::cout << "ok: canonical binding and parallel" << std::endl;
+}
+
+void test_033() {
+  /** 読み出し側は常に一貫した json を参照する */
+  auto make = [](int64_t n){
+    json j = {{"version", n}, {"values", array{n, n, n}}};
+    j["name"] = std::string(64, 'a') + std::to_string(n); /** SSO に収まらない文字列 */
+    return j;
+  };
+  shared_document doc(make(0));
+  assert((*doc.read())["version"].get<int64_t>() == 0);
+
+  std::atomic<bool> done(false);
+  std::atomic<std::size_t> reads(0);
+  std::vector<std::thread> readers;
+  for(int t = 0; t < 4; t++){
+    readers.emplace_back([&](){
+      int64_t last = 0;
+      while(!done.load()){
+        auto r = doc.read();
+        const auto n = (*r)["version"].get<int64_t>();
+        assert(n >= last);
+        for(const auto& v : (*r)["values"].get<json::array_type>()){
+          assert(v.get<int64_t>() == n);
+        }
+        assert((*r)["name"].get<std::string>() == std::string(64, 'a') + std::to_string(n));
+        last = n;
+        reads++;
+      }
+    });
+  }
+  for(int64_t n = 1; n <= 200; n++){
+    doc.publish(make(n));
+  }
+  while(reads.load() < 1000){
+    std::this_thread::yield();
+  }
+  done = true;
+  for(auto& t : readers){
+    t.join();
+  }
+  assert(doc.version() == 200);
+  assert(doc.read([](const json& j){ return j["version"].get<int64_t>(); }) == 200);
+  std::cout << "ok: shared_document concurrent readers" << std::endl;
+
+  /** 複製して更新する */
+  json next = doc.snapshot();
+  next["version"] = 201;
+  doc.publish(next);
+  assert(next["version"].get<int64_t>() == 201);
+  assert(doc.read([](const json& j){ return j["version"].get<int64_t>(); }) == 201);
+  {
+    auto r1 = doc.read();
+    auto r2 = std::move(r1);
+    assert((*r2)["values"].get<json::array_type>().size() == 3);
+  }
+  std::cout << "ok: shared_document snapshot and publish" << std::endl;
+}
+
+void test_034() {
+  auto try_parse = [](const std::string& s, json& j){
+    std::stringstream ss(s);
+    return deserializer(ss).try_execute(j);
+  };
+  /** 例外を送出せずにエラーの種類と位置を返却する */
+  {
+    json j;
+    auto err = try_parse(R"({"a": [1, 2,]})", j);
+    assert(!err && err.ok());
+    assert(j["a"].get<json::array_type>().size() == 2);
+
+    const std::vector<std::pair<std::string, parse_errc>> cases = {
+      {R"({"a": [1, 2)", parse_errc::unexpected_eof},
+      {R"({"a" 1})", parse_errc::syntax_error},
+      {R"({"": 1})", parse_errc::empty_key},
+      {R"(["\q"])", parse_errc::invalid_escape},
+      {R"(["\u12G4"])", parse_errc::invalid_unicode},
+      {"[\"a\tb\"]", parse_errc::control_character},
+      {"[1234567890123456789012345678901234567890]", parse_errc::invalid_number},
+      {"[1e99999]", parse_errc::invalid_number},
+      {"[tru]", parse_errc::syntax_error},
+      {"", parse_errc::unexpected_eof}
+    };
+    for(const auto& c : cases){
+      json k;
+      const auto e = try_parse(c.first, k);
+      assert(e && e.code == c.second);
+      /** メッセージは execute() が送出する例外と同一 */
+      try{
+        std::stringstream ss(c.first);
+        deserializer(ss).execute();
+        assert(false);
+      }
+      catch(bad_json& ex){
+        assert(e.message() == ex.what());
+      }
+    }
+    std::cout << "ok: try_execute error codes" << std::endl;
+  }
+
+  /** 位置 */
+  {
+    json j;
+    const auto e = try_parse("{\n  \"a\": 1,\n  \"b\": x\n}", j);
+    assert(e.code == parse_errc::syntax_error);
+    assert(e.line == 3 && e.col == 8 && e.offset == 19);
+    assert(e.message() == "line(3), col(8) : syntax error");
+  }
+  std::cout << "ok: try_execute position" << std::endl;
+
+  /** 構造体とスキーマ */
+  {
+    std::stringstream ss(R"({"order_id": 1, "paid": true, "items": []})");
+    test_order o;
+    deserializer d(ss);
+    parse_error e;
+    assert(!d.try_execute(o, e));
+    assert(e.code == parse_errc::missing_key && e.detail == "counts");
+
+    std::stringstream ss2(R"({"order_id": "1"})");
+    assert(deserializer(ss2).try_execute(o).code == parse_errc::type_mismatch);
+
+    const auto s = schema::compile({{"type", "object"}, {"properties", {{"n", {{"type", "integer"}}}}}});
+    std::stringstream ss3(R"({"n": "x"})");
+    json j;
+    const auto v = deserializer(ss3, s).try_execute(j);
+    assert(v.code == parse_errc::schema_violation);
+    try{
+      std::stringstream ss4(R"({"n": "x"})");
+      deserializer(ss4, s).execute();
+      assert(false);
+    }
+    catch(schema_violation& ex){
+      assert(v.message() == ex.what());
+    }
+  }
+  std::cout << "ok: try_execute binding and schema" << std::endl;
+}
+
+void test_035() {
+  /** validate() と try_execute() は常に同じ結果となる */
+  const std::vector<std::string> inputs = {
+    R"({"a": [1, 2.5, -3e2, true, false, null], "b": {"c": "d\nあ"}})",
+    "/* comment */ [1, // line\n 2]",
+    "{\"\xe3\x81\x82\": \"\xf0\x9f\x98\x80\"}",
+    R"({"a": [1, 2)",
+    R"({"a" 1})",
+    R"({"": 1})",
+    R"(["\q"])",
+    R"(["\u12G4"])",
+    "[\"a\tb\"]",
+    "[1234567890123456789012345678901234567890]",
+    "[1e99999]",
+    "[" + std::string(100, '1') + ".5]",
+    "[tru]",
+    "[\"\xc3\"]",         /** 途中で終わる */
+    "[\"\xc0\xaf\"]",     /** 冗長な表現 */
+    "[\"\xed\xa0\x80\"]", /** サロゲート */
+    "[\"\xf4\x90\x80\x80\"]", /** U+10FFFF を超える */
+    "[\"\xff\"]",
+    ""
+  };
+  for(const auto& s : inputs){
+    std::stringstream ss1(s), ss2(s);
+    json j;
+    const auto e1 = deserializer(ss1).validate();
+    const auto e2 = deserializer(ss2).try_execute(j);
+    assert(e1.code == e2.code && e1.offset == e2.offset && e1.message() == e2.message());
+  }
+  {
+    std::stringstream ss("[\"\xc0\xaf\"]");
+    assert(deserializer(ss).validate().code == parse_errc::invalid_utf8);
+  }
+  std::cout << "ok: validate agrees with try_execute" << std::endl;
+
+  /** 計測と組み合わせる（値を生成しないため allocations は 0） */
+  {
+    std::stringstream ss(R"({"a": [1, "x", {"b": null}]})");
+    parse_stats stats;
+    parse_error e;
+    assert(deserializer(ss).instrument(stats).validate(e));
+    assert(stats.objects == 2 && stats.arrays == 1 && stats.keys == 2 && stats.strings == 1 && stats.integers == 1 && stats.nulls == 1);
+    assert(stats.allocations == 0);
+  }
+  std::cout << "ok: validate with stats" << std::endl;
+
+  /** 構造体バインディングの未登録のキーは値を生成せずに読み飛ばし、同じ文法で検証する */
+  {
+    std::stringstream ss(R"({"name": "pen", "unknown": {"x": [1, {"y": "z"}]}, "price": 0.5, "sizes": [1]})");
+    test_item item;
+    deserializer(ss).execute(item);
+    assert(item.name == "pen" && item.price == 0.5 && item.sizes.size() == 1);
+
+    std::stringstream ss2(R"({"name": "pen", "unknown": {"x" 1}, "price": 0.5, "sizes": [1]})");
+    assert(deserializer(ss2).try_execute(item).code == parse_errc::syntax_error);
+  }
+  std::cout << "ok: binding skips unknown keys" << std::endl;
+}
+
+void test_036() {
+  const std::string a = R"({"id": 1, "name": "a long name that does not fit in sso", "items": [{"price": 1.5, "tags": ["x", "y"]}, {"price": 2}], "meta": {"ts": 100}})";
+  const std::string b = R"({"id": 2, "name": "another long name that is not in sso", "items": [{"price": 3.5, "tags": ["z"]}], "meta": {"ts": 200, "new": true}})";
+  auto parse = [](const std::string& s){
+    std::stringstream ss(s);
+    return deserializer(ss).execute();
+  };
+
+  /** 同じ deserializer で別の入力を解析する */
+  {
+    std::stringstream s1(a), s2(b), s3("[1, 2]");
+    deserializer d(s1);
+    const auto j1 = d.execute();
+    const auto j2 = d.reset(s2).execute();
+    const auto j3 = d.reset(s3).execute();
+    assert(j1 == parse(a) && j2 == parse(b) && j3 == parse("[1, 2]"));
+
+    /** 構造体バインディングでも作業領域を再利用する */
+    std::stringstream s4(R"({"name": "pen", "price": 0.5, "sizes": [1]})");
+    test_item item;
+    d.reset(s4).execute(item);
+    assert(item.name == "pen" && item.sizes.size() == 1);
+
+    /** エラーの位置は入力毎に先頭から数える */
+    std::stringstream s5("\n\n[x]");
+    parse_error e;
+    assert(!d.reset(s5).try_execute(item, e) && e.line == 3);
+  }
+  std::cout << "ok: deserializer reset" << std::endl;
+
+  /** 既存の json の領域を再利用して上書きする */
+  {
+    json j = parse(a);
+    const json& cj = j;
+    const auto* obj = &cj.get<json::object_type>();
+    const auto* items = cj["items"].get<json::array_type>().data();
+    const auto* name = cj["name"].get<std::string>().data();
+    const auto* meta = &cj["meta"].get<json::object_type>();
+    const json before = j;
+
+    std::stringstream ss(b);
+    parse_stats stats;
+    deserializer(ss).instrument(stats).execute(j);
+    assert(j == parse(b));
+    assert(before == parse(a));
+    assert(&cj.get<json::object_type>() == obj);
+    assert(cj["items"].get<json::array_type>().data() == items);
+    assert(cj["items"].get<json::array_type>().size() == 1);
+    assert(cj["name"].get<std::string>().data() == name);
+    assert(&cj["meta"].get<json::object_type>() == meta);
+    assert(stats.allocations == 1); /** meta.new のノードのみ */
+
+    /** 入力に無いキーの削除と型の変更 */
+    std::stringstream ss2(R"({"id": "x", "items": {"k": []}})");
+    deserializer(ss2).execute(j);
+    assert(j == parse(R"({"id": "x", "items": {"k": []}})"));
+
+    /** キーの重複は新規に生成する場合と同じく最初の値を採用する */
+    std::stringstream ss3(R"({"id": 1, "id": 2, "items": 3})");
+    deserializer(ss3).execute(j);
+    assert(j == parse(R"({"id": 1, "id": 2, "items": 3})"));
+    assert(j["id"].get<int>() == 1);
+
+    /** スキーマ */
+    const auto s = schema::compile({{"type", "object"}, {"maxProperties", 2}});
+    std::stringstream ss4(R"({"id": 1, "id": 2, "items": 3})");
+    deserializer(ss4, s).execute(j);
+    std::stringstream ss5(R"({"id": 1, "x": 2, "items": 3})");
+    parse_error e;
+    assert(!deserializer(ss5, s).try_execute(j, e) && e.code == parse_errc::schema_violation);
+  }
+  std::cout << "ok: recycle existing tree" << std::endl;
+
+  /** 要素のアドレスが変わる map（flat map）でも再利用できる */
+  {
+    auto flat = [](const std::string& src){
+      std::stringstream ss(src);
+      return deserializer(ss).execute<test_flat_json>();
+    };
+    test_flat_json f = flat(R"({"b": 1, "d": {"x": 1}, "f": [1], "h": "s", "j": 5})");
+    const std::string inputs[] = {
+      R"({"a": 0, "b": 2, "c": 3, "d": {"w": 0, "x": 2}, "e": 4, "j": 6, "k": 7})",
+      R"({"k": 1, "a": 2, "a": 3, "z": {"y": []}})",
+      R"({"m": 1, "n": 2, "z": {"y": [1], "x": {}}, "k": null})",
+      R"({})",
+      R"({"q": 1, "p": 2, "p": 3})"
+    };
+    for(const auto& src : inputs){
+      std::stringstream ss(src);
+      deserializer(ss).execute(f);
+      assert(f == flat(src));
+    }
+    assert(f["p"].get<int>() == 2);
+  }
+  std::cout << "ok: recycle flat map" << std::endl;
+}
+
+void test_037() {
+  const std::string src = R"({
+    "user": {"id": 10, "name": "taro", "tags": ["a", "b"]},
+    "items": [
+      {"price": 1.5, "name": "pen", "extra": {"deep": [1, 2, {"x": "}]\"{"}]}},
+      {"price": 2, "name": "ink"},
+      {"name": "no price"},
+      7
+    ],
+    /* comment */ "meta": {"ts": null, "trace": "abc\"def"},
+    "skip": [1e99999, tru, {"a": [1}]]
+  })";
+  auto project = [&](const projection& p){
+    std::stringstream ss(src);
+    return deserializer(ss).project(p).execute();
+  };
+  auto parse = [](const std::string& s){
+    std::stringstream ss(s);
+    return deserializer(ss).execute();
+  };
+
+  /** 指定したパスとその祖先のみを生成する */
+  const auto j = project({"user.id", "items[*].price", "meta.ts"});
+  assert(j == parse(R"({"user": {"id": 10}, "items": [{"price": 1.5}, {"price": 2}, {}, null], "meta": {"ts": null}})"));
+  assert(path_util::find(j, "meta.ts")->is_null());
+  std::cout << "ok: projection paths" << std::endl;
+
+  /** 部分木ごと生成する */
+  assert(project({"user", "user.id"}) == parse(R"({"user": {"id": 10, "name": "taro", "tags": ["a", "b"]}})"));
+  assert(project({"user.tags[*]"}) == parse(R"({"user": {"tags": ["a", "b"]}})"));
+  assert(project({"items[*].extra.deep"}) == parse(R"({"items": [{"extra": {"deep": [1, 2, {"x": "}]\"{"}]}}, {}, {}, null]})"));
+  assert(project({"missing"}) == parse("{}"));
+  std::cout << "ok: projection subtrees" << std::endl;
+
+  /** 区切り文字とルートの array */
+  {
+    std::stringstream ss(R"([{"a": {"b": 1, "c": 2}}, {"a": 3}, 4])");
+    const projection p({"[*]/a/b"}, '/');
+    assert(deserializer(ss).project(p).execute() == parse(R"([{"a": {"b": 1}}, {}, null])"));
+    std::stringstream ss2(R"({"a": 1})");
+    assert(deserializer(ss2).project(p).execute().is_null());
+  }
+  std::cout << "ok: projection separator and root array" << std::endl;
+
+  /** 読み飛ばす部分も文字列と括弧の対応は確認する */
+  {
+    json k;
+    std::stringstream ss1(R"({"a": {"b": "unterminated}})");
+    assert(deserializer(ss1).project(projection({"x"})).try_execute(k).code == parse_errc::unexpected_eof);
+    std::stringstream ss2(R"({"a": [1, 2, {"b": 3})");
+    assert(deserializer(ss2).project(projection({"x"})).try_execute(k).code == parse_errc::unexpected_eof);
+    std::stringstream ss3(R"({"x": [1, 2,, 3] "y": 1})");
+    assert(deserializer(ss3).project(projection({"x"})).try_execute(k).code == parse_errc::syntax_error);
+  }
+  std::cout << "ok: projection errors" << std::endl;
+}
+
+void test_038() {
+  auto parse = [](const std::string& s){
+    std::stringstream ss(s);
+    return deserializer(ss).execute();
+  };
+
+  /** コンパイル時の検証 */
+  static_assert(literal::valid(R"({"a": [1, -2.5e3, true, false, null], "b": {"c": "\u3042\n"}})"), "");
+  static_assert(literal::valid(" /* comment */ [] // comment"), "");
+  static_assert(literal::valid("\"\xe3\x81\x82\""), "");
+  static_assert(literal::valid("9223372036854775807") && literal::valid("-9223372036854775808"), "");
+  static_assert(literal::valid("1e308") && literal::valid("1.7976931348623157e308") && literal::valid("0.0e99999"), "");
+  static_assert(literal::valid("/* a\n */ 1"), "");
+  static_assert(!literal::valid(""), "");
+  static_assert(!literal::valid("{\"a\": 1,}"), "");
+  static_assert(!literal::valid("[1,, 2]"), "");
+  static_assert(!literal::valid("{\"\": 1}"), "");
+  static_assert(!literal::valid("{\"a\" 1}"), "");
+  static_assert(!literal::valid("[1] 2"), "");
+  static_assert(!literal::valid("\"\\x\""), "");
+  static_assert(!literal::valid("\"\\u12g4\""), "");
+  static_assert(!literal::valid("\"a\tb\""), "");
+  static_assert(!literal::valid("\"\xc0\xaf\""), "");
+  static_assert(!literal::valid("\"\xed\xa0\x80\""), "");
+  static_assert(!literal::valid("01") && !literal::valid("1.") && !literal::valid(".5") && !literal::valid("1e"), "");
+  static_assert(!literal::valid("9223372036854775808") && !literal::valid("-9223372036854775809"), "");
+  static_assert(!literal::valid("1e309") && !literal::valid("1.8e308") && !literal::valid("1e-308") && !literal::valid("1e-400"), "");
+  static_assert(!literal::valid("tru") && !literal::valid("nul"), "");
+  static_assert(!literal::valid("[1 /* unterminated"), "");
+  std::cout << "ok: literal validation" << std::endl;
+
+  /** 最初に参照した時点で１度だけ解析する */
+  auto conf = []() -> const json& {
+    return CPPJSON_LITERAL(R"({"retry": 3, "hosts": ["a", "b"]})");
+  };
+  assert(conf() == parse(R"({"retry": 3, "hosts": ["a", "b"]})"));
+  assert(&conf() == &conf());
+  assert(CPPJSON_LITERAL("/* a\n*/ [1]") == parse("[1]"));
+  {
+    using namespace cppjson::literals;
+    const json j = R"([1, "x", {"y": null}])"_json;
+    assert(j == parse(R"([1, "x", {"y": null}])"));
+  }
+  std::cout << "ok: literal" << std::endl;
+
+  /** 埋め込むヘッダの生成 */
+  {
+    const auto j = parse(R"({"retry": 3, "name": "cppjson"})");
+    std::stringstream ss;
+    embed_generator(j, "defaults", "defaults.json").execute(ss);
+    const auto header = ss.str();
+    const auto size = snapshot_serializer(j).execute().size();
+    assert(header.find("inline cppjson::snapshot_view defaults()") != std::string::npos);
+    assert(header.find("alignas(8) static const unsigned char data[" + std::to_string(size) + "]") != std::string::npos);
+    assert(header.find("defaults.json") != std::string::npos);
+  }
+  std::cout << "ok: embed generator" << std::endl;
+
+#if defined(CPPJSON_TEST_EMBEDDED)
+  /** ビルド時に生成したヘッダ */
+  {
+    const auto e = cppjson_embedded::embedded();
+    assert(e["retry"].get<int>() == 3);
+    assert(e["hosts"].size() == 2 && e["hosts"][1].get<std::string>() == "b.example");
+    assert(e["limits"]["timeout"].get<double>() == 1.5);
+    assert(e.to_json() == parse(R"({"retry": 3, "hosts": ["a.example", "b.example"], "limits": {"timeout": 1.5, "verbose": false}})"));
+  }
+  std::cout << "ok: embedded header" << std::endl;
+#endif
+}
+
+void test_039() {
+  auto parse = [](const std::string& s){
+    std::stringstream ss(s);
+    return deserializer(ss).execute();
+  };
+  auto parse_raw = [](const std::string& s){
+    std::stringstream ss(s);
+    return deserializer(ss).raw_numbers().execute();
+  };
+
+  /** 数値の文字列をそのまま保持し、そのまま出力する */
+  const std::string src = "[12345678901234567890, 19.90, -0, 1E+2, 0.1, -9223372036854775808]";
+  const auto j = parse_raw(src);
+  assert(j[0].value_type_id() == json::value_type_id::raw_number);
+  assert(j[2].value_type_id() == json::value_type_id::raw_number);
+  assert(j[5].value_type_id() == json::value_type_id::integral); /** int64_t の範囲の整数は表記が変わらない */
+  assert(j[1].get<json::raw_number>().text() == "19.90");
+  assert(serializer(j).execute() == "[12345678901234567890,19.90,-0,1E+2,0.1,-9223372036854775808]");
+  std::cout << "ok: raw number round trip" << std::endl;
+
+  /** get<T>() で変換する */
+  assert(j[0].get<uint64_t>() == 12345678901234567890ull);
+  try{
+    j[0].get<int64_t>();
+    assert(false);
+  }
+  catch(const bad_cast&){}
+  assert(j[0].get<double>() == 12345678901234567890.0);
+  assert(j[1].get<double>() == 19.9);
+  assert(j[1].get<int>() == 19);
+  assert(j[3].get<int>() == 100);
+  assert(j[5].get<int64_t>() == INT64_MIN);
+  assert(j[2].acquirable<int>() && !j[2].acquirable<std::string>());
+  assert(j.resolve_number() == j);
+  assert(j[0].resolve_number().value_type_id() == json::value_type_id::floating_point);
+  assert(j[5].resolve_number().value_type_id() == json::value_type_id::integral);
+  std::cout << "ok: raw number conversion" << std::endl;
+
+  /** 比較とハッシュは数値として行う */
+  assert(j[3] == json(100) && j[3] == json(100.0) && j[2] == json(0));
+  assert(j[1] == json(19.9) && j[1] == parse_raw("19.9"));
+  assert(j[3].hash() == json(100).hash() && j[1].hash() == parse_raw("19.9").hash());
+  assert(j[0] == parse_raw("12345678901234567890"));
+  assert(j[0] != parse_raw("12345678901234567891"));
+  assert(parse_raw(R"({"a": [1, 2.5]})") == parse(R"({"a": [1, 2.5]})"));
+  std::cout << "ok: raw number equality" << std::endl;
+
+  /** 正規化・バイナリ形式では数値に変換する */
+  assert(serializer(j[1]).canonical().execute() == "19.9");
+  assert(serializer(j[3]).canonical().execute() == "100");
+  assert(cbor_serializer(j[3]).execute() == cbor_serializer(json(100.0)).execute());
+  assert(cbor_serializer(j[5]).execute() == cbor_serializer(json(INT64_MIN)).execute());
+  assert(msgpack_serializer(j[1]).execute() == msgpack_serializer(json(19.9)).execute());
+  assert(snapshot_view::from(snapshot_serializer(j).execute())[3].get<int>() == 100);
+  std::cout << "ok: raw number encoders" << std::endl;
+
+  /** RFC 8259 の文法で検証する */
+  for(const auto s : {"01", "1.", "+1", ".5", "1e", "--1", "1-2", "1.5.x"}){
+    std::stringstream ss(s);
+    json k;
+    assert(deserializer(ss).raw_numbers().try_execute(k).code == parse_errc::invalid_number);
+    std::stringstream vs(s);
+    assert(deserializer(vs).raw_numbers().validate().code == parse_errc::invalid_number);
+  }
+  assert(json(json::raw_number("1.50")) == json(1.5));
+  assert(serializer(json(json::raw_number("1.50"))).execute() == "1.50");
+  try{
+    json::raw_number("1.5.0");
+    assert(false);
+  }
+  catch(const bad_cast&){}
+  std::cout << "ok: raw number validation" << std::endl;
+
+  /** 既存の raw_number の領域を再利用する・dedup は文字列が同じもののみ共有する */
+  {
+    std::stringstream s1("[1.25, 2]"), s2("[3.75, 4]");
+    deserializer d(s1);
+    d.raw_numbers();
+    json k;
+    d.execute(k);
+    const json& ck = k;
+    const auto* p = &ck[0].get<json::raw_number>();
+    d.reset(s2).execute(k);
+    assert(&ck[0].get<json::raw_number>() == p && serializer(k).execute() == "[3.75,4]");
+
+    std::stringstream s3("[1.0, 1.00, 1.0]");
+    dedup_pool pool;
+    const auto x = deserializer(s3).raw_numbers().dedup(pool).execute();
+    assert(serializer(x).execute() == "[1.0,1.00,1.0]");
+    assert(memory_inspector(x).execute().count(json::value_type_id::raw_number) == 2);
+  }
+  std::cout << "ok: raw number reuse" << std::endl;
+}
+
+void test_040() {
+  auto parse = [](const std::string& s, utf8_policy policy){
+    std::stringstream ss(s);
+    json j;
+    const auto e = deserializer(ss).on_invalid_utf8(policy).try_execute(j);
+    return e ? json(nullptr) : j;
+  };
+  auto error_of = [](const std::string& s){
+    std::stringstream ss(s);
+    json j;
+    return deserializer(ss).try_execute(j).code;
+  };
+  auto push = [](const std::string& s, utf8_policy policy, std::size_t chunk){
+    push_deserializer p;
+    p.on_invalid_utf8(policy);
+    for(std::size_t i = 0; i < s.size(); i += chunk){
+      p.feed(s.substr(i, chunk));
+    }
+    return p.finish();
+  };
+  const std::string fffd = "\xEF\xBF\xBD";
+
+  /** サロゲートの対は 4 バイトの UTF-8 に変換する */
+  const std::string emoji = R"("\ud83d\ude00 \uD834\uDD1E \u3042")";
+  const std::string expected = "\xF0\x9F\x98\x80 \xF0\x9D\x84\x9E \xE3\x81\x82";
+  assert(parse(emoji, utf8_policy::reject).get<std::string>() == expected);
+  for(std::size_t chunk = 1; chunk <= 4; chunk++){
+    assert(push(emoji, utf8_policy::reject, chunk).get<std::string>() == expected);
+  }
+  std::cout << "ok: surrogate pairs" << std::endl;
+
+  /** 対になっていないサロゲート */
+  for(const auto s : {R"("\ud83d")", R"("\ud83dx")", R"("\ud83dA")", R"("\ude00")", R"("\ud83d\ud83d")", R"("\ud83d\n")"}){
+    assert(error_of(s) == parse_errc::invalid_unicode);
+    try{
+      push(s, utf8_policy::reject, 1);
+      assert(false);
+    }
+    catch(const bad_json&){}
+  }
+  assert(parse(R"("\ud83dA")", utf8_policy::replace).get<std::string>() == fffd + "A");
+  assert(parse(R"("\ude00\ud83d")", utf8_policy::replace).get<std::string>() == fffd + fffd);
+  assert(push(R"("\ud83d\n")", utf8_policy::replace, 1).get<std::string>() == fffd + "\n");
+  std::cout << "ok: unpaired surrogates" << std::endl;
+
+  /** 不正な UTF-8 の並び（正しい並びの先頭として成立する最長の部分毎に１つ置き換える） */
+  const std::string bad = "\"a\xE3\x81z\xC0\xAF\xF0\x9F\x98\x80\xED\xA0\x80\"";
+  const std::string replaced = "a" + fffd + "z" + fffd + fffd + "\xF0\x9F\x98\x80" + fffd + fffd + fffd;
+  assert(error_of(bad) == parse_errc::invalid_utf8);
+  assert(parse(bad, utf8_policy::replace).get<std::string>() == replaced);
+  for(std::size_t chunk = 1; chunk <= 5; chunk++){
+    assert(push(bad, utf8_policy::replace, chunk).get<std::string>() == replaced);
+    assert(push("\"\xE3\x81\x82\"", utf8_policy::reject, chunk).get<std::string>() == "\xE3\x81\x82");
+  }
+  try{
+    push(bad, utf8_policy::reject, 3);
+    assert(false);
+  }
+  catch(const bad_json&){}
+  std::cout << "ok: invalid utf-8" << std::endl;
+
+  /** 入力全体の検証 */
+  std::string text(1000, 'x');
+  assert(utf8::valid(text));
+  text += "\xE3\x81\x82\xF0\x9F\x98\x80";
+  assert(utf8::valid(text) && utf8::valid_prefix(text.data(), text.size()) == text.size());
+  assert(!utf8::valid(text + "\xE3\x81"));
+  assert(utf8::valid_prefix((text + "\x80" + text).data(), text.size() * 2 + 1) == text.size());
+  assert(!utf8::valid(std::string("\xF4\x90\x80\x80")) && !utf8::valid(std::string("\xC1\xBF")));
+  std::string s = "ok\xFF";
+  assert(utf8::sanitize(s) && s == "ok" + fffd);
+  static_assert(literal::valid(R"("\ud83d\ude00")") && !literal::valid(R"("\ud83d")") && !literal::valid(R"("\ude00")"), "");
+  std::cout << "ok: utf8 validation" << std::endl;
+}
+
+void test_041() {
+  auto sequential = [](const std::string& s){
+    std::stringstream ss(s);
+    batch_result r;
+    if(!deserializer(ss).try_execute(r.value, r.error)) r.value = json();
+    return r;
+  };
+
+  /** 大きさの偏った入力とエラーを含む入力。結果は入力の順序で返却する */
+  std::vector<std::string> buffers;
+  for(int i = 0; i < 1000; i++){
+    if(i % 97 == 0){
+      buffers.push_back(R"({"id": )" + std::to_string(i) + R"(, "broken": [1, 2)");
+    }
+    else if(i % 10 == 0){
+      std::string s = "[";
+      for(int k = 0; k < 2000; k++) s += (k ? "," : "") + std::to_string(i + k);
+      buffers.push_back(s + "]");
+    }
+    else{
+      buffers.push_back(R"({"id": )" + std::to_string(i) + R"(, "name": "item)" + std::to_string(i) + R"("})");
+    }
+  }
+  batch_deserializer batch(4);
+  for(int round = 0; round < 3; round++){
+    const auto results = batch.execute(buffers);
+    assert(results.size() == buffers.size());
+    for(std::size_t i = 0; i < buffers.size(); i++){
+      const auto expected = sequential(buffers[i]);
+      assert(results[i].ok() == expected.ok());
+      assert(results[i].error.code == expected.error.code);
+      assert(results[i].error.offset == expected.error.offset);
+      assert(results[i].value == expected.value);
+    }
+    assert(!results[0].ok() && results[0].error.code == parse_errc::unexpected_eof && results[0].value.value_type_id() == json::value_type_id::undefined);
+    assert(results[1].value["id"].get<int>() == 1);
+  }
+  assert(batch.execute(std::vector<std::string>()).empty());
+  std::cout << "ok: buffers" << std::endl;
+
+  /** 各スレッドの deserializer の設定 */
+  batch.configure([](deserializer& d){ d.raw_numbers(); });
+  const auto raw = batch.execute({"[18446744073709551616]", "0.10"});
+  assert(raw[0].ok() && raw[0].value[0].value_type_id() == json::value_type_id::raw_number);
+  assert(raw[1].value.get<json::raw_number>().text() == "0.10");
+  batch.configure(nullptr);
+  assert(!batch.execute({"[18446744073709551616]"})[0].ok());
+  std::cout << "ok: configure" << std::endl;
+
+  /** ファイル（読み出せない場合は io_error） */
+  std::vector<std::string> paths;
+  for(int i = 0; i < 8; i++){
+    paths.push_back("cppjson_test_041_" + std::to_string(i) + ".json");
+    std::ofstream ofs(paths.back(), std::ios::binary);
+    ofs << R"({"file": )" << i << "}";
+  }
+  paths.push_back("cppjson_test_041_missing.json");
+  const auto files = batch.execute_files(paths);
+  for(int i = 0; i < 8; i++){
+    assert(files[i].ok() && files[i].value["file"].get<int>() == i);
+    std::remove(paths[i].c_str());
+  }
+  assert(files[8].error.code == parse_errc::io_error && files[8].error.detail == paths[8]);
+  std::cout << "ok: files" << std::endl;
+
+  /** 生成関数（取得した順序で返却する） */
+  int n = 0;
+  const auto produced = batch.execute([&](std::string& s){
+    if(n == 500) return false;
+    s = (n % 50 == 49) ? "{" : "[" + std::to_string(n) + "]";
+    n++;
+    return true;
+  });
+  assert(produced.size() == 500);
+  for(int i = 0; i < 500; i++){
+    if(i % 50 == 49){
+      assert(!produced[i].ok());
+    }
+    else{
+      assert(produced[i].value[0].get<int>() == i);
+    }
+  }
+  std::cout << "ok: producer" << std::endl;
+
+  /** 生成関数の例外は execute() で再送出する */
+  try{
+    n = 0;
+    batch.execute([&](std::string& s){
+      if(n++ == 10) throw std::runtime_error("producer");
+      s = "1";
+      return true;
+    });
+    assert(false);
+  }
+  catch(const std::runtime_error&){}
+  assert(batch.execute({"true"})[0].value.get<bool>());
+
+  /** 1 スレッド */
+  batch_deserializer single(1);
+  assert(single.threads() == 1 && single.execute(buffers)[1].value["id"].get<int>() == 1);
+  std::cout << "ok: exceptions and single thread" << std::endl;
+}
+
+void test_042() {
+  const std::string text = R"({"c": "x", "a": 1, "b": [1, 2.5, null, {"z": true, "y": "yy"}]})";
+  {
+    /** deserializer / serializer（object は std::map なのでキーの順に出力する） */
+    std::stringstream ss(text);
+    auto j = deserializer(ss).execute<test_ordered_json>();
+    assert(test_live_allocations > 0);
+    assert(j["a"].get<int>() == 1 && j["c"].get<test_string>() == "x");
+    assert(j["b"][3]["y"].get<test_string>() == "yy");
+    assert(serializer(j).execute() == R"({"a":1,"b":[1,2.5,null,{"y":"yy","z":true}],"c":"x"})");
+    std::stringstream cs(text);
+    assert(serializer(j).canonical().execute() == serializer(deserializer(cs).execute()).canonical().execute());
+    assert(serializer(j, "  ").execute_parallel(2, 1) == serializer(j, "  ").execute());
+    std::cout << "ok: deserializer / serializer" << std::endl;
+
+    /** 既存の値を再利用して解析する・比較・ハッシュ・copy-on-write */
+    const auto copy = j;
+    std::stringstream ss2(R"({"a": 2, "b": [1, 2.5, null, {"z": true, "y": "yy"}]})");
+    deserializer(ss2).execute(j);
+    assert(j["a"].get<int>() == 2 && j["c"].is_undefined());
+    assert(copy["a"].get<int>() == 1 && copy != j);
+    std::stringstream ss3(text);
+    const auto again = deserializer(ss3).execute<test_ordered_json>();
+    assert(again == copy && again.hash() == copy.hash() && std::hash<test_ordered_json>()(again) == copy.hash());
+    std::cout << "ok: recycle / compare" << std::endl;
+
+    /** path_util / array / object */
+    auto* y = path_util::find(j, "b");
+    assert(y && y->get<test_ordered_json::array_type>().size() == 4);
+    path_util::put(j, "d.e.f", 3);
+    path_util::put(j, "d.g", "h");
+    assert(path_util::find(j, "d.e.f")->get<int>() == 3);
+    assert(serializer(j["d"]).execute() == R"({"e":{"f":3},"g":"h"})");
+    assert(path_util::find(static_cast<const test_ordered_json&>(j), "d.x") == nullptr);
+    assert(serializer(path_util::create("p.q", test_ordered_json(true))).execute() == R"({"p":{"q":true}})");
+    const test_ordered_json a = basic_array<test_ordered_traits>{1, "s", basic_array<test_ordered_traits>{true}, basic_object<test_ordered_traits>{{"k", nullptr}}};
+    assert(serializer(a).execute() == R"([1,"s",[true],{"k":null}])");
+    const auto created = basic_object<test_ordered_traits>::util::create([](test_ordered_json::object_type& obj){ obj["m"] = 1; });
+    assert(created["m"].get<int>() == 1);
+    std::cout << "ok: path_util / array / object" << std::endl;
+
+    /** スキーマは json のみ */
+    const auto sc = schema::compile({{"type", "object"}});
+    std::stringstream ss4(text);
+    test_ordered_json k;
+    assert(deserializer(ss4, sc).try_execute(k).code == parse_errc::schema_violation);
+
+    /** raw_numbers */
+    std::stringstream ss5("[18446744073709551616, 0.10]");
+    const auto raw = deserializer(ss5).raw_numbers().execute<test_ordered_json>();
+    assert(serializer(raw).execute() == "[18446744073709551616,0.10]");
+  }
+  /** 全ての領域を Traits のアロケータで解放している */
+  assert(test_live_allocations == 0);
+  std::cout << "ok: allocator" << std::endl;
+}
+
+void test_043() {
+  auto parse_json = [](const std::string& s){
+    std::stringstream ss(s);
+    return deserializer(ss).execute();
+  };
+  auto canonical = [](const auto& j){
+    std::stringstream ss;
+    serializer(j).canonical().execute(ss);
+    return ss.str();
+  };
+  auto in_source = [](const std::string& src, const borrowed_string& s){
+    return s.is_borrowed() && s.data() >= src.data() && s.data() + s.size() <= src.data() + src.size();
+  };
+
+  /** 文字列とキーは入力の範囲を参照し、エスケープを含む場合は参照した時点で変換する */
+  const std::string src = R"({"name": "alice", "note": "line1\nline2 \"q\" \u00e9 \ud83d\ude00", "tags": ["a", "b\/c"], "n": 1.5, "ok": true, "esc\tkey": 1})";
+  borrowed_deserializer d(src);
+  const auto doc = d.execute();
+  const auto expected = parse_json(src);
+  assert(canonical(doc) == canonical(expected));
+  const auto& obj = doc.get<borrowed_json::object_type>();
+  assert(obj.size() == 6);
+  for(const auto& kv : obj){
+    assert(in_source(src, kv.first) || kv.first == "esc\tkey");
+  }
+  const auto& name = doc["name"].get<borrowed_string>();
+  assert(in_source(src, name) && name == "alice" && name.str() == "alice");
+  const auto& note = doc["note"].get<borrowed_string>();
+  assert(note.is_borrowed() && note.str() == expected["note"].get<std::string>());
+  assert(doc["tags"][1].get<borrowed_string>() == "b/c");
+  assert(doc["esc\tkey"].get<int>() == 1);
+  assert(doc["n"].get<double>() == 1.5 && doc["ok"].get<bool>());
+  assert(path_util::find(doc, "tags")->get<borrowed_json::array_type>().size() == 2);
+  std::cout << "ok: borrowed" << std::endl;
+
+  /** 比較・ハッシュは変換後の内容で行う */
+  assert(doc["note"] == borrowed_json(expected["note"].get<std::string>().c_str()));
+  std::stringstream copied(src);
+  assert(doc.hash() == deserializer(copied).execute<borrowed_json>().hash());
+  assert(std::hash<borrowed_string>()(note) == std::hash<borrowed_string>()(borrowed_string(note.str())));
+  std::cout << "ok: compare" << std::endl;
+
+  /** 複製は範囲を共有し、変更すると自身で保持する */
+  auto copy = doc;
+  auto& s = copy["name"].get<borrowed_string>();
+  assert(in_source(src, s));
+  s += "!";
+  assert(!s.is_borrowed() && s == "alice!" && doc["name"].get<borrowed_string>() == "alice");
+  copy["added"] = "value";
+  assert(!copy["added"].get<borrowed_string>().is_borrowed());
+  std::cout << "ok: modify" << std::endl;
+
+  /** エラーは deserializer と同一 */
+  for(const std::string bad : {R"({"a": "x)", R"(["a\q"])", "{\"\": 1}", "[\"a\tb\"]", "[\"\xC3\x28\"]"}){
+    std::stringstream ss(bad);
+    json j;
+    parse_error expected_error;
+    deserializer(ss).try_execute(j, expected_error);
+    borrowed_json b;
+    parse_error error;
+    assert(!borrowed_deserializer(bad).try_execute(b, error));
+    assert(error.code == expected_error.code && error.offset == expected_error.offset);
+  }
+  bool thrown = false;
+  try{
+    borrowed_deserializer("[1,").execute();
+  }
+  catch(const bad_json&){
+    thrown = true;
+  }
+  assert(thrown);
+  std::cout << "ok: errors" << std::endl;
+
+  /** U+FFFD への置き換えも参照した時点で行う */
+  const std::string invalid = "[\"a\xC3\x28" "b\", \"\\ud800x\"]";
+  std::stringstream ss(invalid);
+  const auto replaced = deserializer(ss).on_invalid_utf8(utf8_policy::replace).execute();
+  const auto lazy = borrowed_deserializer(invalid).on_invalid_utf8(utf8_policy::replace).execute();
+  assert(lazy[0].get<borrowed_string>().str() == replaced[0].get<std::string>());
+  assert(lazy[1].get<borrowed_string>().str() == replaced[1].get<std::string>());
+  std::cout << "ok: replace" << std::endl;
+
+  /** 複数のスレッドから同時に変換しても同じ結果 */
+  const std::string escaped = R"(["\u3042\u3044\u3046\n"])";
+  const auto shared = borrowed_deserializer(escaped).execute();
+  std::vector<std::thread> threads;
+  std::vector<std::string> seen(4);
+  for(std::size_t i = 0; i < seen.size(); i++){
+    threads.emplace_back([&, i](){ seen[i] = shared[0].get<borrowed_string>().str(); });
+  }
+  for(auto& t : threads) t.join();
+  for(const auto& v : seen) assert(v == seen[0] && v.size() == 10);
+  std::cout << "ok: concurrent" << std::endl;
+
+  /** 入力の切り替えと raw_numbers() */
+  const std::string numbers = R"({"big": 18446744073709551616, "key": "v"})";
+  d.reset(numbers.data(), numbers.size()).raw_numbers();
+  const auto raw = d.execute();
+  assert(raw["big"].get<borrowed_json::raw_number>().text() == "18446744073709551616");
+  assert(in_source(numbers, raw["key"].get<borrowed_string>()));
+
+  /** deserializer で borrowed_json を生成した場合は複製する */
+  std::stringstream ss2(src);
+  const auto owned = deserializer(ss2).execute<borrowed_json>();
+  assert(!owned["name"].get<borrowed_string>().is_borrowed() && canonical(owned) == canonical(expected));
+  std::cout << "ok: reset" << std::endl;
+}
+
 int main(void) {
 
   std::cout << "********** test_001() **********" << std::endl;
@@ -531,5 +2652,77 @@ int main(void) {
   std::cout << "********** test_019() **********" << std::endl;
   test_019();
 
+  std::cout << "********** test_020() **********" << std::endl;
+  test_020();
+
+  std::cout << "********** test_021() **********" << std::endl;
+  test_021();
+
+  std::cout << "********** test_022() **********" << std::endl;
+  test_022();
+
+  std::cout << "********** test_023() **********" << std::endl;
+  test_023();
+
+  std::cout << "********** test_024() **********" << std::endl;
+  test_024();
+
+  std::cout << "********** test_025() **********" << std::endl;
+  test_025();
+
+  std::cout << "********** test_026() **********" << std::endl;
+  test_026();
+
+  std::cout << "********** test_027() **********" << std::endl;
+  test_027();
+
+  std::cout << "********** test_028() **********" << std::endl;
+  test_028();
+
+  std::cout << "********** test_029() **********" << std::endl;
+  test_029();
+
+  std::cout << "********** test_030() **********" << std::endl;
+  test_030();
+
+  std::cout << "********** test_031() **********" << std::endl;
+  test_031();
+
+  std::cout << "********** test_032() **********" << std::endl;
+  test_032();
+
+  std::cout << "********** test_033() **********" << std::endl;
+  test_033();
+
+  std::cout << "********** test_034() **********" << std::endl;
+  test_034();
+
+  std::cout << "********** test_035() **********" << std::endl;
+  test_035();
+
+  std::cout << "********** test_036() **********" << std::endl;
+  test_036();
+
+  std::cout << "********** test_037() **********" << std::endl;
+  test_037();
+
+  std::cout << "********** test_038() **********" << std::endl;
+  test_038();
+
+  std::cout << "********** test_039() **********" << std::endl;
+  test_039();
+
+  std::cout << "********** test_040() **********" << std::endl;
+  test_040();
+
+  std::cout << "********** test_041() **********" << std::endl;
+  test_041();
+
+  std::cout << "********** test_042() **********" << std::endl;
+  test_042();
+
+  std::cout << "********** test_043() **********" << std::endl;
+  test_043();
+
   return 0;
 }
\ No newline at end of file